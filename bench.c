@@ -0,0 +1,236 @@
+#include "jacon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Microbenchmarks of the hash map, hash set and string builder on their own.
+// Every case reports the time and the allocator calls per operation.
+
+typedef struct {
+    size_t allocations;
+} Bench_Counter;
+
+void*
+bench_allocate(void* ctx, size_t size)
+{
+    ((Bench_Counter*)ctx)->allocations++;
+    return malloc(size);
+}
+
+void*
+bench_reallocate(void* ctx, void* ptr, size_t size)
+{
+    ((Bench_Counter*)ctx)->allocations++;
+    return realloc(ptr, size);
+}
+
+void
+bench_deallocate(void* ctx, void* ptr)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static Bench_Counter counter = {0};
+static const Jacon_Allocator counting_allocator = {
+    .allocate = bench_allocate,
+    .reallocate = bench_reallocate,
+    .deallocate = bench_deallocate,
+    .ctx = &counter,
+};
+
+uint64_t
+bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+typedef struct {
+    uint64_t start;
+    size_t allocations;
+} Bench_Run;
+
+Bench_Run
+bench_start(void)
+{
+    return (Bench_Run){ .start = bench_now(), .allocations = counter.allocations };
+}
+
+void
+bench_report(const char* name, size_t size, Bench_Run run, size_t operations)
+{
+    uint64_t elapsed = bench_now() - run.start;
+    printf("%-32s %9zu %10.1f ns/op %8.2f allocs/op\n", name, size,
+        (double)elapsed / operations, (double)(counter.allocations - run.allocations) / operations);
+}
+
+/**
+ * count distinct keys numbered from first, colliding ones all share the same djb2 hash.
+ * "AB" and "B!" hash alike and so do any equal length concatenations of them.
+ */
+char**
+bench_keys(size_t count, size_t first, bool colliding)
+{
+    char** keys = malloc(count * sizeof(char*));
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = malloc(64);
+        if (!colliding) {
+            snprintf(keys[i], 64, "user.member_%zu", first + i);
+            continue;
+        }
+        for (size_t bit = 0; bit < 20; bit++) {
+            memcpy(keys[i] + 2 * bit, ((first + i) >> bit) & 1 ? "B!" : "AB", 2);
+        }
+        keys[i][40] = '\0';
+    }
+    return keys;
+}
+
+void
+bench_free_keys(char** keys, size_t count)
+{
+    for (size_t i = 0; i < count; i++) free(keys[i]);
+    free(keys);
+}
+
+void
+bench_hash_map(size_t size, bool colliding)
+{
+    char** keys = bench_keys(size, 0, colliding);
+    char** missing = bench_keys(size, size, colliding);
+    const char* suffix = colliding ? " (colliding)" : "";
+    char name[64];
+
+    // Every entry holds a reference to the same node, the map frees its entries through Jacon_free_node
+    Jacon_Node* sentinel = Jacon_calloc(1, sizeof(Jacon_Node));
+    sentinel->type = JACON_VALUE_NULL;
+    sentinel->ref_count = size;
+
+    // Growing from the default size, every resize included
+    Jacon_HashMap map = { .entries = Jacon_calloc(JACON_MAP_DEFAULT_SIZE, sizeof(Jacon_HashMapEntry*)), .size = JACON_MAP_DEFAULT_SIZE };
+    Bench_Run run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_hm_put(&map, keys[i], sentinel);
+    snprintf(name, sizeof(name), "hm insert growing%s", suffix);
+    bench_report(name, size, run, size);
+
+    run = bench_start();
+    size_t hits = 0;
+    for (size_t i = 0; i < size; i++) hits += Jacon_hm_get(&map, keys[i]) == sentinel;
+    snprintf(name, sizeof(name), "hm lookup hit%s", suffix);
+    bench_report(name, size, run, size);
+
+    run = bench_start();
+    size_t misses = 0;
+    for (size_t i = 0; i < size; i++) misses += Jacon_hm_get(&map, missing[i]) == NULL;
+    snprintf(name, sizeof(name), "hm lookup miss%s", suffix);
+    bench_report(name, size, run, size);
+    Jacon_hm_free(&map);
+    if (hits != size || misses != size) printf("unexpected lookup result\n");
+
+    // Large enough up front, no resize. Removed entries hand their value back without freeing it.
+    map = (Jacon_HashMap){ .entries = Jacon_calloc(size + 1, sizeof(Jacon_HashMapEntry*)), .size = size + 1 };
+    run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_hm_put(&map, keys[i], sentinel);
+    snprintf(name, sizeof(name), "hm insert presized%s", suffix);
+    bench_report(name, size, run, size);
+
+    run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_hm_remove(&map, keys[i]);
+    snprintf(name, sizeof(name), "hm remove%s", suffix);
+    bench_report(name, size, run, size);
+    Jacon_hm_free(&map);
+    Jacon_free_node(sentinel);
+
+    bench_free_keys(keys, size);
+    bench_free_keys(missing, size);
+}
+
+void
+bench_hash_set(size_t size, bool colliding)
+{
+    char** keys = bench_keys(size, 0, colliding);
+    char** missing = bench_keys(size, size, colliding);
+    const char* suffix = colliding ? " (colliding)" : "";
+    char name[64];
+
+    Jacon_HashSet set = { .entries = Jacon_calloc(10, sizeof(Jacon_HashSetEntry*)), .capacity = 10 };
+    Bench_Run run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_hs_put(&set, keys[i]);
+    snprintf(name, sizeof(name), "hs insert growing%s", suffix);
+    bench_report(name, size, run, size);
+
+    run = bench_start();
+    size_t hits = 0;
+    for (size_t i = 0; i < size; i++) hits += Jacon_hs_exists(&set, keys[i]);
+    snprintf(name, sizeof(name), "hs exists hit%s", suffix);
+    bench_report(name, size, run, size);
+
+    run = bench_start();
+    size_t misses = 0;
+    for (size_t i = 0; i < size; i++) misses += !Jacon_hs_exists(&set, missing[i]);
+    snprintf(name, sizeof(name), "hs exists miss%s", suffix);
+    bench_report(name, size, run, size);
+    Jacon_hs_free(&set);
+    if (hits != size || misses != size) printf("unexpected lookup result\n");
+
+    bench_free_keys(keys, size);
+    bench_free_keys(missing, size);
+}
+
+void
+bench_string_builder(size_t size)
+{
+    Jacon_StringBuilder builder = {0};
+    Bench_Run run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_str_append_n(&builder, "\"name\": ", 8);
+    bench_report("sb append_n 8 bytes", size, run, size);
+    Jacon_str_free(&builder);
+
+    run = bench_start();
+    Jacon_str_reserve(&builder, size * 8);
+    for (size_t i = 0; i < size; i++) Jacon_str_append_n(&builder, "\"name\": ", 8);
+    bench_report("sb append_n 8 bytes reserved", size, run, size);
+    Jacon_str_free(&builder);
+
+    run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_str_append_null(&builder, "\"", "name", "\": ");
+    bench_report("sb append 3 pieces", size, run, size);
+    Jacon_str_free(&builder);
+
+    run = bench_start();
+    for (size_t i = 0; i < size; i++) Jacon_str_append_fmt_null(&builder, "%zu, ", i);
+    bench_report("sb append_fmt", size, run, size);
+    Jacon_str_free(&builder);
+
+    // Many short lived builders, as the path index does for every node
+    run = bench_start();
+    for (size_t i = 0; i < size; i++) {
+        Jacon_StringBuilder path = {0};
+        Jacon_str_append_null(&path, "user.address.", "city");
+        Jacon_str_free(&path);
+    }
+    bench_report("sb short lived path", size, run, size);
+}
+
+int
+main(void)
+{
+    const Jacon_Allocator* previous = Jacon_push_allocator(&counting_allocator);
+    printf("%-32s %9s\n", "case", "size");
+
+    const size_t sizes[] = { 100, 10000, 200000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench_hash_map(sizes[i], false);
+    // Every key lands in the same bucket, lookups walk the whole chain
+    bench_hash_map(2000, true);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench_hash_set(sizes[i], false);
+    bench_hash_set(2000, true);
+
+    bench_string_builder(1000000);
+
+    Jacon_pop_allocator(previous);
+    return 0;
+}
@@ -6,10 +6,209 @@
 #include <math.h>
 #include <limits.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <inttypes.h>
+#ifdef JACON_STATS
+#include <time.h>
+#endif
+
+// Define JACON_NO_SIMD to build the scalar code paths only
+#if defined(__SSE2__) && !defined(JACON_NO_SIMD)
+#define JACON_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__) && !defined(JACON_NO_SIMD)
+#define JACON_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static Jacon_Allocator Jacon_global_allocator = {0};
+// Allocator of the content or parser currently working on this thread
+static _Thread_local const Jacon_Allocator* Jacon_scoped_allocator = NULL;
+
+void
+Jacon_set_allocator(const Jacon_Allocator* allocator)
+{
+    if (allocator == NULL) {
+        Jacon_global_allocator = (Jacon_Allocator){0};
+    } else {
+        Jacon_global_allocator = *allocator;
+    }
+}
+
+const Jacon_Allocator*
+Jacon_push_allocator(const Jacon_Allocator* allocator)
+{
+    const Jacon_Allocator* previous = Jacon_scoped_allocator;
+    if (allocator != NULL) Jacon_scoped_allocator = allocator;
+    return previous;
+}
+
+void
+Jacon_pop_allocator(const Jacon_Allocator* previous)
+{
+    Jacon_scoped_allocator = previous;
+}
+
+/**
+ * Allocator in use on this thread, NULL when allocating from libc
+ */
+const Jacon_Allocator*
+Jacon_active_allocator(void)
+{
+    if (Jacon_scoped_allocator != NULL) return Jacon_scoped_allocator;
+    if (Jacon_global_allocator.allocate != NULL) return &Jacon_global_allocator;
+    return NULL;
+}
+
+// Statistics of the calling thread, see Jacon_push_stats
+static _Thread_local Jacon_Stats* Jacon_active_stats = NULL;
+
+Jacon_Stats*
+Jacon_push_stats(Jacon_Stats* stats)
+{
+    Jacon_Stats* previous = Jacon_active_stats;
+    Jacon_active_stats = stats;
+    return previous;
+}
+
+void
+Jacon_pop_stats(Jacon_Stats* previous)
+{
+    Jacon_active_stats = previous;
+}
+
+#ifdef JACON_STATS
+uint64_t
+Jacon_stats_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+#define JACON_STAT_ADD(field, n) do { \
+    if (Jacon_active_stats != NULL) Jacon_active_stats->field += (n); \
+} while (0)
+// Time expression, the clock is only read when statistics are collected
+#define JACON_STAT_TIME(field, expression) do { \
+    uint64_t jacon_stat_start = Jacon_active_stats != NULL ? Jacon_stats_now() : 0; \
+    expression; \
+    JACON_STAT_ADD(field, Jacon_stats_now() - jacon_stat_start); \
+} while (0)
+#else
+#define JACON_STAT_ADD(field, n) do {} while (0)
+#define JACON_STAT_TIME(field, expression) do { expression; } while (0)
+#endif
+
+typedef struct {
+    const Jacon_ParseLimits* limits;
+    size_t allocated;
+    bool memory_exceeded;
+} Jacon_LimitState;
+
+// Limits of the parse running on this thread, see Jacon_deserialize_with_limits
+static _Thread_local Jacon_LimitState* Jacon_active_limits = NULL;
+
+#define Jacon_over_limit(field, value) (Jacon_active_limits != NULL \
+    && Jacon_active_limits->limits->field != 0 && (value) > Jacon_active_limits->limits->field)
+
+/**
+ * Account size bytes against the allocation limit, false once it is exceeded
+ */
+bool
+Jacon_reserve_bytes(size_t size)
+{
+    if (Jacon_active_limits == NULL) return true;
+    if (Jacon_over_limit(max_allocated_bytes, Jacon_active_limits->allocated + size)) {
+        Jacon_active_limits->memory_exceeded = true;
+        return false;
+    }
+    Jacon_active_limits->allocated += size;
+    return true;
+}
+
+/**
+ * Whether the allocation limit of the running parse made an allocation fail
+ */
+bool
+Jacon_memory_exceeded(void)
+{
+    return Jacon_active_limits != NULL && Jacon_active_limits->memory_exceeded;
+}
+
+void*
+Jacon_malloc(size_t size)
+{
+    JACON_STAT_ADD(allocations, 1);
+    JACON_STAT_ADD(bytes_allocated, size);
+    if (!Jacon_reserve_bytes(size)) return NULL;
+    const Jacon_Allocator* allocator = Jacon_active_allocator();
+    if (allocator == NULL) return malloc(size);
+    return allocator->allocate(allocator->ctx, size);
+}
+
+void*
+Jacon_calloc(size_t count, size_t size)
+{
+    JACON_STAT_ADD(allocations, 1);
+    JACON_STAT_ADD(bytes_allocated, count * size);
+    if (size != 0 && count > SIZE_MAX / size) return NULL;
+    if (!Jacon_reserve_bytes(count * size)) return NULL;
+    const Jacon_Allocator* allocator = Jacon_active_allocator();
+    if (allocator == NULL) return calloc(count, size);
+    void* ptr = allocator->allocate(allocator->ctx, count * size);
+    if (ptr != NULL) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void*
+Jacon_realloc(void* ptr, size_t size)
+{
+    JACON_STAT_ADD(allocations, 1);
+    JACON_STAT_ADD(bytes_allocated, size);
+    if (!Jacon_reserve_bytes(size)) return NULL;
+    const Jacon_Allocator* allocator = Jacon_active_allocator();
+    if (allocator == NULL) return realloc(ptr, size);
+    return allocator->reallocate(allocator->ctx, ptr, size);
+}
+
+void
+Jacon_free(void* ptr)
+{
+    if (ptr == NULL) return;
+    const Jacon_Allocator* allocator = Jacon_active_allocator();
+    if (allocator == NULL) {
+        free(ptr);
+        return;
+    }
+    allocator->deallocate(allocator->ctx, ptr);
+}
+
+char*
+Jacon_strndup(const char* str, size_t size)
+{
+    size_t len = strnlen(str, size);
+    char* copy = Jacon_malloc(len + 1);
+    if (copy == NULL) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char*
+Jacon_strdup(const char* str)
+{
+    return Jacon_strndup(str, strlen(str));
+}
 
-#define Jacon_str_append_null(builder, ...) Jacon_str_append(builder, __VA_ARGS__, NULL)
-#define Jacon_str_append_fmt_null(builder, ...) Jacon_str_append_fmt(builder, __VA_ARGS__, NULL)
 #define Jacon_defer_return(value) do { ret = (value); goto defer; } while (0)
 
 const char* Jacon_tmp_str(const char *fmt, ...)
@@ -39,11 +238,11 @@ Jacon_str_append(Jacon_StringBuilder* builder, ...)
             if (builder->count + size + 1 > builder->capacity)
             {
                 size_t new_capacity = builder->count + size + 1;
-                builder->string = realloc(builder->string, new_capacity);
+                builder->string = Jacon_realloc(builder->string, new_capacity);
                 if (builder->string == NULL) return JACON_ERR_MEMORY_ALLOCATION;
                 builder->capacity = new_capacity;
             }
-            strncpy(builder->string + builder->count, arg, size);
+            memcpy(builder->string + builder->count, arg, size);
             builder->count += size;
             builder->string[builder->count] = '\0';
         }
@@ -73,7 +272,7 @@ Jacon_str_append_fmt(Jacon_StringBuilder* builder, const char* fmt, ...)
     size = (size_t) n + 1;
     if (builder->capacity < builder->count + size) {
         size_t new_capacity = builder->count + size;
-        char* tmp = realloc(builder->string, new_capacity);
+        char* tmp = Jacon_realloc(builder->string, new_capacity);
         if (tmp == NULL) {
             return JACON_ERR_MEMORY_ALLOCATION;
         }
@@ -94,14 +293,120 @@ Jacon_str_append_fmt(Jacon_StringBuilder* builder, const char* fmt, ...)
     return JACON_OK;
 } 
 
+Jacon_Error
+Jacon_str_reserve(Jacon_StringBuilder* builder, size_t size)
+{
+    if (builder == NULL) {
+        return JACON_ERR_NULL_PARAM;
+    }
+    // One more byte for the terminating NUL
+    if (builder->count + size + 1 <= builder->capacity) return JACON_OK;
+    size_t new_capacity = builder->capacity < 64 ? 64 : builder->capacity;
+    while (new_capacity < builder->count + size + 1) new_capacity *= 2;
+    char* tmp = Jacon_realloc(builder->string, new_capacity);
+    if (tmp == NULL) {
+        return JACON_ERR_MEMORY_ALLOCATION;
+    }
+    builder->string = tmp;
+    builder->capacity = new_capacity;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_str_append_n(Jacon_StringBuilder* builder, const char* data, size_t size)
+{
+    Jacon_Error ret = Jacon_str_reserve(builder, size);
+    if (ret != JACON_OK) return ret;
+    memcpy(builder->string + builder->count, data, size);
+    builder->count += size;
+    builder->string[builder->count] = '\0';
+    return JACON_OK;
+}
+
+/**
+ * Write value in buffer, returns the written size
+ */
+size_t
+Jacon_format_int64(char buffer[20], int64_t value)
+{
+    char digits[20];
+    size_t size = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        digits[size++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    size_t written = 0;
+    if (value < 0) buffer[written++] = '-';
+    while (size > 0) buffer[written++] = digits[--size];
+    return written;
+}
+
+/**
+ * Shortest representation that reads back to the same double,
+ * non finite values have no Json form and are written as null
+ */
+size_t
+Jacon_format_double(char buffer[32], double value)
+{
+    if (!isfinite(value)) {
+        memcpy(buffer, "null", 4);
+        return 4;
+    }
+    int size = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        size = snprintf(buffer, 32, "%.*g", precision, value);
+        if (strtod(buffer, NULL) == value) break;
+    }
+    return size;
+}
+
+size_t
+Jacon_format_float(char buffer[32], float value)
+{
+    if (!isfinite(value)) {
+        memcpy(buffer, "null", 4);
+        return 4;
+    }
+    int size = 0;
+    for (int precision = 6; precision <= 9; precision++) {
+        size = snprintf(buffer, 32, "%.*g", precision, value);
+        if (strtof(buffer, NULL) == value) break;
+    }
+    return size;
+}
+
+Jacon_Error
+Jacon_str_append_int64(Jacon_StringBuilder* out, int64_t value)
+{
+    char buffer[20];
+    return Jacon_str_append_n(out, buffer, Jacon_format_int64(buffer, value));
+}
+
+Jacon_Error
+Jacon_json_write_double(Jacon_StringBuilder* out, double value)
+{
+    char buffer[32];
+    return Jacon_str_append_n(out, buffer, Jacon_format_double(buffer, value));
+}
+
+Jacon_Error
+Jacon_json_write_float(Jacon_StringBuilder* out, float value)
+{
+    char buffer[32];
+    return Jacon_str_append_n(out, buffer, Jacon_format_float(buffer, value));
+}
+
 void
 Jacon_str_free(Jacon_StringBuilder *builder)
 {
     if (builder->string != NULL) 
     {
-        free(builder->string);
+        Jacon_free(builder->string);
         builder->string = NULL;
     }
+    builder->count = 0;
+    builder->capacity = 0;
 }
 
 /**
@@ -126,13 +431,13 @@ Jacon_hash(unsigned char *str)
 Jacon_HashMapEntry*
 Jacon_create_mapentry(const char* key, void* value)
 {
-    Jacon_HashMapEntry* entry = calloc(1, sizeof(Jacon_HashMapEntry));
+    Jacon_HashMapEntry* entry = Jacon_calloc(1, sizeof(Jacon_HashMapEntry));
     if (entry == NULL) {
         return NULL;
     }
-    entry->key = strdup(key);
+    entry->key = Jacon_strdup(key);
     if (entry->key == NULL) {
-        free(entry);
+        Jacon_free(entry);
         return NULL;
     }
     entry->value = value;
@@ -143,9 +448,10 @@ Jacon_create_mapentry(const char* key, void* value)
 Jacon_Error
 Jacon_hm_resize(Jacon_HashMap* map)
 {
+    JACON_STAT_ADD(map_resizes, 1);
     Jacon_HashMap tmp = {0};
     tmp.size = map->size * JACON_MAP_RESIZE_FACTOR;
-    tmp.entries = calloc(tmp.size, sizeof(Jacon_HashMapEntry*));
+    tmp.entries = Jacon_calloc(tmp.size, sizeof(Jacon_HashMapEntry*));
     if(tmp.entries == NULL) {
         return JACON_ERR_MEMORY_ALLOCATION;
     }
@@ -165,12 +471,12 @@ Jacon_hm_resize(Jacon_HashMap* map)
         Jacon_HashMapEntry* entry = map->entries[i];
         while (entry != NULL) {
             Jacon_HashMapEntry* next = entry->next_entry;
-            free(entry->key);
-            free(entry);
+            Jacon_free(entry->key);
+            Jacon_free(entry);
             entry = next;
         }
     }
-    free(map->entries);
+    Jacon_free(map->entries);
     map->entries = NULL;
     *map = tmp;
     return JACON_OK;
@@ -189,11 +495,13 @@ Jacon_hm_get(Jacon_HashMap* map, const char* key)
     Jacon_HashMapEntry* current = map->entries[index];
     while (current != NULL) {
         if (strcmp(current->key, key) == 0) {
+            JACON_STAT_ADD(lookup_hits, 1);
             return current->value;
         }
         current = current->next_entry;
     }
 
+    JACON_STAT_ADD(lookup_misses, 1);
     return NULL;
 }
 
@@ -254,8 +562,8 @@ Jacon_hm_remove(Jacon_HashMap* map, const char* key){
             } else {
                 prev->next_entry = current->next_entry;
             }
-            free(current->key);
-            free(current);
+            Jacon_free(current->key);
+            Jacon_free(current);
             map->entries_count--;
             return value;
         }
@@ -266,6 +574,65 @@ Jacon_hm_remove(Jacon_HashMap* map, const char* key){
     return NULL;
 }
 
+/**
+ * Grow map so count more entries fit without resizing, the entries are linked again, not copied
+ */
+Jacon_Error
+Jacon_hm_reserve(Jacon_HashMap* map, size_t count)
+{
+    size_t size = map->size;
+    while (size < map->entries_count + count + 1) size *= JACON_MAP_RESIZE_FACTOR;
+    if (size == map->size) return JACON_OK;
+    Jacon_HashMapEntry** entries = Jacon_calloc(size, sizeof(Jacon_HashMapEntry*));
+    if (entries == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    JACON_STAT_ADD(map_resizes, 1);
+    for (size_t i = 0; i < map->size; i++) {
+        Jacon_HashMapEntry* entry = map->entries[i];
+        while (entry != NULL) {
+            Jacon_HashMapEntry* next = entry->next_entry;
+            size_t index = Jacon_hash((unsigned char*)entry->key) % size;
+            entry->next_entry = entries[index];
+            entries[index] = entry;
+            entry = next;
+        }
+    }
+    Jacon_free(map->entries);
+    map->entries = entries;
+    map->size = size;
+    return JACON_OK;
+}
+
+/**
+ * Move every entry of from into map as Jacon_hm_put would, from is left empty.
+ * Nothing is allocated once map has room for them (see Jacon_hm_reserve).
+ */
+void
+Jacon_hm_move(Jacon_HashMap* map, Jacon_HashMap* from)
+{
+    for (size_t i = 0; i < from->size; i++) {
+        Jacon_HashMapEntry* entry = from->entries[i];
+        while (entry != NULL) {
+            Jacon_HashMapEntry* next = entry->next_entry;
+            size_t index = Jacon_hash((unsigned char*)entry->key) % map->size;
+            Jacon_HashMapEntry* current = map->entries[index];
+            while (current != NULL && strcmp(current->key, entry->key) != 0) current = current->next_entry;
+            if (current != NULL) {
+                if (current->value != NULL) Jacon_free_node(current->value);
+                current->value = entry->value;
+                Jacon_free(entry->key);
+                Jacon_free(entry);
+            } else {
+                entry->next_entry = map->entries[index];
+                map->entries[index] = entry;
+                map->entries_count++;
+            }
+            entry = next;
+        }
+        from->entries[i] = NULL;
+    }
+    from->entries_count = 0;
+}
+
 void
 Jacon_hm_free_entry(Jacon_HashMapEntry* entry)
 {
@@ -273,14 +640,14 @@ Jacon_hm_free_entry(Jacon_HashMapEntry* entry)
         return;
     }
     if (entry->key != NULL) {
-        free(entry->key);
+        Jacon_free(entry->key);
         entry->key = NULL;
     }
     if (entry->value != NULL) {
         Jacon_free_node(entry->value);
         entry->value = NULL;
     }
-    free(entry);
+    Jacon_free(entry);
 }
 
 void 
@@ -296,7 +663,7 @@ Jacon_hm_free(Jacon_HashMap* map)
             entry = next;
         }
     }
-    free(map->entries);
+    Jacon_free(map->entries);
     map->entries = NULL;
 }
 
@@ -306,13 +673,13 @@ Jacon_hm_free(Jacon_HashMap* map)
 Jacon_HashSetEntry*
 Jacon_create_setentry(const char* key)
 {
-    Jacon_HashSetEntry* entry = calloc(1, sizeof(Jacon_HashSetEntry));
+    Jacon_HashSetEntry* entry = Jacon_calloc(1, sizeof(Jacon_HashSetEntry));
     if (entry == NULL) {
         return NULL;
     }
-    entry->key = strdup(key);
+    entry->key = Jacon_strdup(key);
     if (entry->key == NULL) {
-        free(entry);
+        Jacon_free(entry);
         return NULL;
     }
     entry->next = NULL;
@@ -324,7 +691,7 @@ Jacon_hs_resize(Jacon_HashSet* set)
 {
     Jacon_HashSet tmp = {0};
     tmp.capacity = set->capacity * JACON_MAP_RESIZE_FACTOR;
-    tmp.entries = calloc(tmp.capacity, sizeof(Jacon_HashSetEntry*));
+    tmp.entries = Jacon_calloc(tmp.capacity, sizeof(Jacon_HashSetEntry*));
     if(tmp.entries == NULL) {
         return JACON_ERR_MEMORY_ALLOCATION;
     }
@@ -414,10 +781,10 @@ Jacon_hs_free_entry(Jacon_HashSetEntry* entry)
         return;
     }
     if (entry->key != NULL) {
-        free(entry->key);
+        Jacon_free(entry->key);
         entry->key = NULL;
     }
-    free(entry);
+    Jacon_free(entry);
 }
 
 void 
@@ -433,7 +800,7 @@ Jacon_hs_free(Jacon_HashSet* set)
             entry = next;
         }
     }
-    free(set->entries);
+    Jacon_free(set->entries);
     set->entries = NULL;
 }
 
@@ -506,6 +873,9 @@ Jacon_print_token(const Jacon_Token* token)
         case JACON_TOKEN_COMMA:
             printf("Token Type: COMMA\n");
             break;
+        case JACON_TOKEN_NUMBER:
+            printf("Token Type: NUMBER, Value: %s\n", token->string_val);
+            break;
         default:
             printf("Unknown Token Type\n");
             break;
@@ -545,6 +915,9 @@ Jacon_print_node_value(Jacon_Value value, Jacon_ValueType type)
         case JACON_VALUE_NULL:
             printf("null");
             break;
+        case JACON_VALUE_NUMBER:
+            printf("%s", value.string_val);
+            break;
         case JACON_VALUE_OBJECT:
         case JACON_VALUE_ARRAY:
             break;
@@ -600,6 +973,7 @@ Jacon_print_node(Jacon_Node* node, int indent)
         case JACON_VALUE_DOUBLE:
         case JACON_VALUE_BOOLEAN:
         case JACON_VALUE_NULL:
+        case JACON_VALUE_NUMBER:
         default:
             Jacon_print_node_value(node->value, node->type);
             break;
@@ -609,46 +983,72 @@ Jacon_print_node(Jacon_Node* node, int indent)
 Jacon_Error
 Jacon_tokenizer_init(Jacon_Tokenizer* tokenizer)
 {
-    tokenizer->tokens = (Jacon_Token*)calloc(
+    tokenizer->tokens = (Jacon_Token*)Jacon_calloc(
         JACON_TOKENIZER_DEFAULT_CAPACITY, sizeof(Jacon_Token));
     if (tokenizer->tokens == NULL) {
-        perror("Jacon_append_token array alloc error");
+        // Hitting the limit leaves errno untouched, there is no system error to print
+        if (!Jacon_memory_exceeded()) perror("Jacon_append_token array alloc error");
         return JACON_ERR_MEMORY_ALLOCATION;
     }
     tokenizer->capacity = JACON_TOKENIZER_DEFAULT_CAPACITY;
     tokenizer->count = 0;
+    tokenizer->raw_numbers = false;
     return JACON_OK;
 }
 
 Jacon_Error
-Jacon_init_content(Jacon_content* content)
+Jacon_init_content_with_allocator(Jacon_content* content, const Jacon_Allocator* allocator)
 {
     // int ret;
-    content->root = (Jacon_Node*)calloc(1, sizeof(Jacon_Node));
-    if (content->root == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    content->allocator = allocator;
+    content->raw_numbers = false;
+    const Jacon_Allocator* previous = Jacon_push_allocator(allocator);
+    content->root = (Jacon_Node*)Jacon_calloc(1, sizeof(Jacon_Node));
     // ret = Jacon_hm_create(&content->entries, 10);
     content->entries = (Jacon_HashMap){
-        .entries = calloc(10, sizeof(Jacon_HashMapEntry*)),
+        .entries = Jacon_calloc(10, sizeof(Jacon_HashMapEntry*)),
         .size = 10
     };
+    Jacon_pop_allocator(previous);
+    if (content->root == NULL) return JACON_ERR_MEMORY_ALLOCATION;
     // if (ret != JACON_OK) return ret;
     return JACON_OK;
 }
 
+Jacon_Error
+Jacon_init_content(Jacon_content* content)
+{
+    return Jacon_init_content_with_allocator(content, NULL);
+}
+
 void
 Jacon_free_tokenizer(Jacon_Tokenizer* tokenizer)
 {
     for (size_t i = 0; i < tokenizer->count; i++)
     {
-        if (tokenizer->tokens[i].type == JACON_TOKEN_STRING)
-            free(tokenizer->tokens[i].string_val);
+        if (tokenizer->tokens[i].type == JACON_TOKEN_STRING || tokenizer->tokens[i].type == JACON_TOKEN_NUMBER)
+            Jacon_free(tokenizer->tokens[i].string_val);
     }
     if (tokenizer->tokens) {
-        free(tokenizer->tokens);
+        Jacon_free(tokenizer->tokens);
         tokenizer->tokens = NULL;
     }
 }
 
+/**
+ * Drop the tokens of a tokenizer but keep its allocated capacity
+ */
+void
+Jacon_reset_tokenizer(Jacon_Tokenizer* tokenizer)
+{
+    for (size_t i = 0; i < tokenizer->count; i++)
+    {
+        if (tokenizer->tokens[i].type == JACON_TOKEN_STRING || tokenizer->tokens[i].type == JACON_TOKEN_NUMBER)
+            Jacon_free(tokenizer->tokens[i].string_val);
+    }
+    tokenizer->count = 0;
+}
+
 Jacon_Node* 
 Jacon_duplicate_node(const Jacon_Node* node) 
 {
@@ -656,74 +1056,128 @@ Jacon_duplicate_node(const Jacon_Node* node)
         return NULL;
     }
 
-    Jacon_Node* new_node = (Jacon_Node*)calloc(1, sizeof(Jacon_Node));
+    Jacon_Node* new_node = (Jacon_Node*)Jacon_calloc(1, sizeof(Jacon_Node));
     if (new_node == NULL) {
         return NULL;
     }
 
     new_node->parent = node->parent;
-    new_node->name = node->name ? strdup(node->name) : NULL;
     new_node->type = node->type;
+    new_node->value = node->value;
+    if (node->name != NULL) {
+        new_node->name = Jacon_strdup(node->name);
+        if (new_node->name == NULL) goto fail;
+    }
 
     switch (node->type) {
         case JACON_VALUE_STRING:
-            new_node->value.string_val = node->value.string_val ? strdup(node->value.string_val) : NULL;
+        case JACON_VALUE_NUMBER:
+            if (node->value.string_val != NULL) {
+                new_node->value.string_val = Jacon_strdup(node->value.string_val);
+                if (new_node->value.string_val == NULL) goto fail;
+            }
             break;
         case JACON_VALUE_INT:
-            new_node->value.int_val = node->value.int_val;
-            break;
         case JACON_VALUE_FLOAT:
-            new_node->value.float_val = node->value.float_val;
-            break;
         case JACON_VALUE_DOUBLE:
-            new_node->value.double_val = node->value.double_val;
-            break;
         case JACON_VALUE_BOOLEAN:
-            new_node->value.bool_val = node->value.bool_val;
-            break;
         case JACON_VALUE_NULL:
-            // No additional data to copy
             break;
         case JACON_VALUE_ARRAY:
         case JACON_VALUE_OBJECT:
-            new_node->child_count = node->child_count;
+            if (node->child_capacity == 0) break;
+            new_node->childs = Jacon_calloc(node->child_capacity, sizeof(Jacon_Node*));
+            if (new_node->childs == NULL) goto fail;
             new_node->child_capacity = node->child_capacity;
-            new_node->childs = calloc(new_node->child_capacity, sizeof(Jacon_Node*));
-            if (new_node->childs == NULL) {
-                free(new_node->name);
-                new_node->name = NULL;
-                free(new_node);
-                new_node = NULL;
-                return NULL;
-            }
             for (size_t i = 0; i < node->child_count; i++) {
                 new_node->childs[i] = Jacon_duplicate_node(node->childs[i]);
                 if (new_node->childs[i] == NULL) {
-                    for (size_t j = 0; j < i; j++) {
-                        Jacon_free_node(new_node->childs[j]);
-                    }
-                    free(new_node->childs);
-                    free(new_node->name);
-                    free(new_node);
+                    Jacon_free_node(new_node);
                     return NULL;
                 }
                 new_node->childs[i]->parent = new_node;
+                new_node->child_count++;
             }
             break;
     }
+    return new_node;
+
+fail:
+    Jacon_free(new_node->name);
+    Jacon_free(new_node);
+    return NULL;
+}
+
+Jacon_Node*
+Jacon_share_node(const Jacon_Node* node)
+{
+    if (node == NULL) {
+        return NULL;
+    }
+
+    Jacon_Node* new_node = (Jacon_Node*)Jacon_calloc(1, sizeof(Jacon_Node));
+    if (new_node == NULL) {
+        return NULL;
+    }
+
+    new_node->parent = node->parent;
+    new_node->type = node->type;
+    new_node->value = node->value;
+    if (node->name != NULL) {
+        new_node->name = Jacon_strdup(node->name);
+        if (new_node->name == NULL) goto fail;
+    }
 
+    switch (node->type) {
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_NUMBER:
+            if (node->value.string_val != NULL) {
+                new_node->value.string_val = Jacon_strdup(node->value.string_val);
+                if (new_node->value.string_val == NULL) goto fail;
+            }
+            break;
+        case JACON_VALUE_INT:
+        case JACON_VALUE_FLOAT:
+        case JACON_VALUE_DOUBLE:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+            break;
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+            if (node->child_capacity == 0) break;
+            new_node->childs = Jacon_calloc(node->child_capacity, sizeof(Jacon_Node*));
+            if (new_node->childs == NULL) goto fail;
+            new_node->child_capacity = node->child_capacity;
+            // Childs are shared, they are copied once written through Jacon_unshare_child
+            for (size_t i = 0; i < node->child_count; i++) {
+                __atomic_add_fetch(&node->childs[i]->ref_count, 1, __ATOMIC_RELAXED);
+                new_node->childs[i] = node->childs[i];
+            }
+            new_node->child_count = node->child_count;
+            break;
+    }
     return new_node;
+
+fail:
+    Jacon_free(new_node->name);
+    Jacon_free(new_node);
+    return NULL;
 }
 
 void
 Jacon_free_node(Jacon_Node* node)
 {
+    // Dropping a reference, the last owner (ref_count 0 before the decrement) frees
+    if (__atomic_load_n(&node->ref_count, __ATOMIC_ACQUIRE) != 0
+        && __atomic_fetch_sub(&node->ref_count, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
     if (node->name != NULL) {
-        free(node->name);
+        Jacon_free(node->name);
         node->name = NULL;
     }
-    if (node->type == JACON_VALUE_STRING && node->value.string_val != NULL) {
-        free(node->value.string_val);
+    if ((node->type == JACON_VALUE_STRING || node->type == JACON_VALUE_NUMBER) && node->value.string_val != NULL) {
+        Jacon_free(node->value.string_val);
         node->value.string_val = NULL;
     }
     if (node->type == JACON_VALUE_ARRAY || node->type == JACON_VALUE_OBJECT) {
@@ -732,31 +1186,96 @@ Jacon_free_node(Jacon_Node* node)
             Jacon_free_node(node->childs[i]);
             node->childs[i] = NULL;
         }
-        free(node->childs);
+        Jacon_free(node->childs);
         node->childs = NULL;
     }
-    free(node);
+    Jacon_free(node);
     node = NULL;
 }
 
+Jacon_Node*
+Jacon_unshare_child(Jacon_Node* parent, size_t index)
+{
+    if (parent == NULL || index >= parent->child_count) return NULL;
+    Jacon_Node* child = parent->childs[index];
+    if (__atomic_load_n(&child->ref_count, __ATOMIC_ACQUIRE) == 0) {
+        // Its parent may still be a former owner, parent is the only one left
+        child->parent = parent;
+        return child;
+    }
+
+    Jacon_Node* copy = Jacon_share_node(child);
+    if (copy == NULL) return NULL;
+    copy->parent = parent;
+    // The childs may outlive child, they are shared so other threads can store their parent too
+    for (size_t i = 0; i < copy->child_count; i++) {
+        __atomic_store_n(&copy->childs[i]->parent, copy, __ATOMIC_RELAXED);
+    }
+    parent->childs[index] = copy;
+    // Drops the reference parent held, frees child if the other owners are gone meanwhile
+    Jacon_free_node(child);
+    return copy;
+}
+
+/**
+ * Jacon_unshare_path telling a missing member (JACON_ERR_KEY_NOT_FOUND) from a failed copy
+ */
+Jacon_Error
+Jacon_unshare_path_node(Jacon_Node* root, const char* path, Jacon_Node** result)
+{
+    Jacon_Node* node = root;
+    const char* name = path;
+    while (*name != '\0') {
+        const char* dot = strchr(name, '.');
+        size_t size = dot != NULL ? (size_t)(dot - name) : strlen(name);
+        if (node->type != JACON_VALUE_OBJECT) return JACON_ERR_KEY_NOT_FOUND;
+        // Last matching member, as the path index does with duplicates
+        size_t found = node->child_count;
+        for (size_t i = 0; i < node->child_count; i++) {
+            const char* child_name = node->childs[i]->name;
+            if (child_name != NULL && strncmp(child_name, name, size) == 0 && child_name[size] == '\0') found = i;
+        }
+        if (found == node->child_count) return JACON_ERR_KEY_NOT_FOUND;
+        node = Jacon_unshare_child(node, found);
+        if (node == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        if (dot == NULL) break;
+        name = dot + 1;
+    }
+    *result = node;
+    return JACON_OK;
+}
+
+Jacon_Node*
+Jacon_unshare_path(Jacon_Node* root, const char* path)
+{
+    if (root == NULL || path == NULL) return NULL;
+
+    Jacon_Node* node = NULL;
+    return Jacon_unshare_path_node(root, path, &node) == JACON_OK ? node : NULL;
+}
+
 Jacon_Error
 Jacon_append_token(Jacon_Tokenizer* tokenizer, Jacon_Token token)
 {
     if (tokenizer == NULL) {
         return JACON_ERR_NULL_PARAM;
     }
+    if (Jacon_over_limit(max_tokens, tokenizer->count + 1)) return JACON_ERR_TOKEN_LIMIT;
 
     size_t new_count = tokenizer->count + 1;
     if (new_count > tokenizer->capacity) {
         size_t new_capacity = tokenizer->capacity == 0 ?
             JACON_TOKENIZER_DEFAULT_CAPACITY : tokenizer->capacity * 2;
-        tokenizer->tokens = realloc(tokenizer->tokens, new_capacity * sizeof(Jacon_Token));
-        if (!tokenizer->tokens) {
+        // The tokens stay owned by the tokenizer when growing fails
+        Jacon_Token* tokens = Jacon_realloc(tokenizer->tokens, new_capacity * sizeof(Jacon_Token));
+        if (!tokens) {
             return JACON_ERR_MEMORY_ALLOCATION;
         }
+        tokenizer->tokens = tokens;
         tokenizer->capacity = new_capacity;
     }
     tokenizer->tokens[tokenizer->count++] = token;
+    JACON_STAT_ADD(tokens, 1);
     return JACON_OK;
 }
 
@@ -772,11 +1291,12 @@ Jacon_append_child(Jacon_Node* node, Jacon_Node* child)
         size_t new_capacity = node->child_capacity == 0 ?
             JACON_NODE_DEFAULT_CHILD_CAPACITY : 
             node->child_capacity * JACON_NODE_DEFAULT_RESIZE_FACTOR;
-        node->childs = realloc(node->childs, new_capacity * sizeof(Jacon_Node*));
-        if (!node->childs) {
-            perror("Jacon_append_node_child array alloc error");
+        Jacon_Node** childs = Jacon_realloc(node->childs, new_capacity * sizeof(Jacon_Node*));
+        if (!childs) {
+            if (!Jacon_memory_exceeded()) perror("Jacon_append_node_child array alloc error");
             return JACON_ERR_MEMORY_ALLOCATION;
         }
+        node->childs = childs;
         node->child_capacity = new_capacity;
     }
     node->childs[node->child_count++] = child;
@@ -854,50 +1374,364 @@ Jacon_is_whitespace(char c)
     return c == ' ' || c == '\r' || c == '\t' || c == '\n';
 }
 
-Jacon_Error
-Jacon_validate_string(const char* str)
+/**
+ * Index of the first quote, backslash or control character in the len bytes of str,
+ * len if there is none.
+ */
+size_t
+Jacon_find_string_special(const char* str, size_t len)
 {
-    const char *ptr = str;
-    while (*ptr) {
-        if (*ptr == '\n'
-            || *ptr == '\t') return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
-        else if (*ptr == '\\') {
-            ptr++;
-            if (*ptr == 'u') {
-                for (int i = 1; i < 5; ++i) {
-                    if (!Jacon_is_hex_digit(*(ptr + i))) {
-                        return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
-                    }
-                }
-                ptr += 4; // Skip valid escape sequence
-            } else if (*ptr == '"' 
-                || *ptr == '\\' 
-                || *ptr == '/' 
-                || *ptr == 'b' 
-                || *ptr == 'f' 
-                || *ptr == 'n' 
-                || *ptr == 'r' 
-                || *ptr == 't') {
-                ptr++;
-            } else {
-                return JACON_ERR_INVALID_ESCAPE_SEQUENCE; // Invalid escape sequence
-            }
-        } else {
-            ptr++; // Move to the next character
-        }
+    size_t i = 0;
+#ifdef JACON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        // Unsigned chunk <= 0x1F exactly when max(chunk, 0x1F) == 0x1F
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return i + __builtin_ctz(mask);
     }
-    return JACON_OK;
+#endif
+    for (; i < len; i++) {
+        if (str[i] == '"' || str[i] == '\\' || (unsigned char)str[i] < 0x20) return i;
+    }
+    return len;
 }
 
-Jacon_Error 
-Jacon_parse_token(Jacon_Token* token, const char** str) 
+/**
+ * Index of the first byte Jacon_str_append_escaped rewrites in the len bytes of str:
+ * quote, backslash, control character or C0 (lead of a stored zero byte), len if there is none.
+ */
+size_t
+Jacon_find_escape(const char* str, size_t len)
 {
-    switch (**str) {
-        case ',':
-            token->type = JACON_TOKEN_COMMA;
-            (*str)++;
-            break;
-        case ':':
+    size_t i = 0;
+#ifdef JACON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i zero_lead = _mm_set1_epi8((char)0xC0);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(chunk, zero_lead));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c < 0x20 || c == 0xC0) return i;
+    }
+    return len;
+}
+
+#ifdef JACON_SSSE3
+/**
+ * Lemire and Keiser lookup validation of 16 bytes, prev holds the previous block.
+ * Returns the error bits, nonzero when the block breaks a sequence.
+ */
+__m128i
+Jacon_utf8_check_block(__m128i input, __m128i prev)
+{
+    // Error classes, a byte pair is invalid when all three lookups share a bit
+    enum {
+        TOO_SHORT = 1 << 0,
+        TOO_LONG = 1 << 1,
+        OVERLONG_3 = 1 << 2,
+        TOO_LARGE = 1 << 3,
+        SURROGATE = 1 << 4,
+        OVERLONG_2 = 1 << 5,
+        TOO_LARGE_1000 = 1 << 6,
+        OVERLONG_4 = 1 << 6,
+        TWO_CONTS = 1 << 7,
+        CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+    };
+    const __m128i byte_1_high_table = _mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m128i byte_1_low_table = _mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+
+    __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, low_nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+    __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+    // Third and fourth bytes of a sequence must be continuations
+    __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+    __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+    __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+    __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must_be_continuation, special_cases);
+}
+#endif
+
+/**
+ * Check that the len bytes of str are well formed UTF-8:
+ * no overlong form, surrogate, code point above U+10FFFF nor truncated sequence.
+ */
+bool
+Jacon_utf8_valid(const char* str, size_t len)
+{
+    size_t i = 0;
+#ifdef JACON_SSSE3
+    __m128i prev = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i*)(str + i));
+        // Ascii blocks only need the previous one to be complete
+        if (_mm_movemask_epi8(input) == 0 && _mm_movemask_epi8(prev) == 0) continue;
+        error = _mm_or_si128(error, Jacon_utf8_check_block(input, prev));
+        prev = input;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) return false;
+    // The zero padded tail catches sequences cut by the end of the input
+    char tail[16] = {0};
+    memcpy(tail, str + i, len - i);
+    error = Jacon_utf8_check_block(_mm_loadu_si128((const __m128i*)tail), prev);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+#else
+    const unsigned char* data = (const unsigned char*)str;
+    while (i < len) {
+        unsigned char c = data[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t size;
+        uint32_t code_point;
+        if (c >= 0xC2 && c <= 0xDF) {
+            size = 2;
+            code_point = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            size = 3;
+            code_point = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            size = 4;
+            code_point = c & 0x07;
+        } else {
+            return false;
+        }
+        if (len - i < size) return false;
+        for (size_t k = 1; k < size; k++) {
+            if ((data[i + k] & 0xC0) != 0x80) return false;
+            code_point = (code_point << 6) | (data[i + k] & 0x3F);
+        }
+        if ((size == 3 && code_point < 0x800) || (size == 4 && code_point < 0x10000)
+            || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) return false;
+        i += size;
+    }
+    return true;
+#endif
+}
+
+bool
+Jacon_read_hex4(const char* str, const char* end, uint32_t* value)
+{
+    if (end - str < 4) return false;
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = str[i];
+        if (!Jacon_is_hex_digit(c)) return false;
+        *value = (*value << 4) | (uint32_t)(isdigit((unsigned char)c) ? c - '0' : tolower(c) - 'a' + 10);
+    }
+    return true;
+}
+
+/**
+ * Write code point as UTF-8, returns the number of bytes written
+ */
+size_t
+Jacon_encode_utf8(uint32_t code_point, char* out)
+{
+    if (code_point < 0x80) {
+        out[0] = (char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (char)(0xC0 | (code_point >> 6));
+        out[1] = (char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = (char)(0xE0 | (code_point >> 12));
+        out[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code_point >> 18));
+    out[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+/**
+ * Decode the escape sequences of the size bytes of str into out, which must hold size bytes.
+ * *written receives the decoded size. Lone surrogates become U+FFFD, \u0000 becomes
+ * the two bytes C0 80 when modified_nul is set so the result stays a C string.
+ * Raw runs are checked to be UTF-8 unless JACON_NO_UTF8_VALIDATION is defined.
+ */
+Jacon_Error
+Jacon_unescape(const char* str, size_t size, char* out, bool modified_nul, size_t* written)
+{
+    const char* end = str + size;
+    char* start = out;
+
+    while (str < end) {
+        size_t run = Jacon_find_string_special(str, end - str);
+        if (run < (size_t)(end - str) && str[run] != '\\') return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
+#ifndef JACON_NO_UTF8_VALIDATION
+        if (!Jacon_utf8_valid(str, run)) return JACON_ERR_INVALID_UTF8;
+#endif
+        memcpy(out, str, run);
+        out += run;
+        str += run;
+        if (str == end) break;
+
+        if (++str == end) return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
+        switch (*str++) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                uint32_t code_point;
+                uint32_t low;
+                if (!Jacon_read_hex4(str, end, &code_point)) return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
+                str += 4;
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    if (end - str >= 6 && str[0] == '\\' && str[1] == 'u'
+                        && Jacon_read_hex4(str + 2, end, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                        str += 6;
+                    } else {
+                        code_point = 0xFFFD;
+                    }
+                } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    code_point = 0xFFFD;
+                }
+                if (code_point == 0 && modified_nul) {
+                    *out++ = (char)0xC0;
+                    *out++ = (char)0x80;
+                } else {
+                    out += Jacon_encode_utf8(code_point, out);
+                }
+                break;
+            }
+            default:
+                return JACON_ERR_INVALID_ESCAPE_SEQUENCE;
+        }
+    }
+    *written = out - start;
+    return JACON_OK;
+}
+
+/**
+ * Append the unescaped content of a raw Json string of size bytes.
+ * Raw control characters are rejected, \u0000 gives a zero byte.
+ */
+Jacon_Error
+Jacon_str_append_unescaped(Jacon_StringBuilder* builder, const char* str, size_t size)
+{
+    // Unescaping never makes a string longer
+    Jacon_Error ret = Jacon_str_reserve(builder, size);
+    if (ret != JACON_OK) return ret;
+    size_t written;
+    ret = Jacon_unescape(str, size, builder->string + builder->count, false, &written);
+    if (ret != JACON_OK) return ret;
+    builder->count += written;
+    builder->string[builder->count] = '\0';
+    return JACON_OK;
+}
+
+/**
+ * Length of the Json number in the len bytes of str, 0 if there is none.
+ * integral is set when the number has neither fraction nor exponent.
+ */
+size_t
+Jacon_scan_number_n(const char* str, size_t len, bool* integral)
+{
+#define JACON_PEEK (i < len ? str[i] : '\0')
+    size_t i = 0;
+    if (JACON_PEEK == '-') i++;
+    if (JACON_PEEK == '0') i++;
+    else if (JACON_PEEK >= '1' && JACON_PEEK <= '9') while (isdigit((unsigned char)JACON_PEEK)) i++;
+    else return 0;
+    *integral = true;
+    if (JACON_PEEK == '.') {
+        i++;
+        if (!isdigit((unsigned char)JACON_PEEK)) return 0;
+        while (isdigit((unsigned char)JACON_PEEK)) i++;
+        *integral = false;
+    }
+    if (JACON_PEEK == 'e' || JACON_PEEK == 'E') {
+        i++;
+        if (JACON_PEEK == '+' || JACON_PEEK == '-') i++;
+        if (!isdigit((unsigned char)JACON_PEEK)) return 0;
+        while (isdigit((unsigned char)JACON_PEEK)) i++;
+        *integral = false;
+    }
+    return i;
+#undef JACON_PEEK
+}
+
+/**
+ * Length of the Json number starting at the null terminated str, 0 if there is none.
+ */
+size_t
+Jacon_scan_number(const char* str, bool* integral)
+{
+    return Jacon_scan_number_n(str, SIZE_MAX, integral);
+}
+
+Jacon_Error 
+Jacon_parse_token(Jacon_Token* token, const char** str) 
+{
+    switch (**str) {
+        case ',':
+            token->type = JACON_TOKEN_COMMA;
+            (*str)++;
+            break;
+        case ':':
             token->type = JACON_TOKEN_COLON;
             (*str)++;
             break;
@@ -917,32 +1751,41 @@ Jacon_parse_token(Jacon_Token* token, const char** str)
             token->type = JACON_TOKEN_ARRAY_END;
             (*str)++;
             break;
-        case '"':
+        case '"': {
             (*str)++; // Move past the initial quote
             const char* string_end = strchr(*str, '"');
             if (string_end == NULL) return JACON_ERR_CHAR_NOT_FOUND;
 
-            // While the double quote is escaped, find the next one
-            while (string_end[-1] == '\\') {
+            // While the double quote is escaped by an odd number of backslashes, find the next one
+            while (true) {
+                const char* backslash = string_end;
+                while (backslash > *str && backslash[-1] == '\\') backslash--;
+                if ((string_end - backslash) % 2 == 0) break;
                 string_end = strchr(string_end + 1, '"');
                 if (string_end == NULL) return JACON_ERR_CHAR_NOT_FOUND;
             }
             token->type = JACON_TOKEN_STRING;
             size_t string_size = string_end - *str;
-            token->string_val = (char*)calloc(string_size + 1, sizeof(char));
+            token->string_val = (char*)Jacon_malloc(string_size + 1);
             if (token->string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
 
-            strncpy(token->string_val, *str, string_size);
-            token->string_val[string_size] = '\0';
-
-            int ret = Jacon_validate_string(token->string_val);
+            // Stored decoded, the serializer escapes it back
+            size_t decoded_size;
+            Jacon_Error ret = Jacon_unescape(*str, string_size, token->string_val, true, &decoded_size);
             if (ret != JACON_OK) {
-                free(token->string_val);
+                Jacon_free(token->string_val);
                 return ret;
             }
+            token->string_val[decoded_size] = '\0';
+            if (Jacon_over_limit(max_string_length, decoded_size)) {
+                Jacon_free(token->string_val);
+                return JACON_ERR_STRING_LIMIT;
+            }
+            JACON_STAT_ADD(strings, 1);
 
             *str = string_end + 1; // Move past the closing quote
             break;
+        }
         case('n'):
             if (strncmp(*str, "null", 4) != 0) return JACON_ERR_INVALID_JSON;
             token->type = JACON_TOKEN_NULL;
@@ -980,13 +1823,12 @@ Jacon_parse_token(Jacon_Token* token, const char** str)
                     while (*p == '0') p++;
                     if (isdigit(*p)) return JACON_ERR_INVALID_JSON;
                 }
-                char* dot = strchr(*str, '.');
+                // Only look for the dot inside of the number itself
+                size_t number_len = strspn(*str, "0123456789+-.eE");
+                const char* dot = memchr(*str, '.', number_len);
                 if (dot) {
-                    // Check for leading 0, if real, check if distance between last '0' and '.' > 1
-                    char* last_zero = strrchr(*str, '0');
-                    if (last_zero && dot - last_zero > 1) return JACON_ERR_INVALID_JSON;
                     // Check if there is a dot and if so if there are numbers after
-                    char* after_dot = dot + 1;
+                    const char* after_dot = dot + 1;
                     if (!isdigit(*after_dot)) return JACON_ERR_INVALID_JSON;
                 }
                 
@@ -1025,6 +1867,39 @@ Jacon_parse_token(Jacon_Token* token, const char** str)
     return JACON_OK;
 }
 
+/**
+ * Copy the number at *str as a JACON_TOKEN_NUMBER without converting it
+ */
+Jacon_Error
+Jacon_parse_raw_number(Jacon_Token* token, const char** str)
+{
+    bool integral;
+    size_t size = Jacon_scan_number(*str, &integral);
+    if (size == 0) return JACON_ERR_INVALID_JSON;
+    char end = (*str)[size];
+    if (!Jacon_is_whitespace(end) && end != ',' && end != ']' && end != '}' && end != '\0') {
+        return JACON_ERR_INVALID_JSON;
+    }
+    token->string_val = Jacon_strndup(*str, size);
+    if (token->string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    token->type = JACON_TOKEN_NUMBER;
+    *str += size;
+    return JACON_OK;
+}
+
+/**
+ * Next token of str, numbers are left unconverted if the tokenizer asks for it
+ */
+Jacon_Error
+Jacon_next_token(const Jacon_Tokenizer* tokenizer, Jacon_Token* token, const char** str)
+{
+    if (tokenizer->raw_numbers) {
+        while (Jacon_is_whitespace(**str)) (*str)++;
+        if (**str == '-' || isdigit((unsigned char)**str)) return Jacon_parse_raw_number(token, str);
+    }
+    return Jacon_parse_token(token, str);
+}
+
 Jacon_Error 
 Jacon_tokenize(Jacon_Tokenizer* tokenizer, const char* str) 
 {
@@ -1032,16 +1907,205 @@ Jacon_tokenize(Jacon_Tokenizer* tokenizer, const char* str)
 
     while (*str) {
         Jacon_Token token = {0};
-        ret = Jacon_parse_token(&token, &str);
+        ret = Jacon_next_token(tokenizer, &token, &str);
         if (ret == JACON_END_OF_INPUT) return JACON_OK;
         if (ret != JACON_OK) return ret;
         ret = Jacon_append_token(tokenizer, token);
+        if (ret != JACON_OK) {
+            if (token.type == JACON_TOKEN_STRING || token.type == JACON_TOKEN_NUMBER) Jacon_free(token.string_val);
+            return ret;
+        }
+    }
+
+    return JACON_OK;
+}
+
+/**
+ * Tokenize a single Json value starting at *str.
+ * Stops as soon as the value is complete, *str is left right after it.
+ */
+Jacon_Error
+Jacon_tokenize_value(Jacon_Tokenizer* tokenizer, const char** str)
+{
+    Jacon_Error ret;
+    size_t depth = 0;
+
+    do {
+        Jacon_Token token = {0};
+        ret = Jacon_next_token(tokenizer, &token, str);
+        if (ret == JACON_END_OF_INPUT) return JACON_ERR_INVALID_JSON;
         if (ret != JACON_OK) return ret;
+        ret = Jacon_append_token(tokenizer, token);
+        if (ret != JACON_OK) {
+            if (token.type == JACON_TOKEN_STRING || token.type == JACON_TOKEN_NUMBER) Jacon_free(token.string_val);
+            return ret;
+        }
+
+        if (token.type == JACON_TOKEN_OBJECT_START || token.type == JACON_TOKEN_ARRAY_START) {
+            depth++;
+        }
+        else if (token.type == JACON_TOKEN_OBJECT_END || token.type == JACON_TOKEN_ARRAY_END) {
+            if (depth == 0) return JACON_ERR_INVALID_JSON;
+            depth--;
+        }
+    } while (depth > 0);
+
+    return JACON_OK;
+}
+
+const char*
+Jacon_skip_whitespace(const char* str)
+{
+    while (Jacon_is_whitespace(*str)) str++;
+    return str;
+}
+
+/**
+ * Skip a string, *str must point to its opening quote.
+ * Escaped characters are skipped as a whole so \" does not end the string.
+ */
+Jacon_Error
+Jacon_skip_string(const char** str)
+{
+    const char* ptr = *str + 1;
+    while (*ptr != '"') {
+        if (*ptr == '\0') return JACON_ERR_CHAR_NOT_FOUND;
+        if (*ptr == '\\') {
+            ptr++;
+            if (*ptr == '\0') return JACON_ERR_CHAR_NOT_FOUND;
+        }
+        ptr++;
     }
+    *str = ptr + 1;
+    return JACON_OK;
+}
+
+/**
+ * Skip a whole Json value without tokenizing it.
+ * Only quotes and brackets are matched, nothing gets allocated.
+ */
+Jacon_Error
+Jacon_skip_value(const char** str)
+{
+    Jacon_Error ret;
+    const char* ptr = Jacon_skip_whitespace(*str);
+    size_t depth = 0;
+
+    do {
+        switch (*ptr) {
+            case '\0':
+                return JACON_ERR_INVALID_JSON;
+            case '"':
+                ret = Jacon_skip_string(&ptr);
+                if (ret != JACON_OK) return ret;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                ptr++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) return JACON_ERR_INVALID_JSON;
+                depth--;
+                ptr++;
+                break;
+            default:
+                if (depth > 0) {
+                    ptr++;
+                    break;
+                }
+                // Scalar value, runs until the next delimiter
+                const char* start = ptr;
+                while (*ptr != '\0' && !Jacon_is_whitespace(*ptr)
+                    && *ptr != ',' && *ptr != '}' && *ptr != ']') ptr++;
+                if (ptr == start) return JACON_ERR_INVALID_JSON;
+                break;
+        }
+    } while (depth > 0);
+
+    *str = ptr;
+    return JACON_OK;
+}
 
+/**
+ * Append size bytes as the content of a Json string, escaping quotes,
+ * backslashes and control characters. Clean runs are copied as they are.
+ */
+Jacon_Error
+Jacon_str_append_escaped(Jacon_StringBuilder* builder, const char* str, size_t size)
+{
+    static const char hex[] = "0123456789abcdef";
+    // Most strings need no escape at all
+    Jacon_Error ret = Jacon_str_reserve(builder, size);
+    if (ret != JACON_OK) return ret;
+    const char* end = str + size;
+    while (str < end) {
+        size_t run = Jacon_find_escape(str, end - str);
+        ret = Jacon_str_append_n(builder, str, run);
+        if (ret != JACON_OK) return ret;
+        str += run;
+        if (str == end) break;
+
+        char escape[6] = { '\\', 0 };
+        size_t escape_size = 2;
+        switch (*str) {
+            case '"': escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            case (char)0xC0:
+                // Zero byte of a stored string, any other C0 lead is kept as is
+                if (end - str >= 2 && str[1] == (char)0x80) {
+                    memcpy(escape, "\\u0000", 6);
+                    escape_size = 6;
+                    str++;
+                } else {
+                    escape[0] = *str;
+                    escape_size = 1;
+                }
+                break;
+            default:
+                memcpy(escape, "\\u00", 4);
+                escape[4] = hex[(unsigned char)*str >> 4];
+                escape[5] = hex[*str & 0x0F];
+                escape_size = 6;
+                break;
+        }
+        ret = Jacon_str_append_n(builder, escape, escape_size);
+        if (ret != JACON_OK) return ret;
+        str++;
+    }
     return JACON_OK;
 }
 
+/**
+ * Append str between quotes, escaped
+ */
+Jacon_Error
+Jacon_json_write_quoted(Jacon_StringBuilder* builder, const char* str, size_t size)
+{
+    Jacon_Error ret = Jacon_str_reserve(builder, size + 2);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(builder, "\"", 1);
+    if (ret == JACON_OK) ret = Jacon_str_append_escaped(builder, str, size);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(builder, "\"", 1);
+    return ret;
+}
+
+/**
+ * Append an escaped member name followed by separator
+ */
+Jacon_Error
+Jacon_json_write_name(Jacon_StringBuilder* builder, const char* name, const char* separator)
+{
+    Jacon_Error ret = Jacon_json_write_quoted(builder, name, strlen(name));
+    if (ret == JACON_OK) ret = Jacon_str_append_n(builder, separator, strlen(separator));
+    return ret;
+}
+
 Jacon_Error
 Jacon_current_token(Jacon_Token* token, Jacon_Tokenizer* tokenizer, size_t current_index)
 {
@@ -1054,22 +2118,25 @@ Jacon_Error
 Jacon_consume_token(Jacon_Token* token, Jacon_Tokenizer* tokenizer, size_t* current_index)
 {
     if (*current_index >= tokenizer->count) return JACON_ERR_INDEX_OUT_OF_BOUND;
-    *token = tokenizer->tokens[*current_index + 1];
     *current_index += 1;
+    // Consuming the last token leaves nothing to read
+    if (*current_index < tokenizer->count)
+        *token = tokenizer->tokens[*current_index];
     return JACON_OK;
 }
 
 Jacon_Error
-Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index);
+Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index, size_t depth);
 Jacon_Error
-Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index);
+Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index, size_t depth);
 
 Jacon_Error
-Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index)
+Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index, size_t depth)
 {
     int ret = JACON_OK;
     Jacon_Token* current = NULL;
     bool last_value = false;
+    if (Jacon_over_limit(max_depth, depth)) return JACON_ERR_DEPTH_LIMIT;
     
     if (*index < tokenizer->count) {
         current = &tokenizer->tokens[*index];
@@ -1082,13 +2149,13 @@ Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index)
         switch (current->type) {
             case JACON_TOKEN_ARRAY_START:
                 (*index)++;
-                ret = Jacon_validate_array(tokenizer, index);
+                ret = Jacon_validate_array(tokenizer, index, depth + 1);
                 if (ret != JACON_OK) return ret;
                 last_value = true;
                 break;
             case JACON_TOKEN_OBJECT_START:
                 (*index)++;
-                ret = Jacon_validate_object(tokenizer, index);
+                ret = Jacon_validate_object(tokenizer, index, depth + 1);
                 if (ret != JACON_OK) return ret;
                 last_value = true;
                 break;
@@ -1110,6 +2177,7 @@ Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index)
             case JACON_TOKEN_INT:
             case JACON_TOKEN_DOUBLE:
             case JACON_TOKEN_FLOAT:
+            case JACON_TOKEN_NUMBER:
             case JACON_TOKEN_BOOLEAN:
             case JACON_TOKEN_NULL:
             default:
@@ -1128,9 +2196,11 @@ Jacon_validate_array(Jacon_Tokenizer* tokenizer, size_t* index)
 }
 
 Jacon_Error
-Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
+Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index, size_t depth)
 {
     int ret = JACON_OK;
+    size_t member_count = 0;
+    if (Jacon_over_limit(max_depth, depth)) return JACON_ERR_DEPTH_LIMIT;
     if (*index >= tokenizer->count) return JACON_ERR_INVALID_JSON;
     if (*index >= tokenizer->count) {
         return JACON_ERR_INVALID_JSON;
@@ -1138,7 +2208,7 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
     Jacon_Token* current = &tokenizer->tokens[*index];
     Jacon_Token* last = NULL;
     Jacon_HashSet names_set = (Jacon_HashSet){
-        .entries = calloc(10, sizeof(Jacon_HashSetEntry*)),
+        .entries = Jacon_calloc(10, sizeof(Jacon_HashSetEntry*)),
         .capacity = 10
     };
     if (names_set.entries == NULL) {
@@ -1153,7 +2223,7 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
                     Jacon_defer_return(JACON_ERR_INVALID_JSON);
 
                 (*index)++;
-                ret = Jacon_validate_array(tokenizer, index);
+                ret = Jacon_validate_array(tokenizer, index, depth + 1);
                 if (ret != JACON_OK) Jacon_defer_return(ret);
                 last_value = true;
                 break;
@@ -1162,7 +2232,7 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
                     Jacon_defer_return(JACON_ERR_INVALID_JSON);
 
                 (*index)++;
-                ret = Jacon_validate_object(tokenizer, index);
+                ret = Jacon_validate_object(tokenizer, index, depth + 1);
                 if (ret != JACON_OK) Jacon_defer_return(ret);
                 last_value = true;
                 break;
@@ -1187,18 +2257,26 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
                 break;
             case JACON_TOKEN_STRING:
                 if (last == NULL) {
+                    if (Jacon_over_limit(max_object_members, ++member_count)) {
+                        Jacon_defer_return(JACON_ERR_MEMBER_LIMIT);
+                    }
                     if (Jacon_hs_exists(&names_set, tokenizer->tokens[*index].string_val)) {
                         Jacon_defer_return(JACON_ERR_DUPLICATE_NAME);
                     }
-                    Jacon_hs_put(&names_set, tokenizer->tokens[*index].string_val);
+                    ret = Jacon_hs_put(&names_set, tokenizer->tokens[*index].string_val);
+                    if (ret != JACON_OK) Jacon_defer_return(ret);
                     last = &tokenizer->tokens[*index];
                     (*index)++;
                 }
                 else if (last->type == JACON_TOKEN_COMMA) {
+                    if (Jacon_over_limit(max_object_members, ++member_count)) {
+                        Jacon_defer_return(JACON_ERR_MEMBER_LIMIT);
+                    }
                     if (Jacon_hs_exists(&names_set, tokenizer->tokens[*index].string_val)) {
                         Jacon_defer_return(JACON_ERR_DUPLICATE_NAME);
                     }
-                    Jacon_hs_put(&names_set, tokenizer->tokens[*index].string_val);
+                    ret = Jacon_hs_put(&names_set, tokenizer->tokens[*index].string_val);
+                    if (ret != JACON_OK) Jacon_defer_return(ret);
                     last = &tokenizer->tokens[*index];
                     (*index)++;
                     last_value = true;
@@ -1215,6 +2293,7 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
             case JACON_TOKEN_INT:
             case JACON_TOKEN_DOUBLE:
             case JACON_TOKEN_FLOAT:
+            case JACON_TOKEN_NUMBER:
             case JACON_TOKEN_BOOLEAN:
             case JACON_TOKEN_NULL:
                 if (last == NULL || last->type != JACON_TOKEN_COLON)
@@ -1234,7 +2313,7 @@ Jacon_validate_object(Jacon_Tokenizer* tokenizer, size_t* index)
     (*index)++;
 defer:
     Jacon_hs_free(&names_set);
-    return JACON_OK;
+    return ret;
 }
 
 Jacon_Error
@@ -1245,6 +2324,7 @@ Jacon_validate_value(Jacon_Token token)
         case JACON_TOKEN_INT:
         case JACON_TOKEN_DOUBLE:
         case JACON_TOKEN_FLOAT:
+        case JACON_TOKEN_NUMBER:
         case JACON_TOKEN_BOOLEAN:
         case JACON_TOKEN_NULL:
             return JACON_OK;
@@ -1278,18 +2358,19 @@ Jacon_validate_input(Jacon_Tokenizer* tokenizer)
     switch (current->type) {
         case JACON_TOKEN_ARRAY_START:
             index++;
-            ret = Jacon_validate_array(tokenizer, &index);
+            ret = Jacon_validate_array(tokenizer, &index, 1);
             if (ret != JACON_OK) return ret;
             break;
         case JACON_TOKEN_OBJECT_START:
             index++;
-            ret = Jacon_validate_object(tokenizer, &index);
+            ret = Jacon_validate_object(tokenizer, &index, 1);
             if (ret != JACON_OK) return ret;
             break;
         case JACON_TOKEN_STRING:
         case JACON_TOKEN_INT:
         case JACON_TOKEN_DOUBLE:
         case JACON_TOKEN_FLOAT:
+        case JACON_TOKEN_NUMBER:
         case JACON_TOKEN_BOOLEAN:
         case JACON_TOKEN_NULL:
         case JACON_TOKEN_ARRAY_END:
@@ -1318,8 +2399,9 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
             ret = Jacon_consume_token(&current_token, tokenizer, current_index);
             if (ret != JACON_OK) return ret;
             while (current_token.type != JACON_TOKEN_OBJECT_END) {
-                Jacon_Node* child = calloc(1, sizeof(Jacon_Node));
+                Jacon_Node* child = Jacon_calloc(1, sizeof(Jacon_Node));
                 if (child == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+                JACON_STAT_ADD(nodes, 1);
                 child->parent = node;
                 ret = Jacon_parse_node(child, tokenizer, current_index);
                 if (ret != JACON_OK) {
@@ -1341,8 +2423,9 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
             ret = Jacon_consume_token(&current_token, tokenizer, current_index);
             if (ret != JACON_OK) return ret;
             while (current_token.type != JACON_TOKEN_ARRAY_END) {
-                Jacon_Node* child = calloc(1, sizeof(Jacon_Node));
+                Jacon_Node* child = Jacon_calloc(1, sizeof(Jacon_Node));
                 if (child == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+                JACON_STAT_ADD(nodes, 1);
                 child->parent = node;
                 ret = Jacon_parse_node(child, tokenizer, current_index);
                 if (ret != JACON_OK) {
@@ -1361,7 +2444,7 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
 
         case JACON_TOKEN_STRING:
             if (node->type == JACON_VALUE_STRING) {
-                node->value.string_val = strdup(current_token.string_val);
+                node->value.string_val = Jacon_strdup(current_token.string_val);
                 if (node->value.string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
 
                 ret = Jacon_consume_token(&current_token, tokenizer, current_index);
@@ -1369,7 +2452,7 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
             }
             else if (node->parent != NULL && node->parent->type == JACON_VALUE_ARRAY) {
                 node->type = JACON_VALUE_STRING;
-                node->value.string_val = strdup(current_token.string_val);
+                node->value.string_val = Jacon_strdup(current_token.string_val);
                 if (node->value.string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
 
                 ret = Jacon_consume_token(&current_token, tokenizer, current_index);
@@ -1377,7 +2460,7 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
             }
             else {
                 node->type = JACON_VALUE_STRING;
-                node->name = strdup(current_token.string_val);
+                node->name = Jacon_strdup(current_token.string_val);
                 if (node->name == NULL) return JACON_ERR_MEMORY_ALLOCATION;
 
                 ret = Jacon_consume_token(&current_token, tokenizer, current_index);
@@ -1416,6 +2499,14 @@ Jacon_parse_node(Jacon_Node* node, Jacon_Tokenizer* tokenizer, size_t* current_i
             if (ret != JACON_OK) return ret;
             break;
 
+        case JACON_TOKEN_NUMBER:
+            node->type = JACON_VALUE_NUMBER;
+            node->value.string_val = Jacon_strdup(current_token.string_val);
+            if (node->value.string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            ret = Jacon_consume_token(&current_token, tokenizer, current_index);
+            if (ret != JACON_OK) return ret;
+            break;
+
         case JACON_TOKEN_NULL:
             node->type = JACON_VALUE_NULL;
             ret = Jacon_consume_token(&current_token, tokenizer, current_index);
@@ -1446,7 +2537,7 @@ Jacon_parse_value(Jacon_Node* root, Jacon_Token token)
     switch (token.type) {
         case JACON_TOKEN_STRING:
             root->type = JACON_VALUE_STRING;
-            root->value.string_val = strdup(token.string_val);
+            root->value.string_val = Jacon_strdup(token.string_val);
             if (root->value.string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
             break;
         case JACON_TOKEN_INT:
@@ -1461,6 +2552,11 @@ Jacon_parse_value(Jacon_Node* root, Jacon_Token token)
             root->type = JACON_VALUE_FLOAT;
             root->value.float_val = token.float_val;
             break;
+        case JACON_TOKEN_NUMBER:
+            root->type = JACON_VALUE_NUMBER;
+            root->value.string_val = Jacon_strdup(token.string_val);
+            if (root->value.string_val == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            break;
         case JACON_TOKEN_BOOLEAN:
             root->type = JACON_VALUE_BOOLEAN;
             root->value.bool_val = token.bool_val;
@@ -1487,6 +2583,7 @@ Jacon_Error
 Jacon_parse_tokens(Jacon_Node* root, Jacon_Tokenizer* tokenizer)
 {
     int ret = JACON_OK;
+    JACON_STAT_ADD(nodes, 1);
     if (tokenizer->count == 1) 
         return Jacon_parse_value(root, tokenizer->tokens[0]);
     size_t current_index = 0;
@@ -1528,10 +2625,13 @@ Jacon_add_node_to_map(Jacon_HashMap* map, Jacon_Node* node, const char* path_to_
     // Single value won't change
     // Full object is subject to change if it appears to be needed
     if (node->type != JACON_VALUE_OBJECT) {
-        Jacon_Node* duped = Jacon_duplicate_node(node);
-        Jacon_hm_put(map, builder.string, duped);
+        // A root value has no name to be found with
+        if (builder.string == NULL) return JACON_OK;
+        Jacon_Node* duped = Jacon_share_node(node);
+        ret = duped != NULL ? Jacon_hm_put(map, builder.string, duped) : JACON_ERR_MEMORY_ALLOCATION;
+        if (ret != JACON_OK && duped != NULL) Jacon_free_node(duped);
         Jacon_str_free(&builder);
-        return JACON_OK;
+        return ret;
     }
 
     // Add a dot between current path and next name
@@ -1559,7 +2659,9 @@ Jacon_add_node_to_map(Jacon_HashMap* map, Jacon_Node* node, const char* path_to_
 Jacon_Error
 Jacon_build_content(Jacon_content* content)
 {
-    return Jacon_add_node_to_map(&content->entries, content->root, NULL);
+    Jacon_Error ret;
+    JACON_STAT_TIME(build_ns, ret = Jacon_add_node_to_map(&content->entries, content->root, NULL));
+    return ret;
 }
 
 Jacon_Error
@@ -1568,13 +2670,83 @@ Jacon_free_content(Jacon_content* content)
     if (content == NULL)
         return JACON_ERR_NULL_PARAM;
 
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
     if (content->root != NULL) {
         Jacon_free_node(content->root);
     }
     Jacon_hm_free(&content->entries);
+    Jacon_pop_allocator(previous);
+    return JACON_OK;
+}
+
+void
+Jacon_content_free(Jacon_content* content, void* ptr)
+{
+    const Jacon_Allocator* previous = Jacon_push_allocator(content == NULL ? NULL : content->allocator);
+    Jacon_free(ptr);
+    Jacon_pop_allocator(previous);
+}
+
+/**
+ * Convert the Json text of a raw number to the requested numeric type.
+ * Only integers written without fraction nor exponent that fit convert to int.
+ */
+Jacon_Error
+Jacon_convert_number(const char* text, Jacon_ValueType type, void* value)
+{
+    char* end;
+    switch (type) {
+        case JACON_VALUE_INT: {
+            errno = 0;
+            long number = strtol(text, &end, 10);
+            if (*end != '\0' || errno == ERANGE || number < INT_MIN || number > INT_MAX) {
+                return JACON_ERR_INVALID_VALUE_TYPE;
+            }
+            *(int*)value = (int)number;
+            break;
+        }
+        case JACON_VALUE_FLOAT:
+            *(float*)value = strtof(text, NULL);
+            break;
+        case JACON_VALUE_DOUBLE:
+            *(double*)value = strtod(text, NULL);
+            break;
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_NUMBER:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
     return JACON_OK;
 }
 
+/**
+ * Type and value the tokenizer gives to a number when it converts it,
+ * nodes other than JACON_VALUE_NUMBER are returned as they are
+ */
+Jacon_Node
+Jacon_decode_number(const Jacon_Node* node)
+{
+    Jacon_Node decoded = *node;
+    if (node->type != JACON_VALUE_NUMBER) return decoded;
+    if (Jacon_convert_number(node->value.string_val, JACON_VALUE_INT, &decoded.value.int_val) == JACON_OK) {
+        decoded.type = JACON_VALUE_INT;
+        return decoded;
+    }
+    double number = strtod(node->value.string_val, NULL);
+    if (number > (double)(float)number) {
+        decoded.type = JACON_VALUE_DOUBLE;
+        decoded.value.double_val = number;
+    } else {
+        decoded.type = JACON_VALUE_FLOAT;
+        decoded.value.float_val = (float)number;
+    }
+    return decoded;
+}
+
 Jacon_Error
 Jacon_get_value_by_name(Jacon_content* content, const char* name, Jacon_ValueType type, void* value)
 {
@@ -1585,10 +2757,16 @@ Jacon_get_value_by_name(Jacon_content* content, const char* name, Jacon_ValueTyp
     if (ptr == NULL) {
         return JACON_ERR_KEY_NOT_FOUND;
     }
+    if (ptr->type == JACON_VALUE_NUMBER) {
+        return Jacon_convert_number(ptr->value.string_val, type, value);
+    }
     switch (type) {
-        case JACON_VALUE_STRING:
-            *(char**)value = strdup(ptr->value.string_val);
+        case JACON_VALUE_STRING: {
+            const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+            *(char**)value = Jacon_strdup(ptr->value.string_val);
+            Jacon_pop_allocator(previous);
             if (*(char**)value == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            }
             break;
         case JACON_VALUE_INT:
             *(int*)value = ptr->value.int_val;
@@ -1603,6 +2781,7 @@ Jacon_get_value_by_name(Jacon_content* content, const char* name, Jacon_ValueTyp
             *(bool*)value = ptr->value.bool_val;
             break;
         case JACON_VALUE_NULL:
+        case JACON_VALUE_NUMBER:
         case JACON_VALUE_ARRAY:
         case JACON_VALUE_OBJECT:
         default:
@@ -1641,21 +2820,216 @@ Jacon_get_bool_by_name(Jacon_content* content, const char* name, bool* value)
     return Jacon_get_value_by_name(content, name, JACON_VALUE_BOOLEAN, value);
 }
 
+Jacon_Error
+Jacon_get_string_view_by_name(Jacon_content* content, const char* name, const char** value, size_t* length)
+{
+    if (content == NULL || name == NULL || value == NULL) {
+        return JACON_ERR_NULL_PARAM;
+    }
+    Jacon_Node* ptr = (Jacon_Node*)Jacon_hm_get(&content->entries, name);
+    if (ptr == NULL) {
+        return JACON_ERR_KEY_NOT_FOUND;
+    }
+    if (ptr->type != JACON_VALUE_STRING) {
+        return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    *value = ptr->value.string_val;
+    if (length != NULL) *length = strlen(ptr->value.string_val);
+    return JACON_OK;
+}
+
 /**
- * Get single value by type
- * 
- * Single value means that there is only this value in json content
+ * Find a numeric array and check it fits in capacity.
+ * Sets homogeneous to the element type shared by every element, or JACON_VALUE_NULL
  */
 Jacon_Error
-Jacon_get_value(Jacon_content* content, Jacon_ValueType type, void* value)
+Jacon_get_number_array(Jacon_content* content, const char* name, const void* values, size_t capacity,
+    size_t* count, const Jacon_Node** array, Jacon_ValueType* homogeneous)
 {
-    if (content == NULL || (value == NULL && type != JACON_VALUE_STRING)) 
+    if (content == NULL || name == NULL || count == NULL) {
         return JACON_ERR_NULL_PARAM;
-    switch (type) {
-        case JACON_VALUE_STRING:
-            *(char**)value = strdup(content->root->value.string_val);
-            if (value == NULL) return JACON_ERR_MEMORY_ALLOCATION;
-            break;
+    }
+    const Jacon_Node* node = Jacon_hm_get(&content->entries, name);
+    if (node == NULL) {
+        return JACON_ERR_KEY_NOT_FOUND;
+    }
+    if (node->type != JACON_VALUE_ARRAY) {
+        return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    *count = node->child_count;
+    *homogeneous = node->child_count > 0 ? node->childs[0]->type : JACON_VALUE_NULL;
+    for (size_t i = 0; i < node->child_count; i++) {
+        Jacon_ValueType type = node->childs[i]->type;
+        if (type != JACON_VALUE_INT && type != JACON_VALUE_FLOAT && type != JACON_VALUE_DOUBLE
+            && type != JACON_VALUE_NUMBER) {
+            return JACON_ERR_INVALID_VALUE_TYPE;
+        }
+        if (type != *homogeneous) *homogeneous = JACON_VALUE_NULL;
+    }
+    if (node->child_count > capacity) {
+        return JACON_ERR_INVALID_SIZE;
+    }
+    if (values == NULL && node->child_count > 0) {
+        return JACON_ERR_NULL_PARAM;
+    }
+    *array = node;
+    return JACON_OK;
+}
+
+double
+Jacon_number_as_double(const Jacon_Node* node)
+{
+    switch (node->type) {
+        case JACON_VALUE_INT:
+            return node->value.int_val;
+        case JACON_VALUE_FLOAT:
+            return node->value.float_val;
+        case JACON_VALUE_DOUBLE:
+            return node->value.double_val;
+        case JACON_VALUE_NUMBER:
+            return strtod(node->value.string_val, NULL);
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Integral value of a number, raw ones keep every digit. value may be NULL
+ */
+bool
+Jacon_number_as_int64(const Jacon_Node* node, int64_t* value)
+{
+    int64_t integral = 0;
+    char* end = NULL;
+    if (node->type == JACON_VALUE_NUMBER) {
+        errno = 0;
+        integral = strtoll(node->value.string_val, &end, 10);
+    }
+    // Fractions and exponents go through double, as eagerly converted numbers do
+    if (end == NULL || *end != '\0' || errno == ERANGE) {
+        double number = Jacon_number_as_double(node);
+        if (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0)
+            || number != (double)(int64_t)number) {
+            return false;
+        }
+        integral = (int64_t)number;
+    }
+    if (value != NULL) *value = integral;
+    return true;
+}
+
+Jacon_Error
+Jacon_get_double_array_by_name(Jacon_content* content, const char* name, double* values, size_t capacity, size_t* count)
+{
+    const Jacon_Node* array = NULL;
+    Jacon_ValueType type;
+    Jacon_Error ret = Jacon_get_number_array(content, name, values, capacity, count, &array, &type);
+    if (ret != JACON_OK) return ret;
+    Jacon_Node* const* childs = array->childs;
+    size_t n = array->child_count;
+    // Single type arrays avoid the per element switch
+    switch (type) {
+        case JACON_VALUE_INT:
+            for (size_t i = 0; i < n; i++) values[i] = childs[i]->value.int_val;
+            break;
+        case JACON_VALUE_DOUBLE:
+            for (size_t i = 0; i < n; i++) values[i] = childs[i]->value.double_val;
+            break;
+        case JACON_VALUE_FLOAT:
+        case JACON_VALUE_NUMBER:
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            for (size_t i = 0; i < n; i++) values[i] = Jacon_number_as_double(childs[i]);
+            break;
+    }
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_get_float_array_by_name(Jacon_content* content, const char* name, float* values, size_t capacity, size_t* count)
+{
+    const Jacon_Node* array = NULL;
+    Jacon_ValueType type;
+    Jacon_Error ret = Jacon_get_number_array(content, name, values, capacity, count, &array, &type);
+    if (ret != JACON_OK) return ret;
+    Jacon_Node* const* childs = array->childs;
+    size_t n = array->child_count;
+    switch (type) {
+        case JACON_VALUE_INT:
+            for (size_t i = 0; i < n; i++) values[i] = (float)childs[i]->value.int_val;
+            break;
+        case JACON_VALUE_FLOAT:
+            for (size_t i = 0; i < n; i++) values[i] = childs[i]->value.float_val;
+            break;
+        case JACON_VALUE_DOUBLE:
+            for (size_t i = 0; i < n; i++) values[i] = (float)childs[i]->value.double_val;
+            break;
+        case JACON_VALUE_NUMBER:
+            for (size_t i = 0; i < n; i++) values[i] = strtof(childs[i]->value.string_val, NULL);
+            break;
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            for (size_t i = 0; i < n; i++) values[i] = (float)Jacon_number_as_double(childs[i]);
+            break;
+    }
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_get_int64_array_by_name(Jacon_content* content, const char* name, int64_t* values, size_t capacity, size_t* count)
+{
+    const Jacon_Node* array = NULL;
+    Jacon_ValueType type;
+    Jacon_Error ret = Jacon_get_number_array(content, name, values, capacity, count, &array, &type);
+    if (ret != JACON_OK) return ret;
+    Jacon_Node* const* childs = array->childs;
+    size_t n = array->child_count;
+    if (type == JACON_VALUE_INT) {
+        for (size_t i = 0; i < n; i++) values[i] = childs[i]->value.int_val;
+        return JACON_OK;
+    }
+    // Check every element first so the buffer is left untouched on failure
+    for (size_t i = 0; i < n; i++) {
+        if (!Jacon_number_as_int64(childs[i], NULL)) return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    for (size_t i = 0; i < n; i++) Jacon_number_as_int64(childs[i], &values[i]);
+    return JACON_OK;
+}
+
+/**
+ * Get single value by type
+ * 
+ * Single value means that there is only this value in json content
+ */
+Jacon_Error
+Jacon_get_value(Jacon_content* content, Jacon_ValueType type, void* value)
+{
+    if (content == NULL || (value == NULL && type != JACON_VALUE_STRING)) 
+        return JACON_ERR_NULL_PARAM;
+    if (content->root->type == JACON_VALUE_NUMBER) {
+        return Jacon_convert_number(content->root->value.string_val, type, value);
+    }
+    switch (type) {
+        case JACON_VALUE_STRING: {
+            const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+            *(char**)value = Jacon_strdup(content->root->value.string_val);
+            Jacon_pop_allocator(previous);
+            if (*(char**)value == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            }
+            break;
         case JACON_VALUE_INT:
             *(int*)value = content->root->value.int_val;
             break;
@@ -1669,6 +3043,7 @@ Jacon_get_value(Jacon_content* content, Jacon_ValueType type, void* value)
             *(bool*)value = content->root->value.bool_val;
             break;
         case JACON_VALUE_NULL:
+        case JACON_VALUE_NUMBER:
         case JACON_VALUE_ARRAY:
         case JACON_VALUE_OBJECT:
         default:
@@ -1686,6 +3061,23 @@ Jacon_get_string(Jacon_content* content, char** value)
     return Jacon_get_value(content, JACON_VALUE_STRING, value);
 }
 
+/**
+ * Get single string value without copying it
+ */
+Jacon_Error
+Jacon_get_string_view(Jacon_content* content, const char** value, size_t* length)
+{
+    if (content == NULL || content->root == NULL || value == NULL) {
+        return JACON_ERR_NULL_PARAM;
+    }
+    if (content->root->type != JACON_VALUE_STRING) {
+        return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    *value = content->root->value.string_val;
+    if (length != NULL) *length = strlen(content->root->value.string_val);
+    return JACON_OK;
+}
+
 /**
  * Get single int value
  */
@@ -1722,11 +3114,134 @@ Jacon_get_bool(Jacon_content* content, bool* value)
     return Jacon_get_value(content, JACON_VALUE_BOOLEAN, value);
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+#define Jacon_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define Jacon_prefetch(addr) ((void)(addr))
+#endif
+
+/**
+ * Copy a found node into the lookup output
+ */
+Jacon_Error
+Jacon_resolve_lookup(const Jacon_Node* node, Jacon_Lookup* lookup)
+{
+    if (node == NULL) return JACON_ERR_KEY_NOT_FOUND;
+    double number = 0;
+    bool numeric = true;
+    switch (node->type) {
+        case JACON_VALUE_INT:
+            number = node->value.int_val;
+            break;
+        case JACON_VALUE_FLOAT:
+            number = node->value.float_val;
+            break;
+        case JACON_VALUE_DOUBLE:
+            number = node->value.double_val;
+            break;
+        case JACON_VALUE_NUMBER:
+            number = strtod(node->value.string_val, NULL);
+            break;
+        case JACON_VALUE_STRING:
+        case JACON_VALUE_BOOLEAN:
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            numeric = false;
+            break;
+    }
+    bool wants_number = lookup->type == JACON_VALUE_INT || lookup->type == JACON_VALUE_FLOAT
+        || lookup->type == JACON_VALUE_DOUBLE;
+    if (numeric != wants_number || (!numeric && node->type != lookup->type)) {
+        return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    if (lookup->value == NULL) {
+        return lookup->type == JACON_VALUE_NULL ? JACON_OK : JACON_ERR_NULL_PARAM;
+    }
+    switch (lookup->type) {
+        case JACON_VALUE_INT:
+            if (node->type == JACON_VALUE_INT) *(int*)lookup->value = node->value.int_val;
+            else if (number >= INT_MIN && number <= INT_MAX && number == (int)number)
+                *(int*)lookup->value = (int)number;
+            else return JACON_ERR_INVALID_VALUE_TYPE;
+            break;
+        case JACON_VALUE_FLOAT:
+            *(float*)lookup->value = (float)number;
+            break;
+        case JACON_VALUE_DOUBLE:
+            *(double*)lookup->value = number;
+            break;
+        case JACON_VALUE_STRING:
+            *(const char**)lookup->value = node->value.string_val;
+            break;
+        case JACON_VALUE_BOOLEAN:
+            *(bool*)lookup->value = node->value.bool_val;
+            break;
+        case JACON_VALUE_ARRAY:
+            *(const Jacon_Node**)lookup->value = node;
+            break;
+        case JACON_VALUE_NULL:
+            break;
+        case JACON_VALUE_NUMBER:
+        case JACON_VALUE_OBJECT:
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    return JACON_OK;
+}
+
+/**
+ * Lookups are resolved by windows: every key of a window is hashed and its bucket
+ * prefetched, then the chains are walked once the buckets are likely in cache.
+ */
+Jacon_Error
+Jacon_get_batch(Jacon_content* content, Jacon_Lookup* lookups, size_t count)
+{
+    if (content == NULL || (lookups == NULL && count > 0)) return JACON_ERR_NULL_PARAM;
+    Jacon_HashMap* map = &content->entries;
+    Jacon_Error ret = JACON_OK;
+    Jacon_HashMapEntry* heads[JACON_LOOKUP_WINDOW];
+
+    for (size_t start = 0; start < count; start += JACON_LOOKUP_WINDOW) {
+        size_t window = count - start < JACON_LOOKUP_WINDOW ? count - start : JACON_LOOKUP_WINDOW;
+        size_t indexes[JACON_LOOKUP_WINDOW];
+        for (size_t i = 0; i < window; i++) {
+            const char* path = lookups[start + i].path;
+            if (path == NULL || map->entries == NULL) {
+                indexes[i] = SIZE_MAX;
+                continue;
+            }
+            indexes[i] = Jacon_hash((unsigned char*)path) % map->size;
+            Jacon_prefetch(&map->entries[indexes[i]]);
+        }
+        for (size_t i = 0; i < window; i++) {
+            heads[i] = indexes[i] == SIZE_MAX ? NULL : map->entries[indexes[i]];
+            if (heads[i] != NULL) Jacon_prefetch(heads[i]);
+        }
+        for (size_t i = 0; i < window; i++) {
+            Jacon_Lookup* lookup = &lookups[start + i];
+            if (lookup->path == NULL) {
+                lookup->status = JACON_ERR_NULL_PARAM;
+            } else {
+                Jacon_HashMapEntry* entry = heads[i];
+                while (entry != NULL && strcmp(entry->key, lookup->path) != 0) {
+                    entry = entry->next_entry;
+                }
+                lookup->status = Jacon_resolve_lookup(entry == NULL ? NULL : entry->value, lookup);
+            }
+            if (ret == JACON_OK) ret = lookup->status;
+        }
+    }
+    return ret;
+}
+
 bool
 Jacon_exist_by_name(Jacon_content* content, const char* name, Jacon_ValueType type)
 {
-    void* value = Jacon_hm_get(&content->entries, name);
-    return ((Jacon_Node*)value)->type == type;
+    Jacon_Node* value = Jacon_hm_get(&content->entries, name);
+    // Raw numbers exist as the type they would have been converted to
+    return value != NULL && (value->type == type || Jacon_decode_number(value).type == type);
 }
 
 /**
@@ -1789,7 +3304,7 @@ Jacon_exist_null_by_name(Jacon_content* content, const char* name)
 bool
 Jacon_exist(Jacon_content* content, Jacon_ValueType type)
 {
-    return content->root->type == type;
+    return content->root->type == type || Jacon_decode_number(content->root).type == type;
 }
 
 /**
@@ -1869,7 +3384,8 @@ Jacon_node_as_str(Jacon_Node* node, Jacon_StringBuilder* builder, size_t offset,
         Jacon_append_offset(builder, offset);
 
     if (node->name != NULL) {
-        Jacon_str_append_null(builder, "\"", node->name, "\": ");
+        ret = Jacon_json_write_name(builder, node->name, ": ");
+        if (ret != JACON_OK) return ret;
     }
     
     switch (node->type) {
@@ -1911,16 +3427,23 @@ Jacon_node_as_str(Jacon_Node* node, Jacon_StringBuilder* builder, size_t offset,
             break;
         case JACON_VALUE_STRING:
             if (node->value.string_val == NULL) return JACON_ERR_NULL_PARAM;
-            Jacon_str_append_fmt_null(builder, "\"%s\"", node->value.string_val);
+            ret = Jacon_json_write_quoted(builder, node->value.string_val, strlen(node->value.string_val));
+            if (ret != JACON_OK) return ret;
             break;
         case JACON_VALUE_INT:
             Jacon_str_append_fmt_null(builder, "%d", node->value.int_val);
             break;
         case JACON_VALUE_FLOAT:
-            Jacon_str_append_fmt_null(builder, "%f", node->value.float_val);
+            Jacon_json_write_float(builder, node->value.float_val);
             break;
         case JACON_VALUE_DOUBLE:
-            Jacon_str_append_fmt_null(builder, "%f", node->value.double_val);
+            Jacon_json_write_double(builder, node->value.double_val);
+            break;
+        case JACON_VALUE_NUMBER:
+            if (node->value.string_val == NULL) return JACON_ERR_NULL_PARAM;
+            // Written back as it was read
+            ret = Jacon_str_append_n(builder, node->value.string_val, strlen(node->value.string_val));
+            if (ret != JACON_OK) return ret;
             break;
         case JACON_VALUE_BOOLEAN:
             Jacon_str_append_fmt_null(builder, "%s", 
@@ -1936,15 +3459,17 @@ Jacon_node_as_str(Jacon_Node* node, Jacon_StringBuilder* builder, size_t offset,
 }
 
 Jacon_Error
-Jacon_node_as_str_unformatted(Jacon_Node* node, Jacon_StringBuilder* builder)
+Jacon_node_as_str_unformatted(Jacon_Node* node, Jacon_StringBuilder* builder);
+
+/**
+ * Compact Json of a node value, its name is left out
+ */
+Jacon_Error
+Jacon_value_as_str_unformatted(const Jacon_Node* node, Jacon_StringBuilder* builder)
 {
     int ret;
     size_t index;
 
-    if (node->name != NULL) {
-        Jacon_str_append_null(builder, "\"", node->name, "\":");
-    }
-    
     switch (node->type) {
         case JACON_VALUE_OBJECT:
             Jacon_str_append_null(builder, "{");
@@ -1968,16 +3493,23 @@ Jacon_node_as_str_unformatted(Jacon_Node* node, Jacon_StringBuilder* builder)
             break;
         case JACON_VALUE_STRING:
             if (node->value.string_val == NULL) return JACON_ERR_NULL_PARAM;
-            Jacon_str_append_fmt_null(builder, "\"%s\"", node->value.string_val);
+            ret = Jacon_json_write_quoted(builder, node->value.string_val, strlen(node->value.string_val));
+            if (ret != JACON_OK) return ret;
             break;
         case JACON_VALUE_INT:
             Jacon_str_append_fmt_null(builder, "%d", node->value.int_val);
             break;
         case JACON_VALUE_FLOAT:
-            Jacon_str_append_fmt_null(builder, "%f", node->value.float_val);
+            Jacon_json_write_float(builder, node->value.float_val);
             break;
         case JACON_VALUE_DOUBLE:
-            Jacon_str_append_fmt_null(builder, "%f", node->value.double_val);
+            Jacon_json_write_double(builder, node->value.double_val);
+            break;
+        case JACON_VALUE_NUMBER:
+            if (node->value.string_val == NULL) return JACON_ERR_NULL_PARAM;
+            // Written back as it was read
+            ret = Jacon_str_append_n(builder, node->value.string_val, strlen(node->value.string_val));
+            if (ret != JACON_OK) return ret;
             break;
         case JACON_VALUE_BOOLEAN:
             Jacon_str_append_fmt_null(builder, "%s", 
@@ -1992,6 +3524,16 @@ Jacon_node_as_str_unformatted(Jacon_Node* node, Jacon_StringBuilder* builder)
     return JACON_OK;
 }
 
+Jacon_Error
+Jacon_node_as_str_unformatted(Jacon_Node* node, Jacon_StringBuilder* builder)
+{
+    if (node->name != NULL) {
+        Jacon_Error ret = Jacon_json_write_name(builder, node->name, ":");
+        if (ret != JACON_OK) return ret;
+    }
+    return Jacon_value_as_str_unformatted(node, builder);
+}
+
 char *
 Jacon_serialize(Jacon_Node* node)
 {
@@ -2001,7 +3543,7 @@ Jacon_serialize(Jacon_Node* node)
     if (Jacon_node_as_str(node, &builder, 0, true)) {
         goto ret;
     }
-    str = strdup(builder.string);
+    str = Jacon_strdup(builder.string);
 ret:
     Jacon_str_free(&builder);
     return str;
@@ -2016,12 +3558,43 @@ Jacon_serialize_unformatted(Jacon_Node* node)
     if (Jacon_node_as_str_unformatted(node, &builder)) {
         goto ret;
     }
-    str = strdup(builder.string);
+    str = Jacon_strdup(builder.string);
 ret:    
     Jacon_str_free(&builder);
     return str;
 }
 
+/**
+ * Parse a Json string input using an already initialized tokenizer.
+ * The tokenizer is left reset so it can be reused for the next input.
+ */
+Jacon_Error
+Jacon_deserialize_with_tokenizer(Jacon_content* content, const char* str, Jacon_Tokenizer* tokenizer)
+{
+    if (content == NULL || str == NULL) return JACON_ERR_NULL_PARAM;
+    if (*str == '\0') return JACON_ERR_EMPTY_INPUT;
+
+    Jacon_Error ret;
+    tokenizer->raw_numbers = content->raw_numbers;
+    JACON_STAT_TIME(tokenize_ns, ret = Jacon_tokenize(tokenizer, str));
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+
+    // Invalidate empty input
+    if (tokenizer->count == 0) Jacon_defer_return(JACON_ERR_EMPTY_INPUT);
+
+    JACON_STAT_TIME(validate_ns, ret = Jacon_validate_input(tokenizer));
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+
+    JACON_STAT_TIME(parse_ns, ret = Jacon_parse_tokens(content->root, tokenizer));
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    Jacon_reset_tokenizer(tokenizer);
+
+    return Jacon_build_content(content);
+defer:
+    Jacon_reset_tokenizer(tokenizer);
+    return ret;
+}
+
 Jacon_Error
 Jacon_deserialize(Jacon_content* content, const char* str)
 {
@@ -2029,36 +3602,4728 @@ Jacon_deserialize(Jacon_content* content, const char* str)
     size_t len = strlen(str);
     if (len == 0) return JACON_ERR_EMPTY_INPUT;
 
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
     Jacon_Tokenizer tokenizer;
-    Jacon_tokenizer_init(&tokenizer);
-    Jacon_Error ret;
-    ret = Jacon_tokenize(&tokenizer, str);
-    if (ret != JACON_OK) {
-        Jacon_free_tokenizer(&tokenizer);
-        return ret;
-    }
-    
-    // Invalidate empty input
-    if (tokenizer.count == 0) {
+    Jacon_Error ret = Jacon_tokenizer_init(&tokenizer);
+    if (ret == JACON_OK) {
+        ret = Jacon_deserialize_with_tokenizer(content, str, &tokenizer);
         Jacon_free_tokenizer(&tokenizer);
-        return JACON_ERR_EMPTY_INPUT;
     }
+    Jacon_pop_allocator(previous);
+    return ret;
+}
 
-    ret = Jacon_validate_input(&tokenizer);
-    if (ret != JACON_OK) {
-        Jacon_free_tokenizer(&tokenizer);
-        return ret;
+Jacon_Error
+Jacon_deserialize_with_limits(Jacon_content* content, const char* str, const Jacon_ParseLimits* limits)
+{
+    if (content == NULL || str == NULL || limits == NULL) return JACON_ERR_NULL_PARAM;
+    if (limits->max_input_size != 0 && strnlen(str, limits->max_input_size + 1) > limits->max_input_size) {
+        return JACON_ERR_INPUT_TOO_LARGE;
     }
 
-    ret = Jacon_parse_tokens(content->root, &tokenizer);
-    if (ret != JACON_OK) {
-        Jacon_free_tokenizer(&tokenizer);
-        return ret;
-    }
-    Jacon_free_tokenizer(&tokenizer);
+    Jacon_LimitState state = { .limits = limits };
+    Jacon_LimitState* previous = Jacon_active_limits;
+    Jacon_active_limits = &state;
+    Jacon_Error ret = Jacon_deserialize(content, str);
+    Jacon_active_limits = previous;
+    // Failed path index insertions are not reported, the flag catches every one
+    if (state.memory_exceeded) ret = JACON_ERR_MEMORY_LIMIT;
+    return ret;
+}
 
-    ret = Jacon_build_content(content);
+typedef struct {
+    const char** paths;
+    size_t path_count;
+    // Reused for every materialized value
+    Jacon_Tokenizer tokenizer;
+} Jacon_Projection;
+
+/**
+ * Fully parse the value at *str into node
+ */
+Jacon_Error
+Jacon_parse_projected_value(Jacon_Node* node, const char** str, Jacon_Projection* projection)
+{
+    Jacon_Error ret;
+    Jacon_reset_tokenizer(&projection->tokenizer);
+
+    JACON_STAT_TIME(tokenize_ns, ret = Jacon_tokenize_value(&projection->tokenizer, str));
     if (ret != JACON_OK) return ret;
 
-    return JACON_OK;
-}
\ No newline at end of file
+    JACON_STAT_TIME(validate_ns, ret = Jacon_validate_input(&projection->tokenizer));
+    if (ret != JACON_OK) return ret;
+
+    JACON_STAT_TIME(parse_ns, ret = Jacon_parse_tokens(node, &projection->tokenizer));
+    return ret;
+}
+
+/**
+ * Parse the object at *str keeping only the members leading to a projected path.
+ * Active paths are the ones starting with the prefix_len first chars of prefix,
+ * prefix being one of the paths that matched the parent objects.
+ */
+Jacon_Error
+Jacon_parse_projected_object(Jacon_Node* node, const char** str, Jacon_Projection* projection,
+    const char* prefix, size_t prefix_len)
+{
+    Jacon_Error ret;
+    node->type = JACON_VALUE_OBJECT;
+
+    const char* ptr = Jacon_skip_whitespace(*str + 1);
+    if (*ptr == '}') {
+        *str = ptr + 1;
+        return JACON_OK;
+    }
+
+    while (true) {
+        if (*ptr != '"') return JACON_ERR_INVALID_JSON;
+        const char* key = ptr + 1;
+        ret = Jacon_skip_string(&ptr);
+        if (ret != JACON_OK) return ret;
+        size_t key_len = ptr - 1 - key;
+
+        ptr = Jacon_skip_whitespace(ptr);
+        if (*ptr != ':') return JACON_ERR_INVALID_JSON;
+        ptr = Jacon_skip_whitespace(ptr + 1);
+
+        // Look for a path ending on this member or going through it
+        bool exact = false;
+        const char* descend = NULL;
+        for (size_t i = 0; i < projection->path_count; i++) {
+            const char* path = projection->paths[i];
+            if (strncmp(path, prefix, prefix_len) != 0) continue;
+            if (strncmp(path + prefix_len, key, key_len) != 0) continue;
+            char next = path[prefix_len + key_len];
+            if (next == '\0') {
+                exact = true;
+                break;
+            }
+            if (next == '.' && descend == NULL) descend = path;
+        }
+
+        if (exact || (descend != NULL && *ptr == '{')) {
+            Jacon_Node* child = Jacon_calloc(1, sizeof(Jacon_Node));
+            if (child == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            child->parent = node;
+
+            if (exact) {
+                ret = Jacon_parse_projected_value(child, &ptr, projection);
+            } else {
+                ret = Jacon_parse_projected_object(child, &ptr, projection,
+                    descend, prefix_len + key_len + 1);
+            }
+            if (ret == JACON_OK) {
+                child->name = Jacon_strndup(key, key_len);
+                if (child->name == NULL) ret = JACON_ERR_MEMORY_ALLOCATION;
+            }
+            if (ret == JACON_OK) ret = Jacon_append_child(node, child);
+            if (ret != JACON_OK) {
+                Jacon_free_node(child);
+                return ret;
+            }
+        }
+        else {
+            ret = Jacon_skip_value(&ptr);
+            if (ret != JACON_OK) return ret;
+        }
+
+        ptr = Jacon_skip_whitespace(ptr);
+        if (*ptr == ',') {
+            ptr = Jacon_skip_whitespace(ptr + 1);
+            continue;
+        }
+        if (*ptr == '}') break;
+        return JACON_ERR_INVALID_JSON;
+    }
+
+    *str = ptr + 1;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_parse_projection(Jacon_content* content, const char* str, const char** paths, size_t path_count)
+{
+    const char* ptr = Jacon_skip_whitespace(str);
+    if (*ptr == '\0') return JACON_ERR_EMPTY_INPUT;
+    // Paths only go through objects, anything else is parsed as a whole
+    if (*ptr != '{') return Jacon_deserialize(content, str);
+
+    Jacon_Error ret;
+    Jacon_Projection projection = {
+        .paths = paths,
+        .path_count = path_count,
+    };
+    ret = Jacon_tokenizer_init(&projection.tokenizer);
+    if (ret != JACON_OK) return ret;
+    projection.tokenizer.raw_numbers = content->raw_numbers;
+
+    ret = Jacon_parse_projected_object(content->root, &ptr, &projection, "", 0);
+    Jacon_free_tokenizer(&projection.tokenizer);
+    if (ret != JACON_OK) return ret;
+
+    if (*Jacon_skip_whitespace(ptr) != '\0') return JACON_ERR_INVALID_JSON;
+
+    return Jacon_build_content(content);
+}
+
+Jacon_Error
+Jacon_deserialize_paths(Jacon_content* content, const char* str, const char** paths, size_t path_count)
+{
+    if (content == NULL || str == NULL || (paths == NULL && path_count > 0))
+        return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_Error ret = Jacon_parse_projection(content, str, paths, path_count);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+typedef struct {
+    size_t offset;
+    Jacon_Error status;
+    Jacon_content content;
+} Jacon_NdjsonRecord;
+
+typedef struct {
+    const char* str;
+    size_t len;
+    size_t batch_size;
+    size_t batch_count;
+    bool unordered;
+    Jacon_NdjsonCallback callback;
+    void* user_data;
+    const Jacon_Allocator* allocator;
+
+    pthread_mutex_t claim_lock;
+    size_t next_batch;
+
+    // Callbacks are only ever invoked with the delivery lock held
+    pthread_mutex_t delivery_lock;
+    pthread_cond_t delivery_turn;
+    size_t next_delivery;
+    Jacon_Error ret;
+} Jacon_NdjsonPipeline;
+
+// Per worker parser state, reused for every record
+typedef struct {
+    Jacon_NdjsonPipeline* pipeline;
+    Jacon_Tokenizer tokenizer;
+    Jacon_StringBuilder line;
+    Jacon_NdjsonRecord* records;
+    size_t record_count;
+    size_t record_capacity;
+} Jacon_NdjsonWorker;
+
+/**
+ * Offset of the first line starting in batch index
+ */
+size_t
+Jacon_ndjson_batch_start(Jacon_NdjsonPipeline* pipeline, size_t index)
+{
+    if (index == 0) return 0;
+    size_t from = index * pipeline->batch_size - 1;
+    if (from >= pipeline->len) return pipeline->len;
+    const char* newline = memchr(pipeline->str + from, '\n', pipeline->len - from);
+    if (newline == NULL) return pipeline->len;
+    return newline - pipeline->str + 1;
+}
+
+void
+Jacon_ndjson_fail(Jacon_NdjsonPipeline* pipeline, Jacon_Error ret)
+{
+    pthread_mutex_lock(&pipeline->delivery_lock);
+    if (pipeline->ret == JACON_OK) pipeline->ret = ret;
+    pthread_cond_broadcast(&pipeline->delivery_turn);
+    pthread_mutex_unlock(&pipeline->delivery_lock);
+}
+
+/**
+ * Parse a single line, the content is initialized even when parsing fails
+ */
+Jacon_Error
+Jacon_ndjson_parse_record(Jacon_NdjsonWorker* worker, Jacon_NdjsonRecord* record,
+    const char* line, size_t size)
+{
+    Jacon_Error ret;
+    worker->line.count = 0;
+    if (worker->line.capacity < size + 1) {
+        char* tmp = Jacon_realloc(worker->line.string, size + 1);
+        if (tmp == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        worker->line.string = tmp;
+        worker->line.capacity = size + 1;
+    }
+    memcpy(worker->line.string, line, size);
+    worker->line.string[size] = '\0';
+    worker->line.count = size;
+
+    ret = Jacon_init_content_with_allocator(&record->content, worker->pipeline->allocator);
+    if (ret != JACON_OK) return ret;
+    record->status = Jacon_deserialize_with_tokenizer(&record->content,
+        worker->line.string, &worker->tokenizer);
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_ndjson_deliver(Jacon_NdjsonPipeline* pipeline, Jacon_NdjsonRecord* record)
+{
+    return pipeline->callback(pipeline->user_data, record->offset,
+        record->status, &record->content);
+}
+
+Jacon_Error
+Jacon_ndjson_run_batch(Jacon_NdjsonWorker* worker, size_t index)
+{
+    Jacon_Error ret = JACON_OK;
+    Jacon_NdjsonPipeline* pipeline = worker->pipeline;
+    size_t start = Jacon_ndjson_batch_start(pipeline, index);
+    size_t end = Jacon_ndjson_batch_start(pipeline, index + 1);
+    worker->record_count = 0;
+
+    while (start < end) {
+        const char* line = pipeline->str + start;
+        const char* newline = memchr(line, '\n', end - start);
+        size_t size = newline == NULL ? end - start : (size_t)(newline - line);
+        size_t offset = start;
+        start += size + 1;
+
+        if (size > 0 && line[size - 1] == '\r') size--;
+        // Blank lines are not records
+        size_t blank = 0;
+        while (blank < size && Jacon_is_whitespace(line[blank])) blank++;
+        if (blank == size) continue;
+
+        if (worker->record_count == worker->record_capacity) {
+            size_t new_capacity = worker->record_capacity == 0 ?
+                JACON_NODE_DEFAULT_CHILD_CAPACITY :
+                worker->record_capacity * JACON_NODE_DEFAULT_RESIZE_FACTOR;
+            Jacon_NdjsonRecord* tmp = Jacon_realloc(worker->records, new_capacity * sizeof(Jacon_NdjsonRecord));
+            if (tmp == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+            worker->records = tmp;
+            worker->record_capacity = new_capacity;
+        }
+        Jacon_NdjsonRecord* record = &worker->records[worker->record_count];
+        record->offset = offset;
+        ret = Jacon_ndjson_parse_record(worker, record, line, size);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        worker->record_count++;
+
+        if (pipeline->unordered) {
+            pthread_mutex_lock(&pipeline->delivery_lock);
+            if (pipeline->ret == JACON_OK) ret = Jacon_ndjson_deliver(pipeline, record);
+            pthread_mutex_unlock(&pipeline->delivery_lock);
+            Jacon_free_content(&record->content);
+            worker->record_count = 0;
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+    }
+
+    if (!pipeline->unordered) {
+        pthread_mutex_lock(&pipeline->delivery_lock);
+        while (pipeline->next_delivery != index && pipeline->ret == JACON_OK) {
+            pthread_cond_wait(&pipeline->delivery_turn, &pipeline->delivery_lock);
+        }
+        for (size_t i = 0; i < worker->record_count && pipeline->ret == JACON_OK; i++) {
+            ret = Jacon_ndjson_deliver(pipeline, &worker->records[i]);
+            if (ret != JACON_OK) pipeline->ret = ret;
+        }
+        pipeline->next_delivery++;
+        pthread_cond_broadcast(&pipeline->delivery_turn);
+        pthread_mutex_unlock(&pipeline->delivery_lock);
+    }
+
+defer:
+    for (size_t i = 0; i < worker->record_count; i++) {
+        Jacon_free_content(&worker->records[i].content);
+    }
+    worker->record_count = 0;
+    return ret;
+}
+
+void*
+Jacon_ndjson_worker(void* arg)
+{
+    Jacon_NdjsonWorker* worker = arg;
+    Jacon_NdjsonPipeline* pipeline = worker->pipeline;
+    const Jacon_Allocator* previous = Jacon_push_allocator(pipeline->allocator);
+
+    while (true) {
+        pthread_mutex_lock(&pipeline->claim_lock);
+        size_t index = pipeline->next_batch++;
+        pthread_mutex_unlock(&pipeline->claim_lock);
+        if (index >= pipeline->batch_count) break;
+
+        pthread_mutex_lock(&pipeline->delivery_lock);
+        bool stopped = pipeline->ret != JACON_OK;
+        pthread_mutex_unlock(&pipeline->delivery_lock);
+        if (stopped) break;
+
+        Jacon_Error ret = Jacon_ndjson_run_batch(worker, index);
+        if (ret != JACON_OK) {
+            Jacon_ndjson_fail(pipeline, ret);
+            break;
+        }
+    }
+    Jacon_pop_allocator(previous);
+    return NULL;
+}
+
+Jacon_Error
+Jacon_deserialize_ndjson(const char* str, size_t len, const Jacon_NdjsonOptions* options,
+    Jacon_NdjsonCallback callback, void* user_data)
+{
+    if ((str == NULL && len > 0) || callback == NULL) return JACON_ERR_NULL_PARAM;
+    if (len == 0) return JACON_OK;
+
+    Jacon_NdjsonOptions defaults = {0};
+    if (options == NULL) options = &defaults;
+
+    Jacon_NdjsonPipeline pipeline = {
+        .str = str,
+        .len = len,
+        .batch_size = options->batch_size > 0 ?
+            options->batch_size : JACON_NDJSON_DEFAULT_BATCH_SIZE,
+        .unordered = options->unordered,
+        .callback = callback,
+        .user_data = user_data,
+        .allocator = options->allocator != NULL ? options->allocator : Jacon_scoped_allocator,
+        .ret = JACON_OK,
+    };
+    pipeline.batch_count = (len + pipeline.batch_size - 1) / pipeline.batch_size;
+
+    size_t thread_count = options->thread_count;
+    if (thread_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (size_t)online : 1;
+    }
+    if (thread_count > pipeline.batch_count) thread_count = pipeline.batch_count;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(pipeline.allocator);
+    Jacon_NdjsonWorker* workers = Jacon_calloc(thread_count, sizeof(Jacon_NdjsonWorker));
+    pthread_t* threads = Jacon_calloc(thread_count, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL) {
+        Jacon_free(workers);
+        Jacon_free(threads);
+        Jacon_pop_allocator(previous);
+        return JACON_ERR_MEMORY_ALLOCATION;
+    }
+    pthread_mutex_init(&pipeline.claim_lock, NULL);
+    pthread_mutex_init(&pipeline.delivery_lock, NULL);
+    pthread_cond_init(&pipeline.delivery_turn, NULL);
+
+    size_t started = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        workers[i].pipeline = &pipeline;
+        if (Jacon_tokenizer_init(&workers[i].tokenizer) != JACON_OK) {
+            Jacon_ndjson_fail(&pipeline, JACON_ERR_MEMORY_ALLOCATION);
+            break;
+        }
+        started++;
+    }
+
+    // The calling thread acts as the first worker
+    size_t spawned = 1;
+    while (spawned < started) {
+        if (pthread_create(&threads[spawned], NULL, Jacon_ndjson_worker, &workers[spawned]) != 0) break;
+        spawned++;
+    }
+    if (started > 0) Jacon_ndjson_worker(&workers[0]);
+    for (size_t i = 1; i < spawned; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        Jacon_free_tokenizer(&workers[i].tokenizer);
+        Jacon_str_free(&workers[i].line);
+        Jacon_free(workers[i].records);
+    }
+    Jacon_free(workers);
+    Jacon_free(threads);
+    pthread_cond_destroy(&pipeline.delivery_turn);
+    pthread_mutex_destroy(&pipeline.delivery_lock);
+    pthread_mutex_destroy(&pipeline.claim_lock);
+    Jacon_pop_allocator(previous);
+    return pipeline.ret;
+}
+
+Jacon_Error
+Jacon_deserialize_ndjson_file(const char* path, const Jacon_NdjsonOptions* options,
+    Jacon_NdjsonCallback callback, void* user_data)
+{
+    if (path == NULL || callback == NULL) return JACON_ERR_NULL_PARAM;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return JACON_ERR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return JACON_ERR_IO;
+    }
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        close(fd);
+        return JACON_OK;
+    }
+
+    void* data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return JACON_ERR_IO;
+    madvise(data, len, MADV_SEQUENTIAL);
+
+    Jacon_Error ret = Jacon_deserialize_ndjson(data, len, options, callback, user_data);
+    munmap(data, len);
+    return ret;
+}
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    Jacon_Node* root;
+    const Jacon_Allocator* allocator;
+    bool raw_numbers;
+    // Parsed elements, owned until stitched into root
+    Jacon_Node elements;
+    Jacon_Error ret;
+} Jacon_ParallelChunk;
+
+/**
+ * Parse the comma separated array elements between chunk begin and end
+ */
+void*
+Jacon_parse_parallel_chunk(void* arg)
+{
+    Jacon_ParallelChunk* chunk = arg;
+    const Jacon_Allocator* previous = Jacon_push_allocator(chunk->allocator);
+    Jacon_Tokenizer tokenizer;
+    Jacon_Error ret = Jacon_tokenizer_init(&tokenizer);
+    if (ret != JACON_OK) {
+        chunk->ret = ret;
+        Jacon_pop_allocator(previous);
+        return NULL;
+    }
+    tokenizer.raw_numbers = chunk->raw_numbers;
+
+    const char* ptr = Jacon_skip_whitespace(chunk->begin);
+    while (true) {
+        // Empty element, as in [1,,2] or [1,]
+        if (ptr >= chunk->end) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+
+        Jacon_reset_tokenizer(&tokenizer);
+        ret = Jacon_tokenize_value(&tokenizer, &ptr);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        if (ptr > chunk->end) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+        ret = Jacon_validate_input(&tokenizer);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+
+        Jacon_Node* child = Jacon_calloc(1, sizeof(Jacon_Node));
+        if (child == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+        child->parent = chunk->root;
+        ret = Jacon_parse_tokens(child, &tokenizer);
+        if (ret == JACON_OK) ret = Jacon_append_child(&chunk->elements, child);
+        if (ret != JACON_OK) {
+            Jacon_free_node(child);
+            Jacon_defer_return(ret);
+        }
+
+        ptr = Jacon_skip_whitespace(ptr);
+        if (ptr == chunk->end) break;
+        if (*ptr != ',') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+        ptr = Jacon_skip_whitespace(ptr + 1);
+    }
+
+defer:
+    Jacon_free_tokenizer(&tokenizer);
+    chunk->ret = ret;
+    Jacon_pop_allocator(previous);
+    return NULL;
+}
+
+/**
+ * Structural pre-scan of the root array starting at str.
+ * Fills splits with the depth 1 commas found after each nominal split offset, found with their number,
+ * and end with the closing bracket of the array.
+ * Fails with JACON_ERR_INVALID_JSON when the array is not closed or a bracket closes the other kind,
+ * and with JACON_ERR_DEPTH_LIMIT past JACON_VALIDATE_MAX_DEPTH open containers.
+ */
+Jacon_Error
+Jacon_prescan_array(const char* str, size_t len, const char** splits, size_t split_count, size_t* found,
+    const char** end)
+{
+    // One bit per open container, set for objects
+    uint64_t objects[(JACON_VALIDATE_MAX_DEPTH + 63) / 64];
+    size_t depth = 0;
+    const char* next_split = split_count > 0 ? str + len / (split_count + 1) : NULL;
+    const char* ptr = str;
+    *found = 0;
+    *end = NULL;
+
+    while (*ptr != '\0') {
+        switch (*ptr) {
+            case '"':
+                if (Jacon_skip_string(&ptr) != JACON_OK) return JACON_ERR_INVALID_JSON;
+                continue;
+            case '[':
+            case '{': {
+                if (depth == JACON_VALIDATE_MAX_DEPTH) return JACON_ERR_DEPTH_LIMIT;
+                uint64_t bit = (uint64_t)1 << (depth % 64);
+                if (*ptr == '{') objects[depth / 64] |= bit;
+                else objects[depth / 64] &= ~bit;
+                depth++;
+                break;
+            }
+            case ']':
+            case '}': {
+                if (depth == 0) return JACON_ERR_INVALID_JSON;
+                depth--;
+                bool object = (objects[depth / 64] >> (depth % 64)) & 1;
+                if (object != (*ptr == '}')) return JACON_ERR_INVALID_JSON;
+                if (depth == 0) {
+                    *end = ptr;
+                    return JACON_OK;
+                }
+                break;
+            }
+            case ',':
+                if (depth == 1 && next_split != NULL && ptr >= next_split) {
+                    splits[(*found)++] = ptr;
+                    next_split = *found < split_count ?
+                        str + len / (split_count + 1) * (*found + 1) : NULL;
+                }
+                break;
+            default:
+                break;
+        }
+        ptr++;
+    }
+    return JACON_ERR_INVALID_JSON;
+}
+
+Jacon_Error
+Jacon_parse_parallel(Jacon_content* content, const char* str, size_t thread_count)
+{
+    if (thread_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (size_t)online : 1;
+    }
+    const char* start = Jacon_skip_whitespace(str);
+    size_t len = strlen(start);
+    if (*start != '[' || thread_count < 2 || len < JACON_PARALLEL_MIN_SIZE)
+        return Jacon_deserialize(content, str);
+
+    Jacon_Error ret = JACON_OK;
+    const char* end = NULL;
+    const char** splits = Jacon_calloc(thread_count - 1, sizeof(const char*));
+    Jacon_ParallelChunk* chunks = Jacon_calloc(thread_count, sizeof(Jacon_ParallelChunk));
+    pthread_t* threads = Jacon_calloc(thread_count, sizeof(pthread_t));
+    if (splits == NULL || chunks == NULL || threads == NULL)
+        Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+
+    size_t split_count = 0;
+    ret = Jacon_prescan_array(start, len, splits, thread_count - 1, &split_count, &end);
+    // Too deep to pre-scan, the sequential parser applies its own limits
+    if (ret == JACON_ERR_DEPTH_LIMIT) Jacon_defer_return(Jacon_deserialize(content, str));
+    if (ret != JACON_OK || *Jacon_skip_whitespace(end + 1) != '\0')
+        Jacon_defer_return(JACON_ERR_INVALID_JSON);
+
+    Jacon_Node* root = content->root;
+    root->type = JACON_VALUE_ARRAY;
+    if (*Jacon_skip_whitespace(start + 1) == ']') Jacon_defer_return(Jacon_build_content(content));
+
+    size_t chunk_count = split_count + 1;
+    for (size_t i = 0; i < chunk_count; i++) {
+        chunks[i].begin = i == 0 ? start + 1 : splits[i - 1] + 1;
+        chunks[i].end = i == split_count ? end : splits[i];
+        chunks[i].root = root;
+        chunks[i].allocator = Jacon_scoped_allocator;
+        chunks[i].raw_numbers = content->raw_numbers;
+        chunks[i].elements.type = JACON_VALUE_ARRAY;
+    }
+
+    // The calling thread parses the first chunk
+    size_t spawned = 1;
+    while (spawned < chunk_count) {
+        if (pthread_create(&threads[spawned], NULL, Jacon_parse_parallel_chunk, &chunks[spawned]) != 0) break;
+        spawned++;
+    }
+    for (size_t i = spawned; i < chunk_count; i++) {
+        Jacon_parse_parallel_chunk(&chunks[i]);
+    }
+    Jacon_parse_parallel_chunk(&chunks[0]);
+    for (size_t i = 1; i < spawned; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (chunks[i].ret != JACON_OK && ret == JACON_OK) ret = chunks[i].ret;
+        total += chunks[i].elements.child_count;
+    }
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+
+    // Stitch every chunk childs in order under root
+    root->childs = Jacon_calloc(total, sizeof(Jacon_Node*));
+    if (root->childs == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+    root->child_capacity = total;
+    for (size_t i = 0; i < chunk_count; i++) {
+        memcpy(root->childs + root->child_count, chunks[i].elements.childs,
+            chunks[i].elements.child_count * sizeof(Jacon_Node*));
+        root->child_count += chunks[i].elements.child_count;
+        chunks[i].elements.child_count = 0;
+    }
+
+    ret = Jacon_build_content(content);
+defer:
+    if (chunks != NULL) {
+        for (size_t i = 0; i < thread_count; i++) {
+            for (size_t j = 0; j < chunks[i].elements.child_count; j++) {
+                Jacon_free_node(chunks[i].elements.childs[j]);
+            }
+            Jacon_free(chunks[i].elements.childs);
+        }
+    }
+    Jacon_free(splits);
+    Jacon_free(chunks);
+    Jacon_free(threads);
+    return ret;
+}
+
+Jacon_Error
+Jacon_deserialize_parallel(Jacon_content* content, const char* str, size_t thread_count)
+{
+    if (content == NULL || str == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_Error ret = Jacon_parse_parallel(content, str, thread_count);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+uint64_t
+Jacon_fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+#define JACON_FNV_OFFSET 0xCBF29CE484222325ULL
+
+/**
+ * Reads a raw Json string byte by byte as it decodes, nothing is allocated
+ */
+typedef struct {
+    const char* str;
+    const char* end;
+    // Decoded bytes of the last escape sequence, a surrogate pair takes 12 bytes
+    char pending[12];
+    size_t pending_count;
+    size_t pending_index;
+} Jacon_UnescapeCursor;
+
+/**
+ * Next decoded byte, false at the end of the string. Escapes must already be valid.
+ */
+bool
+Jacon_unescape_next(Jacon_UnescapeCursor* cursor, char* byte)
+{
+    if (cursor->pending_index == cursor->pending_count) {
+        if (cursor->str == cursor->end) return false;
+        cursor->pending_index = 0;
+        if (*cursor->str != '\\') {
+            cursor->pending[0] = *cursor->str++;
+            cursor->pending_count = 1;
+        } else {
+            size_t size = cursor->str[1] == 'u' ? 6 : 2;
+            // A high surrogate is decoded along with the escape that follows it
+            uint32_t code_unit;
+            if (size == 6 && Jacon_read_hex4(cursor->str + 2, cursor->end, &code_unit)
+                && code_unit >= 0xD800 && code_unit <= 0xDBFF
+                && cursor->end - cursor->str >= 12 && cursor->str[6] == '\\' && cursor->str[7] == 'u') {
+                size = 12;
+            }
+            if (Jacon_unescape(cursor->str, size, cursor->pending, false, &cursor->pending_count) != JACON_OK) {
+                return false;
+            }
+            cursor->str += size;
+        }
+    }
+    *byte = cursor->pending[cursor->pending_index++];
+    return true;
+}
+
+/**
+ * Whether the raw Json strings a and b, quotes left out, decode to the same bytes
+ */
+bool
+Jacon_raw_strings_equal(const char* a, size_t a_len, const char* b, size_t b_len)
+{
+    if (a_len == b_len && memcmp(a, b, a_len) == 0) return true;
+    if (memchr(a, '\\', a_len) == NULL && memchr(b, '\\', b_len) == NULL) return false;
+    Jacon_UnescapeCursor a_cursor = { .str = a, .end = a + a_len };
+    Jacon_UnescapeCursor b_cursor = { .str = b, .end = b + b_len };
+    while (true) {
+        char a_byte;
+        char b_byte;
+        bool a_more = Jacon_unescape_next(&a_cursor, &a_byte);
+        bool b_more = Jacon_unescape_next(&b_cursor, &b_byte);
+        if (a_more != b_more) return false;
+        if (!a_more) return true;
+        if (a_byte != b_byte) return false;
+    }
+}
+
+/**
+ * Hash of the bytes the raw Json string of len bytes decodes to
+ */
+uint64_t
+Jacon_raw_string_hash(const char* str, size_t len)
+{
+    if (memchr(str, '\\', len) == NULL) return Jacon_fnv1a(JACON_FNV_OFFSET, str, len);
+    uint64_t hash = JACON_FNV_OFFSET;
+    Jacon_UnescapeCursor cursor = { .str = str, .end = str + len };
+    char byte;
+    while (Jacon_unescape_next(&cursor, &byte)) hash = Jacon_fnv1a(hash, &byte, 1);
+    return hash;
+}
+
+// Member names kept inline before the key table moves to the heap
+#define JACON_KEY_TABLE_INLINE 64
+
+typedef struct {
+    // Object holding the member, any id unique among the open objects
+    size_t object;
+    // Raw name between its quotes
+    size_t start;
+    size_t end;
+    uint64_t hash;
+    size_t slot;
+} Jacon_KeyEntry;
+
+/**
+ * Member names of the open objects of a Json text, to find duplicates in linear time.
+ * Names are stacked in input order and a closing object pops its own, so the table
+ * only ever holds the names of the objects still open.
+ */
+typedef struct {
+    const char* str;
+    Jacon_KeyEntry* keys;
+    size_t count;
+    size_t capacity;
+    // Open addressing over keys, index + 1 and 0 for an empty slot
+    size_t* slots;
+    size_t mask;
+    Jacon_KeyEntry inline_keys[JACON_KEY_TABLE_INLINE];
+    size_t inline_slots[2 * JACON_KEY_TABLE_INLINE];
+} Jacon_KeyTable;
+
+void
+Jacon_key_table_init(Jacon_KeyTable* table, const char* str)
+{
+    table->str = str;
+    table->keys = table->inline_keys;
+    table->count = 0;
+    table->capacity = JACON_KEY_TABLE_INLINE;
+    table->slots = table->inline_slots;
+    table->mask = 2 * JACON_KEY_TABLE_INLINE - 1;
+    memset(table->inline_slots, 0, sizeof(table->inline_slots));
+}
+
+void
+Jacon_key_table_free(Jacon_KeyTable* table)
+{
+    if (table->keys != table->inline_keys) Jacon_free(table->keys);
+    if (table->slots != table->inline_slots) Jacon_free(table->slots);
+    table->keys = table->inline_keys;
+    table->slots = table->inline_slots;
+}
+
+/**
+ * First empty slot on the probe sequence of key, or the slot of an equal name of the same object
+ */
+size_t
+Jacon_key_table_probe(const Jacon_KeyTable* table, const Jacon_KeyEntry* key)
+{
+    size_t slot = key->hash & table->mask;
+    while (table->slots[slot] != 0) {
+        const Jacon_KeyEntry* other = &table->keys[table->slots[slot] - 1];
+        if (other->hash == key->hash && other->object == key->object
+            && Jacon_raw_strings_equal(table->str + other->start, other->end - other->start,
+                table->str + key->start, key->end - key->start)) {
+            return slot;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+    return slot;
+}
+
+/**
+ * Twice the room, the names are inserted again in order so closing objects still pops them exactly
+ */
+Jacon_Error
+Jacon_key_table_grow(Jacon_KeyTable* table)
+{
+    size_t capacity = table->capacity * 2;
+    Jacon_KeyEntry* keys = Jacon_malloc(capacity * sizeof(Jacon_KeyEntry));
+    size_t* slots = Jacon_calloc(2 * capacity, sizeof(size_t));
+    if (keys == NULL || slots == NULL) {
+        Jacon_free(keys);
+        Jacon_free(slots);
+        return JACON_ERR_MEMORY_ALLOCATION;
+    }
+    memcpy(keys, table->keys, table->count * sizeof(Jacon_KeyEntry));
+    Jacon_key_table_free(table);
+    table->keys = keys;
+    table->slots = slots;
+    table->capacity = capacity;
+    table->mask = 2 * capacity - 1;
+    for (size_t i = 0; i < table->count; i++) {
+        keys[i].slot = Jacon_key_table_probe(table, &keys[i]);
+        slots[keys[i].slot] = i + 1;
+    }
+    return JACON_OK;
+}
+
+/**
+ * Add the member name between the quotes at start - 1 and end to object,
+ * JACON_ERR_DUPLICATE_NAME if the object already has a member of that name once decoded
+ */
+Jacon_Error
+Jacon_key_table_add(Jacon_KeyTable* table, size_t object, size_t start, size_t end)
+{
+    if (table->count == table->capacity) {
+        Jacon_Error ret = Jacon_key_table_grow(table);
+        if (ret != JACON_OK) return ret;
+    }
+    Jacon_KeyEntry key = {
+        .object = object,
+        .start = start,
+        .end = end,
+        // The same name in different objects lands apart
+        .hash = Jacon_raw_string_hash(table->str + start, end - start) ^ (object * 0x9E3779B97F4A7C15ULL),
+    };
+    key.slot = Jacon_key_table_probe(table, &key);
+    if (table->slots[key.slot] != 0) return JACON_ERR_DUPLICATE_NAME;
+    table->keys[table->count++] = key;
+    table->slots[key.slot] = table->count;
+    return JACON_OK;
+}
+
+/**
+ * Forget the names of object, the last one opened
+ */
+void
+Jacon_key_table_close(Jacon_KeyTable* table, size_t object)
+{
+    // Undone in reverse, every slot freed was the first empty one when it was taken
+    while (table->count > 0 && table->keys[table->count - 1].object == object) {
+        table->slots[table->keys[--table->count].slot] = 0;
+    }
+}
+
+typedef struct {
+    // Where the container starts in the output
+    size_t offset;
+    // Elements of an array, pairs of an object
+    size_t count;
+    bool object;
+} Jacon_TranscodeFrame;
+
+// Room left for a MessagePack array or map header, the count is only known once closed
+#define JACON_MSGPACK_HEAD_RESERVE 5
+
+typedef enum {
+    JACON_EXPECT_VALUE,
+    JACON_EXPECT_FIRST_VALUE,
+    JACON_EXPECT_KEY,
+    JACON_EXPECT_FIRST_KEY,
+    JACON_EXPECT_COLON,
+    JACON_EXPECT_SEPARATOR,
+} Jacon_TranscodeState;
+
+void
+Jacon_put_be(char* out, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (char)(value >> (8 * (size - 1 - i)));
+    }
+}
+
+uint64_t
+Jacon_get_be(const unsigned char* data, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) value = (value << 8) | data[i];
+    return value;
+}
+
+/**
+ * CBOR initial byte and argument, returns the header size
+ */
+size_t
+Jacon_cbor_head(char* out, unsigned char major, uint64_t argument)
+{
+    size_t size;
+    unsigned char info;
+    if (argument < 24) {
+        out[0] = (char)((major << 5) | argument);
+        return 1;
+    }
+    if (argument <= 0xFF) { info = 24; size = 1; }
+    else if (argument <= 0xFFFF) { info = 25; size = 2; }
+    else if (argument <= 0xFFFFFFFF) { info = 26; size = 4; }
+    else { info = 27; size = 8; }
+    out[0] = (char)((major << 5) | info);
+    Jacon_put_be(out + 1, argument, size);
+    return size + 1;
+}
+
+/**
+ * MessagePack header of a string, array or map of length size.
+ * tag8 is 0 for types without an 8 bit length. Returns 0 if size does not fit.
+ */
+size_t
+Jacon_msgpack_sized_head(char* out, uint64_t size, unsigned char fix, uint64_t fix_limit,
+    unsigned char tag8, unsigned char tag16, unsigned char tag32)
+{
+    if (size < fix_limit) {
+        out[0] = (char)(fix | size);
+        return 1;
+    }
+    if (tag8 != 0 && size <= 0xFF) {
+        out[0] = (char)tag8;
+        out[1] = (char)size;
+        return 2;
+    }
+    if (size <= 0xFFFF) {
+        out[0] = (char)tag16;
+        Jacon_put_be(out + 1, size, 2);
+        return 3;
+    }
+    if (size <= 0xFFFFFFFF) {
+        out[0] = (char)tag32;
+        Jacon_put_be(out + 1, size, 4);
+        return 5;
+    }
+    return 0;
+}
+
+/**
+ * Insert a header at offset, in front of what was written since
+ */
+Jacon_Error
+Jacon_insert_head(Jacon_StringBuilder* out, size_t offset, const char* head, size_t head_size)
+{
+    if (head_size == 0) return JACON_ERR_INVALID_SIZE;
+    Jacon_Error ret = Jacon_str_reserve(out, head_size);
+    if (ret != JACON_OK) return ret;
+    memmove(out->string + offset + head_size, out->string + offset, out->count - offset);
+    memcpy(out->string + offset, head, head_size);
+    out->count += head_size;
+    out->string[out->count] = '\0';
+    return JACON_OK;
+}
+
+/**
+ * Integer of value -magnitude when negative, magnitude otherwise
+ */
+Jacon_Error
+Jacon_binary_write_int(Jacon_StringBuilder* out, Jacon_BinaryFormat format, bool negative, uint64_t magnitude)
+{
+    char head[9];
+    size_t size;
+    if (format == JACON_FORMAT_CBOR) {
+        size = negative ? Jacon_cbor_head(head, 1, magnitude - 1) : Jacon_cbor_head(head, 0, magnitude);
+        return Jacon_str_append_n(out, head, size);
+    }
+    if (!negative) {
+        if (magnitude < 0x80) { head[0] = (char)magnitude; size = 1; }
+        else if (magnitude <= 0xFF) { head[0] = (char)0xCC; size = 1; }
+        else if (magnitude <= 0xFFFF) { head[0] = (char)0xCD; size = 2; }
+        else if (magnitude <= 0xFFFFFFFF) { head[0] = (char)0xCE; size = 4; }
+        else { head[0] = (char)0xCF; size = 8; }
+        if (magnitude >= 0x80) Jacon_put_be(head + 1, magnitude, size++);
+        return Jacon_str_append_n(out, head, size);
+    }
+    // Two's complement of the value, magnitude is at most 2^63 here
+    uint64_t value = ~magnitude + 1;
+    if (magnitude <= 32) { head[0] = (char)value; size = 1; }
+    else if (magnitude <= 0x80) { head[0] = (char)0xD0; size = 1; }
+    else if (magnitude <= 0x8000) { head[0] = (char)0xD1; size = 2; }
+    else if (magnitude <= 0x80000000) { head[0] = (char)0xD2; size = 4; }
+    else { head[0] = (char)0xD3; size = 8; }
+    if (magnitude > 32) Jacon_put_be(head + 1, value, size++);
+    return Jacon_str_append_n(out, head, size);
+}
+
+/**
+ * Doubles exactly representable as floats are written as floats
+ */
+Jacon_Error
+Jacon_binary_write_double(Jacon_StringBuilder* out, Jacon_BinaryFormat format, double value)
+{
+    char head[9];
+    size_t size;
+    float single = (float)value;
+    bool cbor = format == JACON_FORMAT_CBOR;
+    if ((double)single == value || value != value) {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        head[0] = (char)(cbor ? 0xFA : 0xCA);
+        Jacon_put_be(head + 1, bits, 4);
+        size = 5;
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        head[0] = (char)(cbor ? 0xFB : 0xCB);
+        Jacon_put_be(head + 1, bits, 8);
+        size = 9;
+    }
+    return Jacon_str_append_n(out, head, size);
+}
+
+/**
+ * *str points to the opening quote, it is left after the closing one
+ */
+Jacon_Error
+Jacon_binary_write_string(Jacon_StringBuilder* out, Jacon_BinaryFormat format, const char** str)
+{
+    const char* start = *str + 1;
+    Jacon_Error ret = Jacon_skip_string(str);
+    if (ret != JACON_OK) return ret;
+
+    // The unescaped length is only known once written, the header goes in front afterwards
+    size_t offset = out->count;
+    ret = Jacon_str_append_unescaped(out, start, *str - 1 - start);
+    if (ret != JACON_OK) return ret;
+    size_t size = out->count - offset;
+    char head[9];
+    size_t head_size = format == JACON_FORMAT_CBOR
+        ? Jacon_cbor_head(head, 3, size)
+        : Jacon_msgpack_sized_head(head, size, 0xA0, 32, 0xD9, 0xDA, 0xDB);
+    return Jacon_insert_head(out, offset, head, head_size);
+}
+
+Jacon_Error
+Jacon_binary_write_number(Jacon_StringBuilder* out, Jacon_BinaryFormat format, const char** str)
+{
+    bool integral;
+    size_t size = Jacon_scan_number(*str, &integral);
+    if (size == 0) return JACON_ERR_INVALID_JSON;
+
+    const char* ptr = *str;
+    bool negative = *ptr == '-';
+    if (integral) {
+        uint64_t magnitude = 0;
+        for (ptr += negative; ptr < *str + size; ptr++) {
+            uint64_t digit = *ptr - '0';
+            if (magnitude > (UINT64_MAX - digit) / 10) {
+                integral = false;
+                break;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        // MessagePack has no negative integer below -2^63
+        if (negative && format == JACON_FORMAT_MSGPACK && magnitude > (UINT64_MAX >> 1) + 1) {
+            integral = false;
+        }
+        if (integral && !(negative && magnitude == 0)) {
+            *str += size;
+            return Jacon_binary_write_int(out, format, negative, magnitude);
+        }
+    }
+    // -0 is kept as a float
+    double value = strtod(*str, NULL);
+    *str += size;
+    return Jacon_binary_write_double(out, format, value);
+}
+
+/**
+ * Close the innermost container, MessagePack headers are written by Jacon_msgpack_write_heads
+ */
+Jacon_Error
+Jacon_binary_close(Jacon_StringBuilder* out, Jacon_BinaryFormat format)
+{
+    if (format != JACON_FORMAT_CBOR) return JACON_OK;
+    return Jacon_str_append_n(out, "\xFF", 1);
+}
+
+/**
+ * Write the headers of every MessagePack container, in output order, over their reserved room.
+ * The output is compacted in the same pass so each byte moves once.
+ */
+Jacon_Error
+Jacon_msgpack_write_heads(Jacon_StringBuilder* out, const Jacon_TranscodeFrame* heads, size_t head_count)
+{
+    if (head_count == 0) return JACON_OK;
+    size_t read = heads[0].offset;
+    size_t write = read;
+    for (size_t i = 0; i < head_count; i++) {
+        memmove(out->string + write, out->string + read, heads[i].offset - read);
+        write += heads[i].offset - read;
+        char head[JACON_MSGPACK_HEAD_RESERVE];
+        size_t head_size = heads[i].object
+            ? Jacon_msgpack_sized_head(head, heads[i].count, 0x80, 16, 0, 0xDE, 0xDF)
+            : Jacon_msgpack_sized_head(head, heads[i].count, 0x90, 16, 0, 0xDC, 0xDD);
+        if (head_size == 0) return JACON_ERR_INVALID_SIZE;
+        memcpy(out->string + write, head, head_size);
+        write += head_size;
+        read = heads[i].offset + JACON_MSGPACK_HEAD_RESERVE;
+    }
+    memmove(out->string + write, out->string + read, out->count - read);
+    out->count = write + out->count - read;
+    out->string[out->count] = '\0';
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_json_to_binary(const char* str, Jacon_BinaryFormat format, Jacon_StringBuilder* out)
+{
+    if (str == NULL || out == NULL) return JACON_ERR_NULL_PARAM;
+
+    Jacon_Error ret = JACON_OK;
+    // Every container in output order, frames holds the open ones
+    Jacon_TranscodeFrame* heads = NULL;
+    size_t head_count = 0;
+    size_t head_capacity = 0;
+    size_t* frames = NULL;
+    size_t depth = 0;
+    size_t frame_capacity = 0;
+    size_t start_count = out->count;
+    Jacon_TranscodeState state = JACON_EXPECT_VALUE;
+    const char* ptr = str;
+    // Member names of the open objects, told apart by their head
+    Jacon_KeyTable keys;
+    Jacon_key_table_init(&keys, str);
+
+    while (true) {
+        ptr = Jacon_skip_whitespace(ptr);
+        Jacon_TranscodeFrame* top = depth > 0 ? &heads[frames[depth - 1]] : NULL;
+        switch (state) {
+            case JACON_EXPECT_SEPARATOR:
+                if (top == NULL) {
+                    if (*ptr != '\0') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                    if (format == JACON_FORMAT_CBOR) Jacon_defer_return(JACON_OK);
+                    Jacon_defer_return(Jacon_msgpack_write_heads(out, heads, head_count));
+                }
+                if (*ptr == ',') {
+                    ptr++;
+                    state = top->object ? JACON_EXPECT_KEY : JACON_EXPECT_VALUE;
+                    continue;
+                }
+                if (*ptr != (top->object ? '}' : ']')) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                ptr++;
+                ret = Jacon_binary_close(out, format);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                if (top->object) Jacon_key_table_close(&keys, frames[depth - 1]);
+                depth--;
+                continue;
+            case JACON_EXPECT_COLON:
+                if (*ptr++ != ':') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                state = JACON_EXPECT_VALUE;
+                continue;
+            case JACON_EXPECT_FIRST_KEY:
+            case JACON_EXPECT_FIRST_VALUE:
+                if (*ptr == (state == JACON_EXPECT_FIRST_KEY ? '}' : ']')) {
+                    ptr++;
+                    ret = Jacon_binary_close(out, format);
+                    if (ret != JACON_OK) Jacon_defer_return(ret);
+                    depth--;
+                    state = JACON_EXPECT_SEPARATOR;
+                    continue;
+                }
+                state = state == JACON_EXPECT_FIRST_KEY ? JACON_EXPECT_KEY : JACON_EXPECT_VALUE;
+                continue;
+            case JACON_EXPECT_KEY: {
+                if (*ptr != '"') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                top->count++;
+                const char* key = ptr;
+                ret = Jacon_binary_write_string(out, format, &ptr);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                // Rejected as Jacon_validate does, decoders would keep either value
+                ret = Jacon_key_table_add(&keys, frames[depth - 1], key + 1 - str, ptr - 1 - str);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                state = JACON_EXPECT_COLON;
+                continue;
+            }
+            case JACON_EXPECT_VALUE:
+            default:
+                break;
+        }
+
+        if (top != NULL && !top->object) top->count++;
+        state = JACON_EXPECT_SEPARATOR;
+        switch (*ptr) {
+            case '{':
+            case '[':
+                if (depth == frame_capacity) {
+                    size_t new_capacity = frame_capacity == 0 ? 16 : frame_capacity * 2;
+                    size_t* tmp = Jacon_realloc(frames, new_capacity * sizeof(size_t));
+                    if (tmp == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+                    frames = tmp;
+                    frame_capacity = new_capacity;
+                }
+                if (head_count == head_capacity) {
+                    size_t new_capacity = head_capacity == 0 ? 16 : head_capacity * 2;
+                    Jacon_TranscodeFrame* tmp = Jacon_realloc(heads, new_capacity * sizeof(Jacon_TranscodeFrame));
+                    if (tmp == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+                    heads = tmp;
+                    head_capacity = new_capacity;
+                }
+                heads[head_count] = (Jacon_TranscodeFrame){
+                    .offset = out->count,
+                    .count = 0,
+                    .object = *ptr == '{',
+                };
+                frames[depth++] = head_count++;
+                // CBOR containers are indefinite length, closed by a break byte
+                static const char reserve[JACON_MSGPACK_HEAD_RESERVE] = {0};
+                if (format == JACON_FORMAT_CBOR) ret = Jacon_str_append_n(out, *ptr == '{' ? "\xBF" : "\x9F", 1);
+                else ret = Jacon_str_append_n(out, reserve, JACON_MSGPACK_HEAD_RESERVE);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                state = *ptr == '{' ? JACON_EXPECT_FIRST_KEY : JACON_EXPECT_FIRST_VALUE;
+                ptr++;
+                break;
+            case '"':
+                ret = Jacon_binary_write_string(out, format, &ptr);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                break;
+            case 't':
+            case 'f':
+            case 'n': {
+                const char* literal = *ptr == 't' ? "true" : *ptr == 'f' ? "false" : "null";
+                size_t size = strlen(literal);
+                if (strncmp(ptr, literal, size) != 0) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                ptr += size;
+                char byte;
+                if (format == JACON_FORMAT_CBOR) byte = *literal == 't' ? '\xF5' : *literal == 'f' ? '\xF4' : '\xF6';
+                else byte = *literal == 't' ? '\xC3' : *literal == 'f' ? '\xC2' : '\xC0';
+                ret = Jacon_str_append_n(out, &byte, 1);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                break;
+            }
+            case '\0':
+                Jacon_defer_return(ptr == Jacon_skip_whitespace(str) ? JACON_ERR_EMPTY_INPUT : JACON_ERR_INVALID_JSON);
+            default:
+                ret = Jacon_binary_write_number(out, format, &ptr);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                break;
+        }
+    }
+
+defer:
+    // Leave out as it was on failure
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    Jacon_key_table_free(&keys);
+    Jacon_free(frames);
+    Jacon_free(heads);
+    return ret;
+}
+
+typedef struct {
+    // Items left in a definite length container
+    uint64_t remaining;
+    // Items written so far, keys and values both count for maps
+    uint64_t items;
+    bool object;
+    bool indefinite;
+} Jacon_DecodeFrame;
+
+float
+Jacon_half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Subnormal half, normal float
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Read the length or value argument of a MessagePack item of size bytes
+ */
+Jacon_Error
+Jacon_binary_read(const unsigned char** data, const unsigned char* end, size_t size, uint64_t* value)
+{
+    if ((size_t)(end - *data) < size) return JACON_ERR_INVALID_BINARY;
+    *value = Jacon_get_be(*data, size);
+    *data += size;
+    return JACON_OK;
+}
+
+/**
+ * Read a CBOR item head, info is the low 5 bits of the initial byte,
+ * 31 being an indefinite length
+ */
+Jacon_Error
+Jacon_cbor_read_head(const unsigned char** data, const unsigned char* end,
+    unsigned char* major, unsigned char* info, uint64_t* argument)
+{
+    if (*data >= end) return JACON_ERR_INVALID_BINARY;
+    unsigned char byte = *(*data)++;
+    *info = byte & 0x1F;
+    *major = byte >> 5;
+    *argument = 0;
+    if (*info < 24) {
+        *argument = *info;
+        return JACON_OK;
+    }
+    if (*info <= 27) return Jacon_binary_read(data, end, (size_t)1 << (*info - 24), argument);
+    if (*info == 31 && *major >= 2 && *major != 6) return JACON_OK;
+    // Reserved additional information, or a break outside of a container
+    return JACON_ERR_INVALID_BINARY;
+}
+
+Jacon_Error
+Jacon_json_write_string(Jacon_StringBuilder* out, const unsigned char** data, const unsigned char* end, uint64_t size)
+{
+    if ((uint64_t)(end - *data) < size) return JACON_ERR_INVALID_BINARY;
+    Jacon_Error ret = Jacon_str_append_escaped(out, (const char*)*data, size);
+    *data += size;
+    return ret;
+}
+
+/**
+ * Decode one MessagePack item, containers only get opened.
+ * type tells strings, arrays and objects apart, it is JACON_VALUE_NULL for any other item
+ */
+Jacon_Error
+Jacon_msgpack_decode_item(Jacon_StringBuilder* out, const unsigned char** data, const unsigned char* end,
+    Jacon_DecodeFrame* container, Jacon_ValueType* type)
+{
+    char buffer[32];
+    uint64_t value;
+    Jacon_Error ret;
+    unsigned char byte = *(*data)++;
+    *type = JACON_VALUE_NULL;
+    container->remaining = 0;
+
+    if (byte <= 0x7F) {
+        snprintf(buffer, sizeof(buffer), "%u", byte);
+        return Jacon_str_append_n(out, buffer, strlen(buffer));
+    }
+    if (byte >= 0xE0) {
+        snprintf(buffer, sizeof(buffer), "%d", (int)(signed char)byte);
+        return Jacon_str_append_n(out, buffer, strlen(buffer));
+    }
+    if ((byte & 0xE0) == 0xA0 || byte == 0xD9 || byte == 0xDA || byte == 0xDB) {
+        if ((byte & 0xE0) == 0xA0) value = byte & 0x1F;
+        else if ((ret = Jacon_binary_read(data, end, (size_t)1 << (byte - 0xD9), &value)) != JACON_OK) return ret;
+        *type = JACON_VALUE_STRING;
+        if ((ret = Jacon_str_append_n(out, "\"", 1)) != JACON_OK) return ret;
+        if ((ret = Jacon_json_write_string(out, data, end, value)) != JACON_OK) return ret;
+        return Jacon_str_append_n(out, "\"", 1);
+    }
+    if ((byte & 0xF0) == 0x90 || (byte & 0xF0) == 0x80 || (byte >= 0xDC && byte <= 0xDF)) {
+        container->object = (byte & 0xF0) == 0x80 || byte == 0xDE || byte == 0xDF;
+        if ((byte & 0xF0) == 0x90 || (byte & 0xF0) == 0x80) value = byte & 0x0F;
+        else if ((ret = Jacon_binary_read(data, end, (byte & 1) ? 4 : 2, &value)) != JACON_OK) return ret;
+        container->remaining = container->object ? value * 2 : value;
+        container->indefinite = false;
+        *type = container->object ? JACON_VALUE_OBJECT : JACON_VALUE_ARRAY;
+        return Jacon_str_append_n(out, container->object ? "{" : "[", 1);
+    }
+    switch (byte) {
+        case 0xC0:
+            return Jacon_str_append_n(out, "null", 4);
+        case 0xC2:
+            return Jacon_str_append_n(out, "false", 5);
+        case 0xC3:
+            return Jacon_str_append_n(out, "true", 4);
+        case 0xCA: {
+            if ((ret = Jacon_binary_read(data, end, 4, &value)) != JACON_OK) return ret;
+            uint32_t bits = (uint32_t)value;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            return Jacon_json_write_double(out, single);
+        }
+        case 0xCB: {
+            if ((ret = Jacon_binary_read(data, end, 8, &value)) != JACON_OK) return ret;
+            double number;
+            memcpy(&number, &value, sizeof(number));
+            return Jacon_json_write_double(out, number);
+        }
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            if ((ret = Jacon_binary_read(data, end, (size_t)1 << (byte - 0xCC), &value)) != JACON_OK) return ret;
+            snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+            return Jacon_str_append_n(out, buffer, strlen(buffer));
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3: {
+            size_t size = (size_t)1 << (byte - 0xD0);
+            if ((ret = Jacon_binary_read(data, end, size, &value)) != JACON_OK) return ret;
+            // Sign extend the big endian value
+            int64_t number = size == 8 ? (int64_t)value
+                : (int64_t)(value ^ ((uint64_t)1 << (size * 8 - 1))) - ((int64_t)1 << (size * 8 - 1));
+            snprintf(buffer, sizeof(buffer), "%" PRId64, number);
+            return Jacon_str_append_n(out, buffer, strlen(buffer));
+        }
+        default:
+            // Binaries, extensions and the never used byte have no Json equivalent
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+}
+
+/**
+ * Same as Jacon_msgpack_decode_item for CBOR, tags are skipped
+ */
+Jacon_Error
+Jacon_cbor_decode_item(Jacon_StringBuilder* out, const unsigned char** data, const unsigned char* end,
+    Jacon_DecodeFrame* container, Jacon_ValueType* type)
+{
+    char buffer[32];
+    unsigned char major;
+    unsigned char info;
+    uint64_t argument;
+    Jacon_Error ret;
+    *type = JACON_VALUE_NULL;
+    container->remaining = 0;
+
+    do {
+        ret = Jacon_cbor_read_head(data, end, &major, &info, &argument);
+        if (ret != JACON_OK) return ret;
+    } while (major == 6);
+    bool indefinite = info == 31;
+
+    switch (major) {
+        case 0:
+            snprintf(buffer, sizeof(buffer), "%" PRIu64, argument);
+            return Jacon_str_append_n(out, buffer, strlen(buffer));
+        case 1:
+            // Value is -1 - argument, which may not fit in an int64_t
+            if (argument == UINT64_MAX) return Jacon_str_append_n(out, "-18446744073709551616", 21);
+            snprintf(buffer, sizeof(buffer), "-%" PRIu64, argument + 1);
+            return Jacon_str_append_n(out, buffer, strlen(buffer));
+        case 3:
+            *type = JACON_VALUE_STRING;
+            if ((ret = Jacon_str_append_n(out, "\"", 1)) != JACON_OK) return ret;
+            if (!indefinite) {
+                ret = Jacon_json_write_string(out, data, end, argument);
+            } else {
+                // Definite length text chunks up to a break
+                while (ret == JACON_OK) {
+                    if (*data >= end) return JACON_ERR_INVALID_BINARY;
+                    if (**data == 0xFF) {
+                        (*data)++;
+                        break;
+                    }
+                    unsigned char chunk_major;
+                    unsigned char chunk_info;
+                    ret = Jacon_cbor_read_head(data, end, &chunk_major, &chunk_info, &argument);
+                    if (ret != JACON_OK) return ret;
+                    if (chunk_major != 3 || chunk_info == 31) return JACON_ERR_INVALID_BINARY;
+                    ret = Jacon_json_write_string(out, data, end, argument);
+                }
+            }
+            if (ret != JACON_OK) return ret;
+            return Jacon_str_append_n(out, "\"", 1);
+        case 4:
+        case 5:
+            container->object = major == 5;
+            container->indefinite = indefinite;
+            if (container->object && argument > UINT64_MAX / 2) return JACON_ERR_INVALID_BINARY;
+            container->remaining = container->object ? argument * 2 : argument;
+            *type = container->object ? JACON_VALUE_OBJECT : JACON_VALUE_ARRAY;
+            return Jacon_str_append_n(out, container->object ? "{" : "[", 1);
+        case 7:
+            switch (argument) {
+                case 20:
+                    return Jacon_str_append_n(out, "false", 5);
+                case 21:
+                    return Jacon_str_append_n(out, "true", 4);
+                case 22:
+                case 23:
+                    return Jacon_str_append_n(out, "null", 4);
+                default:
+                    break;
+            }
+            switch (info) {
+                case 25:
+                    return Jacon_json_write_double(out, Jacon_half_to_float((uint16_t)argument));
+                case 26: {
+                    uint32_t bits = (uint32_t)argument;
+                    float single;
+                    memcpy(&single, &bits, sizeof(single));
+                    return Jacon_json_write_double(out, single);
+                }
+                case 27: {
+                    double number;
+                    memcpy(&number, &argument, sizeof(number));
+                    return Jacon_json_write_double(out, number);
+                }
+                default:
+                    return JACON_ERR_INVALID_VALUE_TYPE;
+            }
+        case 2:
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+}
+
+Jacon_Error
+Jacon_binary_to_json(const char* data, size_t size, Jacon_BinaryFormat format, Jacon_StringBuilder* out)
+{
+    if ((data == NULL && size > 0) || out == NULL) return JACON_ERR_NULL_PARAM;
+    if (size == 0) return JACON_ERR_EMPTY_INPUT;
+
+    Jacon_Error ret = JACON_OK;
+    const unsigned char* ptr = (const unsigned char*)data;
+    const unsigned char* end = ptr + size;
+    Jacon_DecodeFrame* frames = NULL;
+    size_t depth = 0;
+    size_t frame_capacity = 0;
+    size_t start_count = out->count;
+
+    do {
+        bool is_key = false;
+        if (depth > 0) {
+            Jacon_DecodeFrame* top = &frames[depth - 1];
+            bool closing = !top->indefinite && top->remaining == 0;
+            if (top->indefinite) {
+                if (ptr >= end) Jacon_defer_return(JACON_ERR_INVALID_BINARY);
+                if (*ptr == 0xFF) {
+                    ptr++;
+                    closing = true;
+                    // A key without its value
+                    if (top->object && top->items % 2 != 0) Jacon_defer_return(JACON_ERR_INVALID_BINARY);
+                }
+            }
+            if (closing) {
+                ret = Jacon_str_append_n(out, top->object ? "}" : "]", 1);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                depth--;
+                continue;
+            }
+            if (top->items > 0) {
+                ret = Jacon_str_append_n(out, top->object && top->items % 2 != 0 ? ":" : ",", 1);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+            }
+            is_key = top->object && top->items % 2 == 0;
+            top->items++;
+            if (!top->indefinite) top->remaining--;
+        }
+        if (ptr >= end) Jacon_defer_return(JACON_ERR_INVALID_BINARY);
+
+        Jacon_DecodeFrame container = {0};
+        Jacon_ValueType type;
+        ret = format == JACON_FORMAT_CBOR
+            ? Jacon_cbor_decode_item(out, &ptr, end, &container, &type)
+            : Jacon_msgpack_decode_item(out, &ptr, end, &container, &type);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        if (is_key && type != JACON_VALUE_STRING) Jacon_defer_return(JACON_ERR_INVALID_VALUE_TYPE);
+
+        if (type == JACON_VALUE_ARRAY || type == JACON_VALUE_OBJECT) {
+            if (depth == frame_capacity) {
+                size_t new_capacity = frame_capacity == 0 ? 16 : frame_capacity * 2;
+                Jacon_DecodeFrame* tmp = Jacon_realloc(frames, new_capacity * sizeof(Jacon_DecodeFrame));
+                if (tmp == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+                frames = tmp;
+                frame_capacity = new_capacity;
+            }
+            frames[depth++] = container;
+        }
+    } while (depth > 0);
+
+    if (ptr != end) ret = JACON_ERR_INVALID_BINARY;
+defer:
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    Jacon_free(frames);
+    return ret;
+}
+
+typedef struct {
+    Jacon_SnapshotNode* nodes;
+    // Tree node each snapshot node comes from
+    const Jacon_Node** sources;
+    size_t node_count;
+    Jacon_StringBuilder strings;
+    Jacon_SnapshotBucket* index;
+    size_t index_capacity;
+} Jacon_SnapshotWriter;
+
+size_t
+Jacon_count_nodes(const Jacon_Node* node)
+{
+    size_t count = 1;
+    for (size_t i = 0; i < node->child_count; i++) count += Jacon_count_nodes(node->childs[i]);
+    return count;
+}
+
+/**
+ * Append a NUL terminated string to the blob and give its offset
+ */
+Jacon_Error
+Jacon_snapshot_add_string(Jacon_SnapshotWriter* writer, const char* str, size_t size, uint64_t* offset)
+{
+    *offset = writer->strings.count;
+    return Jacon_str_append_n(&writer->strings, str, size + 1);
+}
+
+Jacon_Error
+Jacon_snapshot_add_path(Jacon_SnapshotWriter* writer, const Jacon_StringBuilder* path, size_t node_index)
+{
+    uint64_t hash = Jacon_hash((unsigned char*)path->string);
+    size_t mask = writer->index_capacity - 1;
+    size_t bucket = hash & mask;
+    size_t probes = 0;
+    while (writer->index[bucket].key != JACON_SNAPSHOT_NONE) {
+        // The table is sized from the paths found in the tree, a full one means they changed
+        if (++probes > writer->index_capacity) return JACON_ERR_INVALID_SIZE;
+        Jacon_SnapshotBucket* current = &writer->index[bucket];
+        // Last duplicate wins, as in the content map
+        if (current->hash == hash && strcmp(writer->strings.string + current->key, path->string) == 0) {
+            current->node = node_index;
+            return JACON_OK;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    writer->index[bucket].hash = hash;
+    writer->index[bucket].node = node_index;
+    return Jacon_snapshot_add_string(writer, path->string, path->count, &writer->index[bucket].key);
+}
+
+/**
+ * Paths Jacon_snapshot_index_node adds below node_index, duplicates included
+ */
+size_t
+Jacon_snapshot_count_paths(const Jacon_SnapshotWriter* writer, size_t node_index)
+{
+    const Jacon_Node* node = writer->sources[node_index];
+    if (node->type != JACON_VALUE_OBJECT) return 1;
+    size_t count = 0;
+    for (size_t i = 0; i < node->child_count; i++) {
+        count += Jacon_snapshot_count_paths(writer, writer->nodes[node_index].first_child + i);
+    }
+    return count;
+}
+
+/**
+ * Index the same paths as Jacon_add_node_to_map, pointing to the snapshot nodes
+ */
+Jacon_Error
+Jacon_snapshot_index_node(Jacon_SnapshotWriter* writer, size_t node_index, Jacon_StringBuilder* path)
+{
+    Jacon_Error ret = JACON_OK;
+    const Jacon_Node* node = writer->sources[node_index];
+    size_t path_count = path->count;
+    if (node->type == JACON_VALUE_OBJECT && node->child_count == 0) return JACON_OK;
+
+    if (node->name != NULL) {
+        ret = Jacon_str_append_n(path, node->name, strlen(node->name));
+        if (ret != JACON_OK) return ret;
+    }
+    if (node->type != JACON_VALUE_OBJECT) {
+        // A root array or scalar is reached through Jacon_snapshot_root only
+        if (path->count > 0) ret = Jacon_snapshot_add_path(writer, path, node_index);
+    } else {
+        if (node->name != NULL) ret = Jacon_str_append_n(path, ".", 1);
+        for (size_t i = 0; i < node->child_count && ret == JACON_OK; i++) {
+            ret = Jacon_snapshot_index_node(writer, writer->nodes[node_index].first_child + i, path);
+        }
+    }
+    path->count = path_count;
+    if (path->string != NULL) path->string[path->count] = '\0';
+    return ret;
+}
+
+Jacon_Error
+Jacon_build_snapshot(Jacon_content* content, Jacon_SnapshotWriter* writer)
+{
+    Jacon_Error ret;
+    size_t total = Jacon_count_nodes(content->root);
+    writer->nodes = Jacon_calloc(total, sizeof(Jacon_SnapshotNode));
+    writer->sources = Jacon_calloc(total, sizeof(Jacon_Node*));
+    if (writer->nodes == NULL || writer->sources == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+
+    // Breadth first, sources doubles as the queue
+    writer->sources[writer->node_count++] = content->root;
+    for (size_t i = 0; i < writer->node_count; i++) {
+        // Snapshot nodes are typed, raw numbers are stored converted
+        Jacon_Node decoded = Jacon_decode_number(writer->sources[i]);
+        const Jacon_Node* source = &decoded;
+        Jacon_SnapshotNode* node = &writer->nodes[i];
+        node->type = source->type;
+        node->name = JACON_SNAPSHOT_NONE;
+        if (source->name != NULL) {
+            ret = Jacon_snapshot_add_string(writer, source->name, strlen(source->name), &node->name);
+            if (ret != JACON_OK) return ret;
+        }
+        switch (source->type) {
+            case JACON_VALUE_STRING:
+                ret = Jacon_snapshot_add_string(writer, source->value.string_val,
+                    strlen(source->value.string_val), &node->value.string);
+                if (ret != JACON_OK) return ret;
+                break;
+            case JACON_VALUE_INT:
+                node->value.int_val = source->value.int_val;
+                break;
+            case JACON_VALUE_FLOAT:
+                node->value.float_val = source->value.float_val;
+                break;
+            case JACON_VALUE_DOUBLE:
+                node->value.double_val = source->value.double_val;
+                break;
+            case JACON_VALUE_BOOLEAN:
+                node->value.bool_val = source->value.bool_val;
+                break;
+            case JACON_VALUE_NULL:
+            case JACON_VALUE_NUMBER:
+            case JACON_VALUE_ARRAY:
+            case JACON_VALUE_OBJECT:
+            default:
+                break;
+        }
+        node->first_child = writer->node_count;
+        node->child_count = source->child_count;
+        for (size_t j = 0; j < source->child_count; j++) {
+            writer->sources[writer->node_count++] = source->childs[j];
+        }
+    }
+
+    writer->index_capacity = 16;
+    // Sized from the tree rather than the content index, mutations may have left them apart
+    size_t path_count = Jacon_snapshot_count_paths(writer, 0);
+    while (writer->index_capacity < path_count * 2) writer->index_capacity *= 2;
+    writer->index = Jacon_malloc(writer->index_capacity * sizeof(Jacon_SnapshotBucket));
+    if (writer->index == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    for (size_t i = 0; i < writer->index_capacity; i++) {
+        writer->index[i] = (Jacon_SnapshotBucket){ .key = JACON_SNAPSHOT_NONE };
+    }
+    Jacon_StringBuilder path = {0};
+    ret = Jacon_snapshot_index_node(writer, 0, &path);
+    Jacon_str_free(&path);
+    if (ret != JACON_OK) return ret;
+
+    // Keep the index aligned
+    static const char padding[8] = {0};
+    return Jacon_str_append_n(&writer->strings, padding, (8 - writer->strings.count % 8) % 8);
+}
+
+Jacon_Error
+Jacon_write_snapshot(Jacon_SnapshotWriter* writer, const char* path)
+{
+    Jacon_SnapshotHeader header = {
+        .magic = JACON_SNAPSHOT_MAGIC,
+        .version = JACON_SNAPSHOT_VERSION,
+        .byte_order = 1,
+        .node_count = writer->node_count,
+        .nodes = sizeof(Jacon_SnapshotHeader),
+        .strings_size = writer->strings.count,
+        .index_capacity = writer->index_capacity,
+    };
+    header.strings = header.nodes + writer->node_count * sizeof(Jacon_SnapshotNode);
+    header.index = header.strings + header.strings_size;
+    header.size = header.index + writer->index_capacity * sizeof(Jacon_SnapshotBucket);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return JACON_ERR_IO;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(writer->nodes, sizeof(Jacon_SnapshotNode), writer->node_count, file) == writer->node_count
+        && fwrite(writer->strings.string, 1, writer->strings.count, file) == writer->strings.count
+        && fwrite(writer->index, sizeof(Jacon_SnapshotBucket), writer->index_capacity, file) == writer->index_capacity;
+    if (fclose(file) != 0) ok = false;
+    return ok ? JACON_OK : JACON_ERR_IO;
+}
+
+Jacon_Error
+Jacon_save_snapshot(Jacon_content* content, const char* path)
+{
+    if (content == NULL || content->root == NULL || path == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_SnapshotWriter writer = {0};
+    Jacon_Error ret = Jacon_build_snapshot(content, &writer);
+    if (ret == JACON_OK) ret = Jacon_write_snapshot(&writer, path);
+    Jacon_free(writer.nodes);
+    Jacon_free(writer.sources);
+    Jacon_free(writer.index);
+    Jacon_str_free(&writer.strings);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+/**
+ * Check that count items of size bytes at offset lie inside the file
+ */
+bool
+Jacon_snapshot_section_fits(const Jacon_SnapshotHeader* header, uint64_t offset, uint64_t count, uint64_t size)
+{
+    return offset <= header->size && count <= (header->size - offset) / size;
+}
+
+Jacon_Error
+Jacon_open_snapshot(Jacon_Snapshot* snapshot, const char* path)
+{
+    if (snapshot == NULL || path == NULL) return JACON_ERR_NULL_PARAM;
+    *snapshot = (Jacon_Snapshot){0};
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return JACON_ERR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Jacon_SnapshotHeader)) {
+        close(fd);
+        return JACON_ERR_IO;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return JACON_ERR_IO;
+
+    const Jacon_SnapshotHeader* header = base;
+    bool valid = memcmp(header->magic, JACON_SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->version == JACON_SNAPSHOT_VERSION
+        && header->byte_order == 1
+        && header->size == (uint64_t)st.st_size
+        && header->node_count > 0
+        && header->index_capacity > 0
+        && (header->index_capacity & (header->index_capacity - 1)) == 0
+        && Jacon_snapshot_section_fits(header, header->nodes, header->node_count, sizeof(Jacon_SnapshotNode))
+        && Jacon_snapshot_section_fits(header, header->strings, header->strings_size, 1)
+        && Jacon_snapshot_section_fits(header, header->index, header->index_capacity, sizeof(Jacon_SnapshotBucket))
+        && header->nodes % 8 == 0 && header->index % 8 == 0
+        // Every string read stays inside the blob
+        && (header->strings_size == 0 || ((const char*)base)[header->strings + header->strings_size - 1] == '\0');
+    if (!valid) {
+        munmap(base, st.st_size);
+        return JACON_ERR_INVALID_BINARY;
+    }
+
+    snapshot->base = base;
+    snapshot->size = st.st_size;
+    snapshot->header = header;
+    snapshot->nodes = (const Jacon_SnapshotNode*)(snapshot->base + header->nodes);
+    snapshot->strings = (const char*)(snapshot->base + header->strings);
+    snapshot->index = (const Jacon_SnapshotBucket*)(snapshot->base + header->index);
+    return JACON_OK;
+}
+
+void
+Jacon_close_snapshot(Jacon_Snapshot* snapshot)
+{
+    if (snapshot == NULL || snapshot->base == NULL) return;
+    munmap((void*)snapshot->base, snapshot->size);
+    *snapshot = (Jacon_Snapshot){0};
+}
+
+const Jacon_SnapshotNode*
+Jacon_snapshot_find(const Jacon_Snapshot* snapshot, const char* name)
+{
+    if (snapshot == NULL || snapshot->base == NULL || name == NULL) return NULL;
+    const Jacon_SnapshotHeader* header = snapshot->header;
+    uint64_t hash = Jacon_hash((unsigned char*)name);
+    uint64_t mask = header->index_capacity - 1;
+    // Bounded in case the file has no empty bucket
+    for (uint64_t probe = 0, bucket = hash & mask; probe < header->index_capacity;
+        probe++, bucket = (bucket + 1) & mask) {
+        const Jacon_SnapshotBucket* entry = &snapshot->index[bucket];
+        if (entry->key == JACON_SNAPSHOT_NONE) return NULL;
+        if (entry->hash == hash && entry->key < header->strings_size && entry->node < header->node_count
+            && strcmp(snapshot->strings + entry->key, name) == 0) {
+            return &snapshot->nodes[entry->node];
+        }
+    }
+    return NULL;
+}
+
+const Jacon_SnapshotNode*
+Jacon_snapshot_root(const Jacon_Snapshot* snapshot)
+{
+    if (snapshot == NULL || snapshot->base == NULL) return NULL;
+    return &snapshot->nodes[0];
+}
+
+const Jacon_SnapshotNode*
+Jacon_snapshot_child(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node, size_t index)
+{
+    if (snapshot == NULL || node == NULL || index >= node->child_count) return NULL;
+    if (node->first_child >= snapshot->header->node_count
+        || index >= snapshot->header->node_count - node->first_child) return NULL;
+    return &snapshot->nodes[node->first_child + index];
+}
+
+const char*
+Jacon_snapshot_name(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node)
+{
+    if (snapshot == NULL || node == NULL || node->name >= snapshot->header->strings_size) return NULL;
+    return snapshot->strings + node->name;
+}
+
+const char*
+Jacon_snapshot_string(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node)
+{
+    if (snapshot == NULL || node == NULL || node->type != JACON_VALUE_STRING
+        || node->value.string >= snapshot->header->strings_size) return NULL;
+    return snapshot->strings + node->value.string;
+}
+
+Jacon_Error
+Jacon_snapshot_get_value_by_name(const Jacon_Snapshot* snapshot, const char* name, Jacon_ValueType type, void* value)
+{
+    if (snapshot == NULL || name == NULL || value == NULL) return JACON_ERR_NULL_PARAM;
+    const Jacon_SnapshotNode* node = Jacon_snapshot_find(snapshot, name);
+    if (node == NULL) return JACON_ERR_KEY_NOT_FOUND;
+    if (node->type != type) return JACON_ERR_INVALID_VALUE_TYPE;
+    switch (type) {
+        case JACON_VALUE_STRING:
+            *(const char**)value = Jacon_snapshot_string(snapshot, node);
+            if (*(const char**)value == NULL) return JACON_ERR_INVALID_BINARY;
+            break;
+        case JACON_VALUE_INT:
+            *(int*)value = (int)node->value.int_val;
+            break;
+        case JACON_VALUE_FLOAT:
+            *(float*)value = node->value.float_val;
+            break;
+        case JACON_VALUE_DOUBLE:
+            *(double*)value = node->value.double_val;
+            break;
+        case JACON_VALUE_BOOLEAN:
+            *(bool*)value = node->value.bool_val != 0;
+            break;
+        case JACON_VALUE_NULL:
+        case JACON_VALUE_NUMBER:
+        case JACON_VALUE_ARRAY:
+        case JACON_VALUE_OBJECT:
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_snapshot_get_string_by_name(const Jacon_Snapshot* snapshot, const char* name, const char** value)
+{
+    return Jacon_snapshot_get_value_by_name(snapshot, name, JACON_VALUE_STRING, (void*)value);
+}
+
+Jacon_Error
+Jacon_snapshot_get_int_by_name(const Jacon_Snapshot* snapshot, const char* name, int* value)
+{
+    return Jacon_snapshot_get_value_by_name(snapshot, name, JACON_VALUE_INT, value);
+}
+
+Jacon_Error
+Jacon_snapshot_get_float_by_name(const Jacon_Snapshot* snapshot, const char* name, float* value)
+{
+    return Jacon_snapshot_get_value_by_name(snapshot, name, JACON_VALUE_FLOAT, value);
+}
+
+Jacon_Error
+Jacon_snapshot_get_double_by_name(const Jacon_Snapshot* snapshot, const char* name, double* value)
+{
+    return Jacon_snapshot_get_value_by_name(snapshot, name, JACON_VALUE_DOUBLE, value);
+}
+
+Jacon_Error
+Jacon_snapshot_get_bool_by_name(const Jacon_Snapshot* snapshot, const char* name, bool* value)
+{
+    return Jacon_snapshot_get_value_by_name(snapshot, name, JACON_VALUE_BOOLEAN, value);
+}
+
+/**
+ * Parse an integral Json number of size bytes, false if it is not one or overflows
+ */
+bool
+Jacon_parse_int64(const char* str, size_t size, int64_t* value)
+{
+    bool negative = *str == '-';
+    uint64_t magnitude = 0;
+    for (size_t i = negative; i < size; i++) {
+        uint64_t digit = str[i] - '0';
+        if (digit > 9 || magnitude > (UINT64_MAX - digit) / 10) return false;
+        magnitude = magnitude * 10 + digit;
+    }
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    if (magnitude > limit) return false;
+    *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+size_t
+Jacon_field_size(Jacon_FieldType type, const Jacon_StructDescriptor* descriptor)
+{
+    switch (type) {
+        case JACON_FIELD_STRING: return sizeof(char*);
+        case JACON_FIELD_INT: return sizeof(int);
+        case JACON_FIELD_INT64: return sizeof(int64_t);
+        case JACON_FIELD_FLOAT: return sizeof(float);
+        case JACON_FIELD_DOUBLE: return sizeof(double);
+        case JACON_FIELD_BOOL: return sizeof(bool);
+        case JACON_FIELD_OBJECT: return descriptor != NULL ? descriptor->size : 0;
+        case JACON_FIELD_ARRAY:
+        default: return 0;
+    }
+}
+
+/**
+ * Release what a single value of type owns
+ */
+void
+Jacon_free_field(Jacon_FieldType type, const Jacon_Field* field, void* value)
+{
+    switch (type) {
+        case JACON_FIELD_STRING:
+            Jacon_free(*(char**)value);
+            *(char**)value = NULL;
+            break;
+        case JACON_FIELD_OBJECT:
+            Jacon_free_struct(field->descriptor, value);
+            break;
+        case JACON_FIELD_ARRAY: {
+            char* elements = *(char**)value;
+            size_t* count = (size_t*)((char*)value - field->offset + field->count_offset);
+            size_t element_size = Jacon_field_size(field->element_type, field->descriptor);
+            if (elements != NULL && (field->element_type == JACON_FIELD_STRING
+                || field->element_type == JACON_FIELD_OBJECT)) {
+                for (size_t i = 0; i < *count; i++) {
+                    Jacon_free_field(field->element_type, field, elements + i * element_size);
+                }
+            }
+            Jacon_free(elements);
+            *(char**)value = NULL;
+            *count = 0;
+            break;
+        }
+        case JACON_FIELD_INT:
+        case JACON_FIELD_INT64:
+        case JACON_FIELD_FLOAT:
+        case JACON_FIELD_DOUBLE:
+        case JACON_FIELD_BOOL:
+        default:
+            break;
+    }
+}
+
+void
+Jacon_free_struct(const Jacon_StructDescriptor* descriptor, void* value)
+{
+    if (descriptor == NULL || value == NULL) return;
+    for (size_t i = 0; i < descriptor->field_count; i++) {
+        const Jacon_Field* field = &descriptor->fields[i];
+        Jacon_free_field(field->type, field, (char*)value + field->offset);
+    }
+}
+
+Jacon_Error
+Jacon_bind_object(const char** str, const Jacon_StructDescriptor* descriptor, void* out);
+
+/**
+ * Parse the value at *str into out, as a value of type
+ */
+Jacon_Error
+Jacon_bind_value(const char** str, Jacon_FieldType type, const Jacon_Field* field, void* out)
+{
+    Jacon_Error ret;
+    const char* ptr = Jacon_skip_whitespace(*str);
+    bool integral;
+    size_t size;
+
+    // Null leaves the field as it is
+    if (strncmp(ptr, "null", 4) == 0) {
+        *str = ptr + 4;
+        return JACON_OK;
+    }
+    switch (type) {
+        case JACON_FIELD_STRING: {
+            if (*ptr != '"') return JACON_ERR_INVALID_VALUE_TYPE;
+            const char* start = ptr + 1;
+            ret = Jacon_skip_string(&ptr);
+            if (ret != JACON_OK) return ret;
+            size = ptr - 1 - start;
+            Jacon_StringBuilder builder = { .string = Jacon_malloc(size + 1), .capacity = size + 1 };
+            if (builder.string == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            ret = Jacon_str_append_unescaped(&builder, start, size);
+            if (ret != JACON_OK) {
+                Jacon_free(builder.string);
+                return ret;
+            }
+            Jacon_free(*(char**)out);
+            *(char**)out = builder.string;
+            break;
+        }
+        case JACON_FIELD_INT:
+        case JACON_FIELD_INT64: {
+            int64_t value;
+            size = Jacon_scan_number(ptr, &integral);
+            if (size == 0) return *ptr == '-' || isdigit((unsigned char)*ptr) ? JACON_ERR_INVALID_JSON : JACON_ERR_INVALID_VALUE_TYPE;
+            if (!integral || !Jacon_parse_int64(ptr, size, &value)) return JACON_ERR_INVALID_VALUE_TYPE;
+            if (type == JACON_FIELD_INT) {
+                if (value < INT_MIN || value > INT_MAX) return JACON_ERR_INVALID_VALUE_TYPE;
+                *(int*)out = (int)value;
+            } else {
+                *(int64_t*)out = value;
+            }
+            ptr += size;
+            break;
+        }
+        case JACON_FIELD_FLOAT:
+        case JACON_FIELD_DOUBLE: {
+            size = Jacon_scan_number(ptr, &integral);
+            if (size == 0) return *ptr == '-' || isdigit((unsigned char)*ptr) ? JACON_ERR_INVALID_JSON : JACON_ERR_INVALID_VALUE_TYPE;
+            double value = strtod(ptr, NULL);
+            if (type == JACON_FIELD_FLOAT) *(float*)out = (float)value;
+            else *(double*)out = value;
+            ptr += size;
+            break;
+        }
+        case JACON_FIELD_BOOL:
+            if (strncmp(ptr, "true", 4) == 0) {
+                *(bool*)out = true;
+                ptr += 4;
+            } else if (strncmp(ptr, "false", 5) == 0) {
+                *(bool*)out = false;
+                ptr += 5;
+            } else {
+                return JACON_ERR_INVALID_VALUE_TYPE;
+            }
+            break;
+        case JACON_FIELD_OBJECT:
+            if (*ptr != '{') return JACON_ERR_INVALID_VALUE_TYPE;
+            ret = Jacon_bind_object(&ptr, field->descriptor, out);
+            if (ret != JACON_OK) return ret;
+            break;
+        case JACON_FIELD_ARRAY: {
+            if (*ptr != '[') return JACON_ERR_INVALID_VALUE_TYPE;
+            size_t element_size = Jacon_field_size(field->element_type, field->descriptor);
+            if (element_size == 0) return JACON_ERR_INVALID_VALUE_TYPE;
+            // A repeated member replaces the previous array
+            Jacon_free_field(JACON_FIELD_ARRAY, field, out);
+            char** elements = (char**)out;
+            size_t* count = (size_t*)((char*)out - field->offset + field->count_offset);
+            size_t capacity = 0;
+            ptr = Jacon_skip_whitespace(ptr + 1);
+            if (*ptr == ']') {
+                ptr++;
+                break;
+            }
+            while (true) {
+                if (*count == capacity) {
+                    size_t new_capacity = capacity == 0 ? 8 : capacity * 2;
+                    char* tmp = Jacon_realloc(*elements, new_capacity * element_size);
+                    if (tmp == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+                    *elements = tmp;
+                    capacity = new_capacity;
+                }
+                char* element = *elements + *count * element_size;
+                memset(element, 0, element_size);
+                // Counted first so a failing element is released with the others
+                (*count)++;
+                ret = Jacon_bind_value(&ptr, field->element_type, field, element);
+                if (ret != JACON_OK) return ret;
+                ptr = Jacon_skip_whitespace(ptr);
+                if (*ptr == ']') {
+                    ptr++;
+                    break;
+                }
+                if (*ptr++ != ',') return JACON_ERR_INVALID_JSON;
+            }
+            break;
+        }
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+    *str = ptr;
+    return JACON_OK;
+}
+
+/**
+ * Members usually come in declaration order, the search starts after the last match
+ */
+const Jacon_Field*
+Jacon_find_field(const Jacon_StructDescriptor* descriptor, const char* key, size_t size, size_t* hint)
+{
+    for (size_t i = 0; i < descriptor->field_count; i++) {
+        size_t index = (*hint + i) % descriptor->field_count;
+        const Jacon_Field* field = &descriptor->fields[index];
+        if (strnlen(field->name, size + 1) == size && memcmp(field->name, key, size) == 0) {
+            *hint = index + 1;
+            return field;
+        }
+    }
+    return NULL;
+}
+
+Jacon_Error
+Jacon_bind_object(const char** str, const Jacon_StructDescriptor* descriptor, void* out)
+{
+    Jacon_Error ret = JACON_OK;
+    Jacon_StringBuilder key = {0};
+    size_t hint = 0;
+    const char* ptr = Jacon_skip_whitespace(*str);
+    if (*ptr++ != '{') return JACON_ERR_INVALID_JSON;
+    ptr = Jacon_skip_whitespace(ptr);
+    if (*ptr == '}') {
+        *str = ptr + 1;
+        return JACON_OK;
+    }
+
+    while (true) {
+        if (*ptr != '"') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+        const char* key_start = ptr + 1;
+        ret = Jacon_skip_string(&ptr);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        const char* name = key_start;
+        size_t name_size = ptr - 1 - key_start;
+        // Escaped keys are compared once unescaped
+        if (memchr(name, '\\', name_size) != NULL) {
+            key.count = 0;
+            ret = Jacon_str_append_unescaped(&key, name, name_size);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+            name = key.string;
+            name_size = key.count;
+        }
+        ptr = Jacon_skip_whitespace(ptr);
+        if (*ptr++ != ':') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+
+        const Jacon_Field* field = Jacon_find_field(descriptor, name, name_size, &hint);
+        if (field != NULL) {
+            ret = Jacon_bind_value(&ptr, field->type, field, (char*)out + field->offset);
+        } else {
+            ret = Jacon_skip_value(&ptr);
+        }
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+
+        ptr = Jacon_skip_whitespace(ptr);
+        if (*ptr == '}') break;
+        if (*ptr++ != ',') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+        ptr = Jacon_skip_whitespace(ptr);
+    }
+    *str = ptr + 1;
+defer:
+    Jacon_str_free(&key);
+    return ret;
+}
+
+Jacon_Error
+Jacon_deserialize_struct(const char* str, const Jacon_StructDescriptor* descriptor, void* out)
+{
+    if (str == NULL || descriptor == NULL || out == NULL) return JACON_ERR_NULL_PARAM;
+
+    const char* ptr = Jacon_skip_whitespace(str);
+    if (*ptr == '\0') return JACON_ERR_EMPTY_INPUT;
+    Jacon_Error ret = Jacon_bind_object(&ptr, descriptor, out);
+    if (ret == JACON_OK && *Jacon_skip_whitespace(ptr) != '\0') ret = JACON_ERR_INVALID_JSON;
+    if (ret != JACON_OK) Jacon_free_struct(descriptor, out);
+    return ret;
+}
+
+/**
+ * Index of the entry of descriptor, added at the end if missing
+ */
+Jacon_Error
+Jacon_encoder_entry(Jacon_StructEncoder* encoder, const Jacon_StructDescriptor* descriptor, size_t* index)
+{
+    for (size_t i = 0; i < encoder->entry_count; i++) {
+        if (encoder->entries[i].descriptor == descriptor) {
+            *index = i;
+            return JACON_OK;
+        }
+    }
+    Jacon_EncoderEntry* tmp = Jacon_realloc(encoder->entries, (encoder->entry_count + 1) * sizeof(Jacon_EncoderEntry));
+    if (tmp == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    encoder->entries = tmp;
+    encoder->entries[encoder->entry_count] = (Jacon_EncoderEntry){ .descriptor = descriptor };
+    *index = encoder->entry_count++;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_compile_entry(Jacon_StructEncoder* encoder, size_t index)
+{
+    Jacon_Error ret;
+    const Jacon_StructDescriptor* descriptor = encoder->entries[index].descriptor;
+    Jacon_StringBuilder keys = {0};
+    Jacon_EncodedField* fields = Jacon_calloc(descriptor->field_count + 1, sizeof(Jacon_EncodedField));
+    if (fields == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    // Store the entry first, it owns what follows even on failure
+    encoder->entries[index].fields = fields;
+
+    size_t* offsets = Jacon_calloc(descriptor->field_count + 1, sizeof(size_t));
+    if (offsets == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    for (size_t i = 0; i < descriptor->field_count; i++) {
+        const Jacon_Field* field = &descriptor->fields[i];
+        offsets[i] = keys.count;
+        ret = Jacon_str_append_n(&keys, ",\"", 2);
+        if (ret == JACON_OK) ret = Jacon_str_append_escaped(&keys, field->name, strlen(field->name));
+        if (ret == JACON_OK) ret = Jacon_str_append_n(&keys, "\":", 2);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+
+        fields[i].nested = SIZE_MAX;
+        bool nested = field->type == JACON_FIELD_OBJECT
+            || (field->type == JACON_FIELD_ARRAY && field->element_type == JACON_FIELD_OBJECT);
+        if (nested) {
+            if (field->descriptor == NULL) Jacon_defer_return(JACON_ERR_NULL_PARAM);
+            ret = Jacon_encoder_entry(encoder, field->descriptor, &fields[i].nested);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+    }
+    offsets[descriptor->field_count] = keys.count;
+    // Keys point in the final buffer once it stops moving
+    encoder->entries[index].keys = keys.string;
+    keys.string = NULL;
+    for (size_t i = 0; i < descriptor->field_count; i++) {
+        fields[i].key = encoder->entries[index].keys + offsets[i] + (i == 0);
+        fields[i].key_size = offsets[i + 1] - offsets[i] - (i == 0);
+    }
+    ret = JACON_OK;
+defer:
+    Jacon_str_free(&keys);
+    Jacon_free(offsets);
+    return ret;
+}
+
+Jacon_Error
+Jacon_compile_encoder(Jacon_StructEncoder* encoder, const Jacon_StructDescriptor* descriptor)
+{
+    if (encoder == NULL || descriptor == NULL) return JACON_ERR_NULL_PARAM;
+    *encoder = (Jacon_StructEncoder){0};
+
+    size_t index;
+    Jacon_Error ret = Jacon_encoder_entry(encoder, descriptor, &index);
+    // Compiling an entry may add new ones at the end
+    for (size_t i = 0; ret == JACON_OK && i < encoder->entry_count; i++) {
+        ret = Jacon_compile_entry(encoder, i);
+    }
+    if (ret != JACON_OK) Jacon_free_encoder(encoder);
+    return ret;
+}
+
+void
+Jacon_free_encoder(Jacon_StructEncoder* encoder)
+{
+    if (encoder == NULL) return;
+    for (size_t i = 0; i < encoder->entry_count; i++) {
+        Jacon_free(encoder->entries[i].fields);
+        Jacon_free(encoder->entries[i].keys);
+    }
+    Jacon_free(encoder->entries);
+    *encoder = (Jacon_StructEncoder){0};
+}
+
+Jacon_Error
+Jacon_encode_struct(const Jacon_StructEncoder* encoder, size_t index, const char* value, Jacon_StringBuilder* out);
+
+Jacon_Error
+Jacon_encode_value(const Jacon_StructEncoder* encoder, Jacon_FieldType type, size_t nested,
+    const char* value, Jacon_StringBuilder* out)
+{
+    switch (type) {
+        case JACON_FIELD_STRING: {
+            const char* str = *(char* const*)value;
+            if (str == NULL) return Jacon_str_append_n(out, "null", 4);
+            Jacon_Error ret = Jacon_str_append_n(out, "\"", 1);
+            if (ret == JACON_OK) ret = Jacon_str_append_escaped(out, str, strlen(str));
+            if (ret == JACON_OK) ret = Jacon_str_append_n(out, "\"", 1);
+            return ret;
+        }
+        case JACON_FIELD_INT:
+            return Jacon_str_append_int64(out, *(const int*)value);
+        case JACON_FIELD_INT64:
+            return Jacon_str_append_int64(out, *(const int64_t*)value);
+        case JACON_FIELD_FLOAT:
+            return Jacon_json_write_float(out, *(const float*)value);
+        case JACON_FIELD_DOUBLE:
+            return Jacon_json_write_double(out, *(const double*)value);
+        case JACON_FIELD_BOOL:
+            return *(const bool*)value ? Jacon_str_append_n(out, "true", 4) : Jacon_str_append_n(out, "false", 5);
+        case JACON_FIELD_OBJECT:
+            return Jacon_encode_struct(encoder, nested, value, out);
+        case JACON_FIELD_ARRAY:
+        default:
+            return JACON_ERR_INVALID_VALUE_TYPE;
+    }
+}
+
+Jacon_Error
+Jacon_encode_struct(const Jacon_StructEncoder* encoder, size_t index, const char* value, Jacon_StringBuilder* out)
+{
+    const Jacon_EncoderEntry* entry = &encoder->entries[index];
+    const Jacon_StructDescriptor* descriptor = entry->descriptor;
+    Jacon_Error ret = Jacon_str_append_n(out, "{", 1);
+    for (size_t i = 0; ret == JACON_OK && i < descriptor->field_count; i++) {
+        const Jacon_Field* field = &descriptor->fields[i];
+        const Jacon_EncodedField* encoded = &entry->fields[i];
+        ret = Jacon_str_append_n(out, encoded->key, encoded->key_size);
+        if (ret != JACON_OK) break;
+        if (field->type != JACON_FIELD_ARRAY) {
+            ret = Jacon_encode_value(encoder, field->type, encoded->nested, value + field->offset, out);
+            continue;
+        }
+
+        const char* elements = *(char* const*)(value + field->offset);
+        size_t count = *(const size_t*)(value + field->count_offset);
+        size_t element_size = Jacon_field_size(field->element_type, field->descriptor);
+        if (element_size == 0) return JACON_ERR_INVALID_VALUE_TYPE;
+        if (elements == NULL) count = 0;
+        ret = Jacon_str_append_n(out, "[", 1);
+        for (size_t j = 0; ret == JACON_OK && j < count; j++) {
+            if (j > 0) ret = Jacon_str_append_n(out, ",", 1);
+            if (ret == JACON_OK) {
+                ret = Jacon_encode_value(encoder, field->element_type, encoded->nested,
+                    elements + j * element_size, out);
+            }
+        }
+        if (ret == JACON_OK) ret = Jacon_str_append_n(out, "]", 1);
+    }
+    if (ret != JACON_OK) return ret;
+    return Jacon_str_append_n(out, "}", 1);
+}
+
+Jacon_Error
+Jacon_serialize_struct(const Jacon_StructEncoder* encoder, const void* value, Jacon_StringBuilder* out)
+{
+    if (encoder == NULL || encoder->entry_count == 0 || value == NULL || out == NULL) {
+        return JACON_ERR_NULL_PARAM;
+    }
+    size_t start_count = out->count;
+    Jacon_Error ret = Jacon_encode_struct(encoder, 0, value, out);
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    return ret;
+}
+
+/**
+ * Size of str once escaped by Jacon_str_append_escaped
+ */
+size_t
+Jacon_escaped_size(const char* str, size_t size)
+{
+    size_t escaped = size;
+    size_t i = 0;
+    while ((i += Jacon_find_escape(str + i, size - i)) < size) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') escaped += 1;
+        else if (c < 0x20) escaped += 5;
+        else if (i + 1 < size && str[i + 1] == (char)0x80) escaped += 4;
+        i++;
+    }
+    return escaped;
+}
+
+void
+Jacon_writer_init(Jacon_Writer* writer, Jacon_StringBuilder* out)
+{
+    *writer = (Jacon_Writer){ .out = out };
+    if (out == NULL) writer->error = JACON_ERR_NULL_PARAM;
+}
+
+void
+Jacon_writer_init_fixed(Jacon_Writer* writer, char* buffer, size_t capacity)
+{
+    *writer = (Jacon_Writer){
+        .fixed_buffer = { .string = buffer, .capacity = capacity },
+        .fixed = true,
+    };
+    writer->out = &writer->fixed_buffer;
+    if (buffer == NULL || capacity == 0) writer->error = JACON_ERR_NULL_PARAM;
+    else buffer[0] = '\0';
+}
+
+/**
+ * Fixed buffers are never grown, what does not fit is an error
+ */
+Jacon_Error
+Jacon_writer_fits(Jacon_Writer* writer, size_t size)
+{
+    if (writer->fixed && writer->out->count + size + 1 > writer->out->capacity) {
+        writer->error = JACON_ERR_INVALID_SIZE;
+    }
+    return writer->error;
+}
+
+Jacon_Error
+Jacon_writer_put(Jacon_Writer* writer, const char* data, size_t size)
+{
+    if (Jacon_writer_fits(writer, size) != JACON_OK) return writer->error;
+    writer->error = Jacon_str_append_n(writer->out, data, size);
+    return writer->error;
+}
+
+/**
+ * Comma, and nesting checks, written before every key and value
+ */
+Jacon_Error
+Jacon_writer_prefix(Jacon_Writer* writer, bool key)
+{
+    if (writer->error != JACON_OK) return writer->error;
+#ifndef NDEBUG
+    bool in_object = writer->depth > 0 && writer->objects[writer->depth - 1];
+    bool misplaced = key
+        ? !in_object || writer->after_key
+        : (in_object && !writer->after_key) || (writer->depth == 0 && writer->need_comma);
+    if (misplaced) {
+        writer->error = JACON_ERR_INVALID_JSON;
+        return writer->error;
+    }
+#else
+    // Only read by the checks
+    (void)key;
+#endif
+    if (writer->after_key) {
+        writer->after_key = false;
+        return JACON_OK;
+    }
+    if (writer->need_comma) return Jacon_writer_put(writer, ",", 1);
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_writer_begin(Jacon_Writer* writer, bool object)
+{
+    if (Jacon_writer_prefix(writer, false) != JACON_OK) return writer->error;
+    // Not a debug check, the nesting stack has a fixed size
+    if (writer->depth == JACON_WRITER_MAX_DEPTH) {
+        writer->error = JACON_ERR_INDEX_OUT_OF_BOUND;
+        return writer->error;
+    }
+    if (Jacon_writer_put(writer, object ? "{" : "[", 1) != JACON_OK) return writer->error;
+    writer->objects[writer->depth++] = object;
+    writer->need_comma = false;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_writer_end(Jacon_Writer* writer, bool object)
+{
+    if (writer->error != JACON_OK) return writer->error;
+    if (writer->depth == 0) {
+        writer->error = JACON_ERR_INVALID_JSON;
+        return writer->error;
+    }
+#ifndef NDEBUG
+    if (writer->objects[writer->depth - 1] != object || writer->after_key) {
+        writer->error = JACON_ERR_INVALID_JSON;
+        return writer->error;
+    }
+#endif
+    if (Jacon_writer_put(writer, object ? "}" : "]", 1) != JACON_OK) return writer->error;
+    writer->depth--;
+    writer->need_comma = true;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_writer_begin_object(Jacon_Writer* writer)
+{
+    return Jacon_writer_begin(writer, true);
+}
+
+Jacon_Error
+Jacon_writer_end_object(Jacon_Writer* writer)
+{
+    return Jacon_writer_end(writer, true);
+}
+
+Jacon_Error
+Jacon_writer_begin_array(Jacon_Writer* writer)
+{
+    return Jacon_writer_begin(writer, false);
+}
+
+Jacon_Error
+Jacon_writer_end_array(Jacon_Writer* writer)
+{
+    return Jacon_writer_end(writer, false);
+}
+
+Jacon_Error
+Jacon_writer_quoted(Jacon_Writer* writer, const char* str)
+{
+    size_t size = strlen(str);
+    if (writer->fixed && Jacon_writer_fits(writer, Jacon_escaped_size(str, size) + 2) != JACON_OK) {
+        return writer->error;
+    }
+    Jacon_Error ret = Jacon_str_append_n(writer->out, "\"", 1);
+    if (ret == JACON_OK) ret = Jacon_str_append_escaped(writer->out, str, size);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(writer->out, "\"", 1);
+    writer->error = ret;
+    return ret;
+}
+
+Jacon_Error
+Jacon_writer_key(Jacon_Writer* writer, const char* key)
+{
+    if (key == NULL && writer->error == JACON_OK) writer->error = JACON_ERR_NULL_PARAM;
+    if (Jacon_writer_prefix(writer, true) != JACON_OK) return writer->error;
+    if (Jacon_writer_quoted(writer, key) != JACON_OK) return writer->error;
+    if (Jacon_writer_put(writer, ":", 1) != JACON_OK) return writer->error;
+    writer->after_key = true;
+    return JACON_OK;
+}
+
+/**
+ * Write a complete scalar value
+ */
+Jacon_Error
+Jacon_writer_value(Jacon_Writer* writer, const char* data, size_t size)
+{
+    if (Jacon_writer_prefix(writer, false) != JACON_OK) return writer->error;
+    if (Jacon_writer_put(writer, data, size) != JACON_OK) return writer->error;
+    writer->need_comma = true;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_writer_string(Jacon_Writer* writer, const char* str)
+{
+    if (str == NULL) return Jacon_writer_null(writer);
+    if (Jacon_writer_prefix(writer, false) != JACON_OK) return writer->error;
+    if (Jacon_writer_quoted(writer, str) != JACON_OK) return writer->error;
+    writer->need_comma = true;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_writer_int(Jacon_Writer* writer, int64_t value)
+{
+    char buffer[20];
+    return Jacon_writer_value(writer, buffer, Jacon_format_int64(buffer, value));
+}
+
+Jacon_Error
+Jacon_writer_double(Jacon_Writer* writer, double value)
+{
+    char buffer[32];
+    return Jacon_writer_value(writer, buffer, Jacon_format_double(buffer, value));
+}
+
+Jacon_Error
+Jacon_writer_bool(Jacon_Writer* writer, bool value)
+{
+    return value ? Jacon_writer_value(writer, "true", 4) : Jacon_writer_value(writer, "false", 5);
+}
+
+Jacon_Error
+Jacon_writer_null(Jacon_Writer* writer)
+{
+    return Jacon_writer_value(writer, "null", 4);
+}
+
+Jacon_Error
+Jacon_writer_finish(Jacon_Writer* writer, size_t* size)
+{
+    if (writer->error == JACON_OK && (writer->depth != 0 || writer->after_key || !writer->need_comma)) {
+        writer->error = JACON_ERR_INVALID_JSON;
+    }
+    if (size != NULL) *size = writer->out != NULL ? writer->out->count : 0;
+    return writer->error;
+}
+
+/**
+ * Index of the first quote or backslash of str, len if there is none
+ */
+size_t
+Jacon_find_quote_or_escape(const char* str, size_t len)
+{
+    size_t i = 0;
+#ifdef JACON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < len; i++) {
+        if (str[i] == '"' || str[i] == '\\') return i;
+    }
+    return len;
+}
+
+/**
+ * Index of the first whitespace or quote of str, len if there is none
+ */
+size_t
+Jacon_find_space_or_quote(const char* str, size_t len)
+{
+    size_t i = 0;
+#ifdef JACON_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i quote = _mm_set1_epi8('"');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)),
+                _mm_cmpeq_epi8(chunk, quote)));
+        int mask = _mm_movemask_epi8(found);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < len; i++) {
+        if (Jacon_is_whitespace(str[i]) || str[i] == '"') return i;
+    }
+    return len;
+}
+
+/**
+ * Size of the string starting with the quote at str, both quotes included
+ */
+Jacon_Error
+Jacon_string_extent(const char* str, size_t len, size_t* size)
+{
+    size_t i = 1;
+    while (true) {
+        i += Jacon_find_quote_or_escape(str + i, len - i);
+        if (i >= len) return JACON_ERR_CHAR_NOT_FOUND;
+        if (str[i] == '"') break;
+        // Skip the escaped character
+        i += 2;
+        if (i > len) return JACON_ERR_CHAR_NOT_FOUND;
+    }
+    *size = i + 1;
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_minify(const char* str, size_t len, Jacon_StringBuilder* out)
+{
+    if ((str == NULL && len > 0) || out == NULL) return JACON_ERR_NULL_PARAM;
+
+    Jacon_Error ret = JACON_OK;
+    size_t start_count = out->count;
+    size_t i = 0;
+    // Output is never bigger than the input
+    ret = Jacon_str_reserve(out, len);
+    while (ret == JACON_OK && i < len) {
+        size_t run = Jacon_find_space_or_quote(str + i, len - i);
+        ret = Jacon_str_append_n(out, str + i, run);
+        i += run;
+        if (ret != JACON_OK || i == len) break;
+        if (str[i] != '"') {
+            i++;
+            continue;
+        }
+        ret = Jacon_string_extent(str + i, len - i, &run);
+        if (ret == JACON_OK) ret = Jacon_str_append_n(out, str + i, run);
+        i += run;
+    }
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    return ret;
+}
+
+Jacon_Error
+Jacon_append_indent(Jacon_StringBuilder* out, size_t depth)
+{
+    static const char spaces[] = "                                                                ";
+    Jacon_Error ret = Jacon_str_append_n(out, "\n", 1);
+    size_t size = depth * 2;
+    while (ret == JACON_OK && size > 0) {
+        size_t chunk = size < sizeof(spaces) - 1 ? size : sizeof(spaces) - 1;
+        ret = Jacon_str_append_n(out, spaces, chunk);
+        size -= chunk;
+    }
+    return ret;
+}
+
+Jacon_Error
+Jacon_prettify(const char* str, size_t len, Jacon_StringBuilder* out)
+{
+    if ((str == NULL && len > 0) || out == NULL) return JACON_ERR_NULL_PARAM;
+
+    Jacon_Error ret = JACON_OK;
+    size_t start_count = out->count;
+    bool* objects = NULL;
+    size_t depth = 0;
+    size_t capacity = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        char c = str[i];
+        size_t size;
+        switch (c) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                i++;
+                continue;
+            case '"':
+                ret = Jacon_string_extent(str + i, len - i, &size);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                ret = Jacon_str_append_n(out, str + i, size);
+                i += size;
+                break;
+            case '{':
+            case '[': {
+                char close = c == '{' ? '}' : ']';
+                size_t next = i + 1;
+                while (next < len && Jacon_is_whitespace(str[next])) next++;
+                if (next < len && str[next] == close) {
+                    char empty[2] = { c, close };
+                    ret = Jacon_str_append_n(out, empty, 2);
+                    i = next + 1;
+                    break;
+                }
+                if (depth == capacity) {
+                    capacity = capacity == 0 ? 16 : capacity * 2;
+                    bool* tmp = Jacon_realloc(objects, capacity * sizeof(bool));
+                    if (tmp == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+                    objects = tmp;
+                }
+                objects[depth++] = c == '{';
+                ret = Jacon_str_append_n(out, &c, 1);
+                if (ret == JACON_OK) ret = Jacon_append_indent(out, depth);
+                i++;
+                break;
+            }
+            case '}':
+            case ']':
+                if (depth == 0 || objects[depth - 1] != (c == '}')) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                depth--;
+                ret = Jacon_append_indent(out, depth);
+                if (ret == JACON_OK) ret = Jacon_str_append_n(out, &c, 1);
+                i++;
+                break;
+            case ',':
+                if (depth == 0) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                // Array elements stay on one line, as in Jacon_serialize
+                if (objects[depth - 1]) {
+                    ret = Jacon_str_append_n(out, ",", 1);
+                    if (ret == JACON_OK) ret = Jacon_append_indent(out, depth);
+                } else {
+                    ret = Jacon_str_append_n(out, ", ", 2);
+                }
+                i++;
+                break;
+            case ':':
+                ret = Jacon_str_append_n(out, ": ", 2);
+                i++;
+                break;
+            default: {
+                // Numbers and literals run until the next delimiter
+                size_t start = i;
+                while (i < len && !Jacon_is_whitespace(str[i]) && str[i] != ',' && str[i] != ':'
+                    && str[i] != '}' && str[i] != ']' && str[i] != '{' && str[i] != '[' && str[i] != '"') i++;
+                ret = Jacon_str_append_n(out, str + start, i - start);
+                break;
+            }
+        }
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+    if (depth != 0) ret = JACON_ERR_INVALID_JSON;
+
+defer:
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    Jacon_free(objects);
+    return ret;
+}
+
+/**
+ * Check the string whose opening quote is at *index, *index ends past the closing quote
+ * or on the faulty byte.
+ */
+Jacon_Error
+Jacon_check_string(const char* str, size_t len, size_t* index)
+{
+    size_t i = *index + 1;
+    Jacon_Error ret = JACON_OK;
+    while (true) {
+        size_t run = Jacon_find_string_special(str + i, len - i);
+#ifndef JACON_NO_UTF8_VALIDATION
+        if (!Jacon_utf8_valid(str + i, run)) Jacon_defer_return(JACON_ERR_INVALID_UTF8);
+#endif
+        i += run;
+        if (i == len || (unsigned char)str[i] < 0x20) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+        if (str[i] == '"') break;
+        i++;
+        if (i == len) Jacon_defer_return(JACON_ERR_INVALID_ESCAPE_SEQUENCE);
+        if (str[i] == 'u') {
+            uint32_t code_unit;
+            if (!Jacon_read_hex4(str + i + 1, str + len, &code_unit)) Jacon_defer_return(JACON_ERR_INVALID_ESCAPE_SEQUENCE);
+            i += 5;
+        } else if (strchr("\"\\/bfnrt", str[i]) != NULL && str[i] != '\0') {
+            i++;
+        } else {
+            Jacon_defer_return(JACON_ERR_INVALID_ESCAPE_SEQUENCE);
+        }
+    }
+    i++;
+
+defer:
+    *index = i;
+    return ret;
+}
+
+Jacon_Error
+Jacon_validate(const char* str, size_t len, size_t* error_offset)
+{
+    // One bit per open container, set for objects
+    uint64_t objects[(JACON_VALIDATE_MAX_DEPTH + 63) / 64];
+    // Offset of the opening brace of every open object, it identifies its member names
+    size_t starts[JACON_VALIDATE_MAX_DEPTH];
+    size_t depth = 0;
+    Jacon_TranscodeState state = JACON_EXPECT_VALUE;
+    Jacon_Error ret = JACON_OK;
+    size_t i = 0;
+    Jacon_KeyTable keys;
+    Jacon_key_table_init(&keys, str);
+
+    if (str == NULL) Jacon_defer_return(JACON_ERR_NULL_PARAM);
+
+    while (true) {
+        while (i < len && Jacon_is_whitespace(str[i])) i++;
+        bool object = depth > 0 && ((objects[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1);
+        switch (state) {
+            case JACON_EXPECT_SEPARATOR:
+                if (depth == 0) {
+                    if (i != len) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                    Jacon_defer_return(JACON_OK);
+                }
+                if (i == len) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                if (str[i] == ',') {
+                    i++;
+                    state = object ? JACON_EXPECT_KEY : JACON_EXPECT_VALUE;
+                    continue;
+                }
+                if (str[i] != (object ? '}' : ']')) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                i++;
+                if (object) Jacon_key_table_close(&keys, starts[depth - 1]);
+                depth--;
+                continue;
+            case JACON_EXPECT_COLON:
+                if (i == len || str[i] != ':') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                i++;
+                state = JACON_EXPECT_VALUE;
+                continue;
+            case JACON_EXPECT_FIRST_KEY:
+            case JACON_EXPECT_FIRST_VALUE:
+                if (i < len && str[i] == (object ? '}' : ']')) {
+                    i++;
+                    depth--;
+                    state = JACON_EXPECT_SEPARATOR;
+                    continue;
+                }
+                state = object ? JACON_EXPECT_KEY : JACON_EXPECT_VALUE;
+                continue;
+            case JACON_EXPECT_KEY: {
+                if (i == len || str[i] != '"') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                size_t key = i;
+                ret = Jacon_check_string(str, len, &i);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                // Rejected by Jacon_validate_input as well
+                ret = Jacon_key_table_add(&keys, starts[depth - 1], key + 1, i - 1);
+                if (ret != JACON_OK) {
+                    i = key;
+                    Jacon_defer_return(ret);
+                }
+                state = JACON_EXPECT_COLON;
+                continue;
+            }
+            case JACON_EXPECT_VALUE:
+            default:
+                break;
+        }
+
+        if (i == len) Jacon_defer_return(depth == 0 ? JACON_ERR_EMPTY_INPUT : JACON_ERR_INVALID_JSON);
+        state = JACON_EXPECT_SEPARATOR;
+        switch (str[i]) {
+            case '{':
+            case '[': {
+                if (depth == JACON_VALIDATE_MAX_DEPTH) Jacon_defer_return(JACON_ERR_DEPTH_LIMIT);
+                uint64_t bit = (uint64_t)1 << (depth % 64);
+                if (str[i] == '{') objects[depth / 64] |= bit;
+                else objects[depth / 64] &= ~bit;
+                starts[depth] = i;
+                depth++;
+                state = str[i] == '{' ? JACON_EXPECT_FIRST_KEY : JACON_EXPECT_FIRST_VALUE;
+                i++;
+                break;
+            }
+            case '"':
+                ret = Jacon_check_string(str, len, &i);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+                break;
+            case 't':
+            case 'f':
+            case 'n': {
+                const char* literal = str[i] == 't' ? "true" : str[i] == 'f' ? "false" : "null";
+                size_t size = strlen(literal);
+                if (len - i < size || memcmp(str + i, literal, size) != 0) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                i += size;
+                break;
+            }
+            default: {
+                bool integral;
+                size_t size = Jacon_scan_number_n(str + i, len - i, &integral);
+                if (size == 0) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                i += size;
+                break;
+            }
+        }
+    }
+
+defer:
+    Jacon_key_table_free(&keys);
+    if (error_offset != NULL) *error_offset = ret == JACON_OK ? len : i;
+    return ret;
+}
+
+/**
+ * Significant digits of a number, without leading nor trailing zeros.
+ * Raw numbers keep every digit written, the others use their shortest form.
+ */
+typedef struct {
+    // First digit, '.' may follow in the count digits
+    const char* first;
+    size_t count;
+    // Power of ten of the first digit, out of range for infinities and NaN
+    int64_t exponent;
+    bool negative;
+    char buffer[32];
+} Jacon_NumberDigits;
+
+void
+Jacon_number_digits(const Jacon_Node* node, Jacon_NumberDigits* digits)
+{
+    const char* ptr = digits->buffer;
+    size_t size = 0;
+    if (node->type == JACON_VALUE_NUMBER) {
+        ptr = node->value.string_val;
+        size = strlen(ptr);
+    } else if (node->type == JACON_VALUE_INT) {
+        size = Jacon_format_int64(digits->buffer, node->value.int_val);
+    } else if (node->type == JACON_VALUE_FLOAT && isfinite(node->value.float_val)) {
+        size = Jacon_format_float(digits->buffer, node->value.float_val);
+    } else {
+        double value = Jacon_number_as_double(node);
+        if (!isfinite(value)) {
+            digits->first = NULL;
+            digits->count = 0;
+            digits->exponent = isnan(value) ? INT64_MIN : INT64_MAX;
+            digits->negative = value < 0;
+            return;
+        }
+        size = value >= -9223372036854775808.0 && value < 9223372036854775808.0 && value == (double)(int64_t)value
+            ? Jacon_format_int64(digits->buffer, (int64_t)value) : Jacon_format_double(digits->buffer, value);
+    }
+
+    const char* end = ptr + size;
+    digits->negative = ptr < end && *ptr == '-';
+    if (digits->negative) ptr++;
+    const char* first = NULL;
+    int64_t integer_digits = 0;
+    size_t position = 0;
+    size_t first_position = 0;
+    size_t last_position = 0;
+    bool fraction = false;
+    for (; ptr < end && (isdigit((unsigned char)*ptr) || *ptr == '.'); ptr++) {
+        if (*ptr == '.') {
+            fraction = true;
+            continue;
+        }
+        if (!fraction) integer_digits++;
+        if (*ptr != '0') {
+            if (first == NULL) {
+                first = ptr;
+                first_position = position;
+            }
+            last_position = position;
+        }
+        position++;
+    }
+    int64_t exponent = 0;
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ptr++;
+        bool negative = ptr < end && *ptr == '-';
+        if (ptr < end && (*ptr == '-' || *ptr == '+')) ptr++;
+        // Saturated well before overflowing with the digit count added
+        for (; ptr < end && isdigit((unsigned char)*ptr); ptr++) {
+            if (exponent < 100000000000000000LL) exponent = exponent * 10 + (*ptr - '0');
+        }
+        if (negative) exponent = -exponent;
+    }
+
+    // Zero has no digit, whatever its sign
+    digits->first = first;
+    digits->count = first == NULL ? 0 : last_position - first_position + 1;
+    digits->exponent = first == NULL ? 0 : exponent + integer_digits - 1 - (int64_t)first_position;
+    if (first == NULL) digits->negative = false;
+}
+
+/**
+ * Numbers are equal when their significant digits are, so raw ones compare exactly
+ */
+bool
+Jacon_numbers_equal(const Jacon_Node* a, const Jacon_Node* b)
+{
+    Jacon_NumberDigits x;
+    Jacon_NumberDigits y;
+    Jacon_number_digits(a, &x);
+    Jacon_number_digits(b, &y);
+    if (x.negative != y.negative || x.count != y.count || x.exponent != y.exponent) return false;
+    const char* p = x.first;
+    const char* q = y.first;
+    for (size_t i = 0; i < x.count; i++, p++, q++) {
+        if (*p == '.') p++;
+        if (*q == '.') q++;
+        if (*p != *q) return false;
+    }
+    return true;
+}
+
+uint64_t
+Jacon_number_hash(uint64_t hash, const Jacon_Node* node)
+{
+    Jacon_NumberDigits digits;
+    Jacon_number_digits(node, &digits);
+    hash = Jacon_fnv1a(hash, &digits.negative, sizeof(bool));
+    hash = Jacon_fnv1a(hash, &digits.exponent, sizeof(int64_t));
+    const char* ptr = digits.first;
+    for (size_t i = 0; i < digits.count; i++, ptr++) {
+        if (*ptr == '.') ptr++;
+        hash = Jacon_fnv1a(hash, ptr, 1);
+    }
+    return hash;
+}
+
+typedef struct {
+    uint64_t hash;
+    // Nodes in the subtree, itself included
+    size_t size;
+} Jacon_SubtreeHash;
+
+typedef struct {
+    Jacon_SubtreeHash* items;
+    size_t count;
+    size_t capacity;
+} Jacon_SubtreeHashes;
+
+/**
+ * Hash every subtree of node, stored in pre-order: the childs of the subtree
+ * at index i start at i + 1, each one followed by its own subtree.
+ * Numbers hash by their significant digits whatever their type, objects whatever their member order.
+ */
+Jacon_Error
+Jacon_hash_subtrees(const Jacon_Node* node, Jacon_SubtreeHashes* hashes)
+{
+    if (hashes->count == hashes->capacity) {
+        size_t new_capacity = hashes->capacity == 0 ? 64 : hashes->capacity * 2;
+        Jacon_SubtreeHash* tmp = Jacon_realloc(hashes->items, new_capacity * sizeof(Jacon_SubtreeHash));
+        if (tmp == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        hashes->items = tmp;
+        hashes->capacity = new_capacity;
+    }
+    size_t index = hashes->count++;
+    bool numeric = node->type == JACON_VALUE_INT || node->type == JACON_VALUE_FLOAT || node->type == JACON_VALUE_DOUBLE
+        || node->type == JACON_VALUE_NUMBER;
+    unsigned char kind = numeric ? JACON_VALUE_DOUBLE : (unsigned char)node->type;
+    uint64_t hash = Jacon_fnv1a(JACON_FNV_OFFSET, &kind, 1);
+    uint64_t members = 0;
+    Jacon_Error ret;
+
+    switch (node->type) {
+        case JACON_VALUE_STRING:
+            if (node->value.string_val != NULL) hash = Jacon_fnv1a(hash, node->value.string_val, strlen(node->value.string_val));
+            break;
+        case JACON_VALUE_INT:
+        case JACON_VALUE_FLOAT:
+        case JACON_VALUE_DOUBLE:
+        case JACON_VALUE_NUMBER:
+            hash = Jacon_number_hash(hash, node);
+            break;
+        case JACON_VALUE_BOOLEAN:
+            hash = Jacon_fnv1a(hash, &node->value.bool_val, sizeof(bool));
+            break;
+        case JACON_VALUE_NULL:
+            break;
+        case JACON_VALUE_ARRAY:
+            for (size_t i = 0; i < node->child_count; i++) {
+                size_t child = hashes->count;
+                ret = Jacon_hash_subtrees(node->childs[i], hashes);
+                if (ret != JACON_OK) return ret;
+                hash = Jacon_fnv1a(hash, &hashes->items[child].hash, sizeof(uint64_t));
+            }
+            break;
+        case JACON_VALUE_OBJECT:
+            // Summed so the member order does not matter
+            for (size_t i = 0; i < node->child_count; i++) {
+                size_t child = hashes->count;
+                ret = Jacon_hash_subtrees(node->childs[i], hashes);
+                if (ret != JACON_OK) return ret;
+                const char* name = node->childs[i]->name != NULL ? node->childs[i]->name : "";
+                uint64_t member = Jacon_fnv1a(JACON_FNV_OFFSET, name, strlen(name) + 1);
+                members += Jacon_fnv1a(member, &hashes->items[child].hash, sizeof(uint64_t));
+            }
+            hash = Jacon_fnv1a(hash, &members, sizeof(members));
+            break;
+    }
+    hashes->items[index].hash = hash;
+    hashes->items[index].size = hashes->count - index;
+    return JACON_OK;
+}
+
+/**
+ * Pre-order index of every child of the subtree at index
+ */
+void
+Jacon_child_indexes(const Jacon_SubtreeHashes* hashes, size_t index, size_t child_count, size_t* indexes)
+{
+    size_t child = index + 1;
+    for (size_t i = 0; i < child_count; i++) {
+        indexes[i] = child;
+        child += hashes->items[child].size;
+    }
+}
+
+/**
+ * Append a reference token to a Json Pointer, '~' and '/' are escaped
+ */
+Jacon_Error
+Jacon_pointer_append(Jacon_StringBuilder* pointer, const char* token)
+{
+    Jacon_Error ret = Jacon_str_append_n(pointer, "/", 1);
+    while (ret == JACON_OK && *token != '\0') {
+        size_t run = strcspn(token, "~/");
+        ret = Jacon_str_append_n(pointer, token, run);
+        token += run;
+        if (ret != JACON_OK || *token == '\0') break;
+        ret = Jacon_str_append_n(pointer, *token == '~' ? "~0" : "~1", 2);
+        token++;
+    }
+    return ret;
+}
+
+Jacon_Error
+Jacon_pointer_append_index(Jacon_StringBuilder* pointer, size_t index)
+{
+    char digits[20];
+    size_t size = Jacon_format_int64(digits, (int64_t)index);
+    Jacon_Error ret = Jacon_str_append_n(pointer, "/", 1);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(pointer, digits, size);
+    return ret;
+}
+
+typedef struct {
+    const Jacon_SubtreeHashes* from;
+    const Jacon_SubtreeHashes* to;
+    Jacon_StringBuilder* out;
+    // Pointer of the nodes being compared
+    Jacon_StringBuilder path;
+    bool first;
+} Jacon_DiffState;
+
+/**
+ * Append one operation on the current path, value may be NULL
+ */
+Jacon_Error
+Jacon_diff_emit(Jacon_DiffState* state, const char* op, const Jacon_Node* value)
+{
+    Jacon_Error ret = Jacon_str_append_null(state->out, state->first ? "" : ",", "{\"op\":\"", op, "\",\"path\":");
+    state->first = false;
+    if (ret == JACON_OK) ret = Jacon_json_write_quoted(state->out, state->path.count > 0 ? state->path.string : "", state->path.count);
+    if (ret == JACON_OK && value != NULL) {
+        ret = Jacon_str_append_n(state->out, ",\"value\":", 9);
+        if (ret == JACON_OK) ret = Jacon_value_as_str_unformatted(value, state->out);
+    }
+    if (ret == JACON_OK) ret = Jacon_str_append_n(state->out, "}", 1);
+    return ret;
+}
+
+void
+Jacon_path_truncate(Jacon_StringBuilder* path, size_t count)
+{
+    path->count = count;
+    if (path->string != NULL) path->string[count] = '\0';
+}
+
+Jacon_Error
+Jacon_diff_nodes(Jacon_DiffState* state, const Jacon_Node* from, size_t from_index, const Jacon_Node* to, size_t to_index);
+
+Jacon_Error
+Jacon_diff_objects(Jacon_DiffState* state, const Jacon_Node* from, size_t from_index, const Jacon_Node* to, size_t to_index)
+{
+    Jacon_Error ret = JACON_OK;
+    size_t path_count = state->path.count;
+    // Pre-order indexes of both childs, then the from member matching each to member
+    size_t* indexes = Jacon_malloc((from->child_count + 2 * to->child_count + 1) * sizeof(size_t));
+    if (indexes == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    size_t* from_indexes = indexes;
+    size_t* to_indexes = indexes + from->child_count;
+    size_t* matches = to_indexes + to->child_count;
+    Jacon_child_indexes(state->from, from_index, from->child_count, from_indexes);
+    Jacon_child_indexes(state->to, to_index, to->child_count, to_indexes);
+    for (size_t j = 0; j < to->child_count; j++) matches[j] = SIZE_MAX;
+
+    for (size_t i = 0; i < from->child_count; i++) {
+        const Jacon_Node* member = from->childs[i];
+        if (member->name == NULL) continue;
+        // Members usually keep their position
+        size_t j = i;
+        if (j >= to->child_count || matches[j] != SIZE_MAX || to->childs[j]->name == NULL
+            || strcmp(to->childs[j]->name, member->name) != 0) {
+            for (j = 0; j < to->child_count; j++) {
+                if (matches[j] == SIZE_MAX && to->childs[j]->name != NULL
+                    && strcmp(to->childs[j]->name, member->name) == 0) break;
+            }
+        }
+        ret = Jacon_pointer_append(&state->path, member->name);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        if (j == to->child_count) {
+            ret = Jacon_diff_emit(state, "remove", NULL);
+        } else {
+            matches[j] = i;
+            ret = Jacon_diff_nodes(state, member, from_indexes[i], to->childs[j], to_indexes[j]);
+        }
+        Jacon_path_truncate(&state->path, path_count);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+    for (size_t j = 0; j < to->child_count; j++) {
+        if (matches[j] != SIZE_MAX || to->childs[j]->name == NULL) continue;
+        ret = Jacon_pointer_append(&state->path, to->childs[j]->name);
+        if (ret == JACON_OK) ret = Jacon_diff_emit(state, "add", to->childs[j]);
+        Jacon_path_truncate(&state->path, path_count);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+
+defer:
+    Jacon_free(indexes);
+    return ret;
+}
+
+Jacon_Error
+Jacon_diff_arrays(Jacon_DiffState* state, const Jacon_Node* from, size_t from_index, const Jacon_Node* to, size_t to_index)
+{
+    Jacon_Error ret = JACON_OK;
+    size_t path_count = state->path.count;
+    size_t* from_indexes = Jacon_malloc((from->child_count + to->child_count + 1) * sizeof(size_t));
+    if (from_indexes == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    size_t* to_indexes = from_indexes + from->child_count;
+    Jacon_child_indexes(state->from, from_index, from->child_count, from_indexes);
+    Jacon_child_indexes(state->to, to_index, to->child_count, to_indexes);
+
+    // Unchanged head and tail are skipped, the middle is compared pairwise
+    size_t head = 0;
+    while (head < from->child_count && head < to->child_count
+        && state->from->items[from_indexes[head]].hash == state->to->items[to_indexes[head]].hash) head++;
+    size_t tail = 0;
+    while (tail < from->child_count - head && tail < to->child_count - head
+        && state->from->items[from_indexes[from->child_count - 1 - tail]].hash
+            == state->to->items[to_indexes[to->child_count - 1 - tail]].hash) tail++;
+    size_t from_middle = from->child_count - head - tail;
+    size_t to_middle = to->child_count - head - tail;
+    size_t common = from_middle < to_middle ? from_middle : to_middle;
+
+    for (size_t k = head; k < head + common; k++) {
+        ret = Jacon_pointer_append_index(&state->path, k);
+        if (ret == JACON_OK) ret = Jacon_diff_nodes(state, from->childs[k], from_indexes[k], to->childs[k], to_indexes[k]);
+        Jacon_path_truncate(&state->path, path_count);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+    // Removed from the last one so earlier indexes stay valid
+    for (size_t k = head + from_middle; k > head + common; k--) {
+        ret = Jacon_pointer_append_index(&state->path, k - 1);
+        if (ret == JACON_OK) ret = Jacon_diff_emit(state, "remove", NULL);
+        Jacon_path_truncate(&state->path, path_count);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+    for (size_t k = head + common; k < head + to_middle; k++) {
+        ret = Jacon_pointer_append_index(&state->path, k);
+        if (ret == JACON_OK) ret = Jacon_diff_emit(state, "add", to->childs[k]);
+        Jacon_path_truncate(&state->path, path_count);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+
+defer:
+    Jacon_free(from_indexes);
+    return ret;
+}
+
+Jacon_Error
+Jacon_diff_nodes(Jacon_DiffState* state, const Jacon_Node* from, size_t from_index, const Jacon_Node* to, size_t to_index)
+{
+    // Shared subtrees (see Jacon_share_node) and equal hashes are unchanged
+    if (from == to || state->from->items[from_index].hash == state->to->items[to_index].hash) return JACON_OK;
+    if (from->type == JACON_VALUE_OBJECT && to->type == JACON_VALUE_OBJECT) {
+        return Jacon_diff_objects(state, from, from_index, to, to_index);
+    }
+    if (from->type == JACON_VALUE_ARRAY && to->type == JACON_VALUE_ARRAY) {
+        return Jacon_diff_arrays(state, from, from_index, to, to_index);
+    }
+    return Jacon_diff_emit(state, "replace", to);
+}
+
+Jacon_Error
+Jacon_diff(const Jacon_Node* from, const Jacon_Node* to, Jacon_StringBuilder* out)
+{
+    if (from == NULL || to == NULL || out == NULL) return JACON_ERR_NULL_PARAM;
+
+    Jacon_SubtreeHashes from_hashes = {0};
+    Jacon_SubtreeHashes to_hashes = {0};
+    Jacon_DiffState state = { .from = &from_hashes, .to = &to_hashes, .out = out, .first = true };
+    size_t start_count = out->count;
+    Jacon_Error ret = Jacon_hash_subtrees(from, &from_hashes);
+    if (ret == JACON_OK) ret = Jacon_hash_subtrees(to, &to_hashes);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(out, "[", 1);
+    if (ret == JACON_OK) ret = Jacon_diff_nodes(&state, from, 0, to, 0);
+    if (ret == JACON_OK) ret = Jacon_str_append_n(out, "]", 1);
+
+    if (ret != JACON_OK && out->string != NULL) {
+        out->count = start_count;
+        out->string[out->count] = '\0';
+    }
+    Jacon_str_free(&state.path);
+    Jacon_free(from_hashes.items);
+    Jacon_free(to_hashes.items);
+    return ret;
+}
+
+/**
+ * Deep equality, numbers compare by their significant digits and object members in any order
+ */
+bool
+Jacon_node_equal(const Jacon_Node* a, const Jacon_Node* b)
+{
+    if (a == b) return true;
+    bool a_numeric = a->type == JACON_VALUE_INT || a->type == JACON_VALUE_FLOAT || a->type == JACON_VALUE_DOUBLE
+        || a->type == JACON_VALUE_NUMBER;
+    bool b_numeric = b->type == JACON_VALUE_INT || b->type == JACON_VALUE_FLOAT || b->type == JACON_VALUE_DOUBLE
+        || b->type == JACON_VALUE_NUMBER;
+    if (a_numeric || b_numeric) return a_numeric && b_numeric && Jacon_numbers_equal(a, b);
+    if (a->type != b->type) return false;
+
+    switch (a->type) {
+        case JACON_VALUE_STRING:
+            return a->value.string_val != NULL && b->value.string_val != NULL
+                && strcmp(a->value.string_val, b->value.string_val) == 0;
+        case JACON_VALUE_BOOLEAN:
+            return a->value.bool_val == b->value.bool_val;
+        case JACON_VALUE_NULL:
+            return true;
+        case JACON_VALUE_ARRAY:
+            if (a->child_count != b->child_count) return false;
+            for (size_t i = 0; i < a->child_count; i++) {
+                if (!Jacon_node_equal(a->childs[i], b->childs[i])) return false;
+            }
+            return true;
+        case JACON_VALUE_OBJECT:
+            if (a->child_count != b->child_count) return false;
+            for (size_t i = 0; i < a->child_count; i++) {
+                const Jacon_Node* member = a->childs[i]->name != NULL
+                    ? Jacon_get_child_by_name((Jacon_Node*)b, a->childs[i]->name) : NULL;
+                if (member == NULL || !Jacon_node_equal(a->childs[i], member)) return false;
+            }
+            return true;
+        case JACON_VALUE_INT:
+        case JACON_VALUE_FLOAT:
+        case JACON_VALUE_DOUBLE:
+        case JACON_VALUE_NUMBER:
+        default:
+            return false;
+    }
+}
+
+/**
+ * Array index of a reference token, below limit and without leading zero
+ */
+Jacon_Error
+Jacon_pointer_index(const char* token, size_t limit, size_t* index)
+{
+    if (*token == '\0' || (token[0] == '0' && token[1] != '\0')) return JACON_ERR_INVALID_JSON;
+    size_t value = 0;
+    for (const char* c = token; *c != '\0'; c++) {
+        if (!isdigit((unsigned char)*c)) return JACON_ERR_INVALID_JSON;
+        if (value > (SIZE_MAX - 9) / 10) return JACON_ERR_INDEX_OUT_OF_BOUND;
+        value = value * 10 + (size_t)(*c - '0');
+    }
+    if (value >= limit) return JACON_ERR_INDEX_OUT_OF_BOUND;
+    *index = value;
+    return JACON_OK;
+}
+
+/**
+ * Child of node designated by a decoded reference token, index receives its position
+ */
+Jacon_Error
+Jacon_pointer_child(const Jacon_Node* node, const char* token, size_t* index)
+{
+    if (node->type == JACON_VALUE_ARRAY) return Jacon_pointer_index(token, node->child_count, index);
+    if (node->type != JACON_VALUE_OBJECT) return JACON_ERR_CHILD_NOT_FOUND;
+    for (size_t i = 0; i < node->child_count; i++) {
+        if (node->childs[i]->name != NULL && strcmp(node->childs[i]->name, token) == 0) {
+            *index = i;
+            return JACON_OK;
+        }
+    }
+    return JACON_ERR_CHILD_NOT_FOUND;
+}
+
+/**
+ * Walk a Json Pointer down to the parent of its target, unsharing every node on the way
+ * when writable is set. token receives the decoded last reference token, to be freed.
+ * The empty pointer (whole document) is rejected, callers handle it.
+ */
+Jacon_Error
+Jacon_pointer_parent(Jacon_Node* root, const char* pointer, bool writable, Jacon_Node** parent, char** token)
+{
+    if (*pointer != '/') return JACON_ERR_INVALID_JSON;
+    Jacon_StringBuilder decoded = {0};
+    Jacon_Node* node = root;
+    Jacon_Error ret = JACON_OK;
+
+    while (true) {
+        pointer++;
+        Jacon_path_truncate(&decoded, 0);
+        ret = Jacon_str_reserve(&decoded, 0);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        while (*pointer != '\0' && *pointer != '/') {
+            char c = *pointer++;
+            if (c == '~') {
+                if (*pointer != '0' && *pointer != '1') Jacon_defer_return(JACON_ERR_INVALID_JSON);
+                c = *pointer++ == '0' ? '~' : '/';
+            }
+            ret = Jacon_str_append_n(&decoded, &c, 1);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+        if (*pointer == '\0') break;
+
+        size_t index;
+        ret = Jacon_pointer_child(node, decoded.string, &index);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        node = writable ? Jacon_unshare_child(node, index) : node->childs[index];
+        if (node == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+    }
+    *parent = node;
+    *token = decoded.string;
+    return JACON_OK;
+
+defer:
+    Jacon_str_free(&decoded);
+    return ret;
+}
+
+/**
+ * Node designated by a Json Pointer, read only
+ */
+Jacon_Error
+Jacon_pointer_get(Jacon_Node* root, const char* pointer, Jacon_Node** node)
+{
+    if (*pointer == '\0') {
+        *node = root;
+        return JACON_OK;
+    }
+    Jacon_Node* parent;
+    char* token;
+    size_t index;
+    Jacon_Error ret = Jacon_pointer_parent(root, pointer, false, &parent, &token);
+    if (ret != JACON_OK) return ret;
+    ret = Jacon_pointer_child(parent, token, &index);
+    if (ret == JACON_OK) *node = parent->childs[index];
+    Jacon_free(token);
+    return ret;
+}
+
+/**
+ * Move the content of value into node, node keeps its name and parent.
+ * value is freed, it now holds the previous content of node.
+ */
+void
+Jacon_assign_node(Jacon_Node* node, Jacon_Node* value)
+{
+    Jacon_Node tmp = *node;
+    node->type = value->type;
+    node->value = value->value;
+    node->childs = value->childs;
+    node->child_count = value->child_count;
+    node->child_capacity = value->child_capacity;
+    value->type = tmp.type;
+    value->value = tmp.value;
+    value->childs = tmp.childs;
+    value->child_count = tmp.child_count;
+    value->child_capacity = tmp.child_capacity;
+    for (size_t i = 0; i < node->child_count; i++) {
+        __atomic_store_n(&node->childs[i]->parent, node, __ATOMIC_RELAXED);
+    }
+    Jacon_free_node(value);
+}
+
+/**
+ * Insert child at index in an array node
+ */
+Jacon_Error
+Jacon_insert_child(Jacon_Node* node, size_t index, Jacon_Node* child)
+{
+    Jacon_Error ret = Jacon_append_child(node, child);
+    if (ret != JACON_OK) return ret;
+    memmove(node->childs + index + 1, node->childs + index, (node->child_count - 1 - index) * sizeof(Jacon_Node*));
+    node->childs[index] = child;
+    child->parent = node;
+    return JACON_OK;
+}
+
+/**
+ * Add value (owned on success) at pointer, replacing an existing member
+ */
+Jacon_Error
+Jacon_patch_add(Jacon_Node* root, const char* pointer, Jacon_Node* value)
+{
+    if (*pointer == '\0') {
+        Jacon_assign_node(root, value);
+        return JACON_OK;
+    }
+    Jacon_Node* parent;
+    char* token;
+    Jacon_Error ret = Jacon_pointer_parent(root, pointer, true, &parent, &token);
+    if (ret != JACON_OK) return ret;
+
+    Jacon_free(value->name);
+    value->name = NULL;
+    if (parent->type == JACON_VALUE_OBJECT) {
+        value->name = token;
+        token = NULL;
+        ret = Jacon_replace_child(parent, value->name, value);
+        if (ret == JACON_ERR_CHILD_NOT_FOUND) {
+            ret = Jacon_append_child(parent, value);
+            value->parent = parent;
+        }
+    } else if (parent->type == JACON_VALUE_ARRAY) {
+        // "-" and the array size both append
+        size_t index = parent->child_count;
+        if (strcmp(token, "-") != 0) ret = Jacon_pointer_index(token, parent->child_count + 1, &index);
+        if (ret == JACON_OK) ret = Jacon_insert_child(parent, index, value);
+    } else {
+        ret = JACON_ERR_CHILD_NOT_FOUND;
+    }
+    Jacon_free(token);
+    return ret;
+}
+
+Jacon_Error
+Jacon_patch_remove(Jacon_Node* root, const char* pointer)
+{
+    if (*pointer == '\0') return JACON_ERR_INVALID_JSON;
+    Jacon_Node* parent;
+    char* token;
+    size_t index;
+    Jacon_Error ret = Jacon_pointer_parent(root, pointer, true, &parent, &token);
+    if (ret != JACON_OK) return ret;
+    ret = Jacon_pointer_child(parent, token, &index);
+    if (ret == JACON_OK && parent->type == JACON_VALUE_OBJECT) {
+        ret = Jacon_remove_child_by_name(parent, token);
+    } else if (ret == JACON_OK) {
+        Jacon_free_node(parent->childs[index]);
+        memmove(parent->childs + index, parent->childs + index + 1, (parent->child_count - 1 - index) * sizeof(Jacon_Node*));
+        parent->childs[--parent->child_count] = NULL;
+    }
+    Jacon_free(token);
+    return ret;
+}
+
+/**
+ * Replace the node at pointer by value, owned on success
+ */
+Jacon_Error
+Jacon_patch_replace(Jacon_Node* root, const char* pointer, Jacon_Node* value)
+{
+    if (*pointer == '\0') {
+        Jacon_assign_node(root, value);
+        return JACON_OK;
+    }
+    Jacon_Node* parent;
+    char* token;
+    size_t index;
+    Jacon_Error ret = Jacon_pointer_parent(root, pointer, true, &parent, &token);
+    if (ret != JACON_OK) return ret;
+    ret = Jacon_pointer_child(parent, token, &index);
+    if (ret == JACON_OK) {
+        Jacon_free(value->name);
+        value->name = NULL;
+        if (parent->type == JACON_VALUE_OBJECT) {
+            value->name = token;
+            token = NULL;
+            ret = Jacon_replace_child(parent, value->name, value);
+        } else {
+            Jacon_free_node(parent->childs[index]);
+            parent->childs[index] = value;
+            value->parent = parent;
+        }
+    }
+    Jacon_free(token);
+    return ret;
+}
+
+const char*
+Jacon_patch_member_string(Jacon_Node* operation, const char* name)
+{
+    Jacon_Node* member = Jacon_get_child_by_name(operation, name);
+    return member != NULL && member->type == JACON_VALUE_STRING ? member->value.string_val : NULL;
+}
+
+Jacon_Error
+Jacon_apply_operation(Jacon_Node* root, Jacon_Node* operation)
+{
+    if (operation->type != JACON_VALUE_OBJECT) return JACON_ERR_INVALID_JSON;
+    const char* op = Jacon_patch_member_string(operation, "op");
+    const char* path = Jacon_patch_member_string(operation, "path");
+    const char* from = Jacon_patch_member_string(operation, "from");
+    Jacon_Node* value = Jacon_get_child_by_name(operation, "value");
+    Jacon_Node* source = NULL;
+    Jacon_Error ret;
+    if (op == NULL || path == NULL) return JACON_ERR_INVALID_JSON;
+
+    if (strcmp(op, "test") == 0) {
+        if (value == NULL) return JACON_ERR_INVALID_JSON;
+        ret = Jacon_pointer_get(root, path, &source);
+        if (ret != JACON_OK) return ret;
+        return Jacon_node_equal(source, value) ? JACON_OK : JACON_ERR_PATCH_TEST_FAILED;
+    }
+    if (strcmp(op, "remove") == 0) return Jacon_patch_remove(root, path);
+
+    if (strcmp(op, "add") == 0 || strcmp(op, "replace") == 0) {
+        if (value == NULL) return JACON_ERR_INVALID_JSON;
+        source = value;
+    } else if (strcmp(op, "copy") == 0 || strcmp(op, "move") == 0) {
+        if (from == NULL) return JACON_ERR_INVALID_JSON;
+        ret = Jacon_pointer_get(root, from, &source);
+        if (ret != JACON_OK) return ret;
+    } else {
+        return JACON_ERR_INVALID_JSON;
+    }
+
+    // Shares the value subtree, it stays valid once its source is removed
+    Jacon_Node* copy = Jacon_share_node(source);
+    if (copy == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    if (strcmp(op, "move") == 0) {
+        size_t from_size = strlen(from);
+        // A node cannot be moved into itself
+        if (strncmp(from, path, from_size) == 0 && path[from_size] == '/') ret = JACON_ERR_INVALID_JSON;
+        else ret = strcmp(from, path) == 0 ? JACON_OK : Jacon_patch_remove(root, from);
+        if (ret != JACON_OK || strcmp(from, path) == 0) {
+            Jacon_free_node(copy);
+            return ret;
+        }
+    }
+    ret = strcmp(op, "replace") == 0 ? Jacon_patch_replace(root, path, copy) : Jacon_patch_add(root, path, copy);
+    if (ret != JACON_OK) Jacon_free_node(copy);
+    return ret;
+}
+
+/**
+ * Run every operation of patch on a clone sharing root, root itself is left untouched.
+ * The patched clone is returned in result.
+ */
+Jacon_Error
+Jacon_patch_clone(Jacon_Node* root, const char* patch, Jacon_Node** result)
+{
+    Jacon_content operations = {0};
+    Jacon_Node* clone = NULL;
+    Jacon_Error ret = Jacon_init_content(&operations);
+    if (ret != JACON_OK) return ret;
+    ret = Jacon_deserialize(&operations, patch);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    if (operations.root->type != JACON_VALUE_ARRAY) Jacon_defer_return(JACON_ERR_INVALID_JSON);
+
+    // Operations run on a clone sharing the document, only touched paths get copied
+    clone = Jacon_share_node(root);
+    if (clone == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+    for (size_t i = 0; i < operations.root->child_count; i++) {
+        ret = Jacon_apply_operation(clone, operations.root->childs[i]);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+    }
+    *result = clone;
+    clone = NULL;
+
+defer:
+    if (clone != NULL) Jacon_free_node(clone);
+    Jacon_free_content(&operations);
+    return ret;
+}
+
+Jacon_Error
+Jacon_apply_patch(Jacon_Node* root, const char* patch)
+{
+    if (root == NULL || patch == NULL) return JACON_ERR_NULL_PARAM;
+
+    Jacon_Node* clone = NULL;
+    Jacon_Error ret = Jacon_patch_clone(root, patch, &clone);
+    if (ret != JACON_OK) return ret;
+    // The whole patch succeeded, root takes the result and clone its former content
+    Jacon_assign_node(root, clone);
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_content_apply_patch(Jacon_content* content, const char* patch)
+{
+    if (content == NULL || content->root == NULL || patch == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_HashMap entries = {0};
+    Jacon_Node* clone = NULL;
+    Jacon_Error ret = Jacon_patch_clone(content->root, patch, &clone);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+
+    // Any path may have changed, the index is rebuilt aside so a failure keeps the current one
+    entries = (Jacon_HashMap){
+        .entries = Jacon_calloc(10, sizeof(Jacon_HashMapEntry*)),
+        .size = 10
+    };
+    if (entries.entries == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+    ret = Jacon_add_node_to_map(&entries, clone, NULL);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+
+    // Indexed nodes are below clone, they move to the root as they are
+    Jacon_assign_node(content->root, clone);
+    clone = NULL;
+    Jacon_hm_free(&content->entries);
+    content->entries = entries;
+    entries = (Jacon_HashMap){0};
+
+defer:
+    if (clone != NULL) Jacon_free_node(clone);
+    Jacon_hm_free(&entries);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+/**
+ * Remove from the path index every entry of node, path holds the prefix of its name
+ */
+void
+Jacon_unindex_node(Jacon_HashMap* index, const Jacon_Node* node, Jacon_StringBuilder* path)
+{
+    size_t path_count = path->count;
+    if (node->name != NULL && Jacon_str_append_n(path, node->name, strlen(node->name)) == JACON_OK) {
+        if (node->type == JACON_VALUE_OBJECT) {
+            if (Jacon_str_append_n(path, ".", 1) == JACON_OK) {
+                for (size_t i = 0; i < node->child_count; i++) Jacon_unindex_node(index, node->childs[i], path);
+            }
+        } else {
+            Jacon_Node* entry = Jacon_hm_remove(index, path->string);
+            if (entry != NULL) Jacon_free_node(entry);
+        }
+    }
+    Jacon_path_truncate(path, path_count);
+}
+
+/**
+ * Drop the NULL slots left in childs
+ */
+void
+Jacon_compact_childs(Jacon_Node* node)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < node->child_count; i++) {
+        if (node->childs[i] != NULL) node->childs[count++] = node->childs[i];
+    }
+    for (size_t i = count; i < node->child_count; i++) node->childs[i] = NULL;
+    node->child_count = count;
+}
+
+/**
+ * Merging an object where there was none keeps only its non null members, recursively
+ */
+Jacon_Error
+Jacon_remove_null_members(Jacon_Node* node)
+{
+    for (size_t i = 0; i < node->child_count; i++) {
+        if (node->childs[i]->type == JACON_VALUE_NULL) {
+            Jacon_free_node(node->childs[i]);
+            node->childs[i] = NULL;
+        } else if (node->childs[i]->type == JACON_VALUE_OBJECT) {
+            Jacon_Node* child = Jacon_unshare_child(node, i);
+            if (child == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+            Jacon_Error ret = Jacon_remove_null_members(child);
+            if (ret != JACON_OK) return ret;
+        }
+    }
+    Jacon_compact_childs(node);
+    return JACON_OK;
+}
+
+#ifndef JACON_MERGE_LINEAR_LOOKUPS
+#define JACON_MERGE_LINEAR_LOOKUPS 4
+#endif
+
+/**
+ * Position of the last member named name in target, SIZE_MAX if there is none.
+ * table, when not NULL, is an open addressing set of target member positions.
+ */
+size_t
+Jacon_merge_find(const Jacon_Node* target, const char* name, const size_t* table, size_t mask)
+{
+    if (table == NULL) {
+        for (size_t i = target->child_count; i > 0; i--) {
+            const Jacon_Node* child = target->childs[i - 1];
+            if (child != NULL && child->name != NULL && strcmp(child->name, name) == 0) return i - 1;
+        }
+        return SIZE_MAX;
+    }
+    for (size_t slot = Jacon_hash((unsigned char*)name) & mask; table[slot] != SIZE_MAX; slot = (slot + 1) & mask) {
+        const Jacon_Node* child = target->childs[table[slot]];
+        if (child != NULL && strcmp(child->name, name) == 0) return table[slot];
+    }
+    return SIZE_MAX;
+}
+
+Jacon_Error
+Jacon_merge_objects(Jacon_HashMap* index, Jacon_Node* target, Jacon_Node* patch, Jacon_StringBuilder* path)
+{
+    Jacon_Error ret = JACON_OK;
+    size_t* table = NULL;
+    size_t mask = 0;
+    size_t path_count = path->count;
+
+    // Many members to merge, hash the target names once instead of scanning them for each
+    if (patch->child_count > JACON_MERGE_LINEAR_LOOKUPS && target->child_count > 0) {
+        size_t capacity = 16;
+        while (capacity < 2 * target->child_count) capacity *= 2;
+        table = Jacon_malloc(capacity * sizeof(size_t));
+        if (table == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        memset(table, 0xFF, capacity * sizeof(size_t));
+        mask = capacity - 1;
+        for (size_t i = 0; i < target->child_count; i++) {
+            const char* name = target->childs[i]->name;
+            if (name == NULL) continue;
+            size_t slot = Jacon_hash((unsigned char*)name) & mask;
+            while (table[slot] != SIZE_MAX && strcmp(target->childs[table[slot]]->name, name) != 0) slot = (slot + 1) & mask;
+            // Later duplicates win, as in the path index
+            table[slot] = i;
+        }
+    }
+
+    for (size_t i = 0; i < patch->child_count; i++) {
+        Jacon_Node* member = patch->childs[i];
+        if (member->name == NULL) continue;
+        size_t found = Jacon_merge_find(target, member->name, table, mask);
+
+        if (member->type == JACON_VALUE_NULL) {
+            // Removed, the slot is compacted once every member is merged
+            if (found == SIZE_MAX) continue;
+            Jacon_unindex_node(index, target->childs[found], path);
+            Jacon_free_node(target->childs[found]);
+            target->childs[found] = NULL;
+        } else if (member->type == JACON_VALUE_OBJECT && found != SIZE_MAX
+            && target->childs[found]->type == JACON_VALUE_OBJECT) {
+            Jacon_Node* child = Jacon_unshare_child(target, found);
+            if (child == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+            ret = Jacon_str_append_null(path, member->name, ".");
+            if (ret == JACON_OK) ret = Jacon_merge_objects(index, child, member, path);
+            Jacon_path_truncate(path, path_count);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        } else {
+            // The member moves from the patch to the target
+            if (member->type == JACON_VALUE_OBJECT) {
+                member = Jacon_unshare_child(patch, i);
+                if (member == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+                ret = Jacon_remove_null_members(member);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+            }
+            if (found != SIZE_MAX) {
+                Jacon_unindex_node(index, target->childs[found], path);
+                Jacon_free_node(target->childs[found]);
+                target->childs[found] = member;
+            } else {
+                ret = Jacon_append_child(target, member);
+                if (ret != JACON_OK) Jacon_defer_return(ret);
+            }
+            patch->childs[i] = NULL;
+            member->parent = target;
+            ret = Jacon_add_node_to_map(index, member, path->count > 0 ? path->string : NULL);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+    }
+
+defer:
+    Jacon_compact_childs(target);
+    Jacon_compact_childs(patch);
+    Jacon_free(table);
+    return ret;
+}
+
+/**
+ * Replace the path index by an empty one
+ */
+Jacon_Error
+Jacon_reset_index(Jacon_content* content)
+{
+    Jacon_hm_free(&content->entries);
+    content->entries = (Jacon_HashMap){
+        .entries = Jacon_calloc(10, sizeof(Jacon_HashMapEntry*)),
+        .size = 10
+    };
+    return content->entries.entries == NULL ? JACON_ERR_MEMORY_ALLOCATION : JACON_OK;
+}
+
+Jacon_Error
+Jacon_merge_patch(Jacon_content* target, Jacon_content* patch)
+{
+    if (target == NULL || patch == NULL || target->root == NULL || patch->root == NULL) return JACON_ERR_NULL_PARAM;
+    // Nodes move from one content to the other, they must be freed the same way
+    if (target->allocator != patch->allocator) return JACON_ERR_ALLOCATOR_MISMATCH;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(target->allocator);
+    Jacon_StringBuilder path = {0};
+    Jacon_Error ret = JACON_OK;
+
+    if (patch->root->type != JACON_VALUE_OBJECT) {
+        // Anything but an object replaces the whole target
+        Jacon_free_node(target->root);
+        target->root = patch->root;
+        patch->root = NULL;
+        ret = Jacon_reset_index(target);
+        if (ret == JACON_OK) ret = Jacon_build_content(target);
+    } else {
+        if (target->root->type != JACON_VALUE_OBJECT) {
+            Jacon_Node* object = Jacon_calloc(1, sizeof(Jacon_Node));
+            if (object == NULL) Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+            object->type = JACON_VALUE_OBJECT;
+            Jacon_free_node(target->root);
+            target->root = object;
+            ret = Jacon_reset_index(target);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+        ret = Jacon_merge_objects(&target->entries, target->root, patch->root, &path);
+    }
+
+    // What is left of the patch is released, it ends up empty
+    if (patch->root != NULL) Jacon_free_node(patch->root);
+    patch->root = Jacon_calloc(1, sizeof(Jacon_Node));
+    if (patch->root == NULL && ret == JACON_OK) ret = JACON_ERR_MEMORY_ALLOCATION;
+    if (Jacon_reset_index(patch) != JACON_OK && ret == JACON_OK) ret = JACON_ERR_MEMORY_ALLOCATION;
+
+defer:
+    Jacon_str_free(&path);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+/**
+ * Writable node at the dotted path of content, prefix receives the index prefix of its members
+ */
+Jacon_Error
+Jacon_content_parent(Jacon_content* content, const char* path, Jacon_Node** parent, Jacon_StringBuilder* prefix)
+{
+    *parent = content->root;
+    if (path == NULL || *path == '\0') return JACON_OK;
+    Jacon_Error ret = Jacon_str_append_null(prefix, path, ".");
+    if (ret != JACON_OK) return ret;
+    return Jacon_unshare_path_node(content->root, path, parent);
+}
+
+/**
+ * Index again what changed below parent, the members named name or the whole parent array
+ */
+Jacon_Error
+Jacon_content_reindex(Jacon_content* content, Jacon_Node* parent, const char* name, Jacon_StringBuilder* prefix)
+{
+    if (parent->type == JACON_VALUE_ARRAY) {
+        // Arrays are indexed whole, a root array is not indexed at all
+        if (prefix->count == 0) return JACON_OK;
+        Jacon_path_truncate(prefix, prefix->count - 1);
+        Jacon_Node* duped = Jacon_share_node(parent);
+        if (duped == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        return Jacon_hm_put(&content->entries, prefix->string, duped);
+    }
+    // Duplicate members all contribute to the index, in order
+    for (size_t i = 0; i < parent->child_count; i++) {
+        Jacon_Node* child = parent->childs[i];
+        if (child->name == NULL || strcmp(child->name, name) != 0) continue;
+        Jacon_Error ret = Jacon_add_node_to_map(&content->entries, child, prefix->count > 0 ? prefix->string : NULL);
+        if (ret != JACON_OK) return ret;
+    }
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_content_append_child(Jacon_content* content, const char* path, Jacon_Node* child)
+{
+    if (content == NULL || content->root == NULL || child == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_StringBuilder prefix = {0};
+    Jacon_Node* parent = NULL;
+    Jacon_Error ret = Jacon_content_parent(content, path, &parent, &prefix);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    if (parent->type == JACON_VALUE_OBJECT ? child->name == NULL : parent->type != JACON_VALUE_ARRAY) {
+        Jacon_defer_return(JACON_ERR_INVALID_VALUE_TYPE);
+    }
+    ret = Jacon_append_child(parent, child);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    child->parent = parent;
+
+    // Appended last, the new member overrides its duplicates as a full rebuild would
+    if (parent->type == JACON_VALUE_OBJECT) {
+        ret = Jacon_add_node_to_map(&content->entries, child, prefix.count > 0 ? prefix.string : NULL);
+    } else {
+        ret = Jacon_content_reindex(content, parent, NULL, &prefix);
+    }
+
+defer:
+    Jacon_str_free(&prefix);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+Jacon_Error
+Jacon_content_replace_child(Jacon_content* content, const char* path, const char* name, Jacon_Node* new)
+{
+    if (content == NULL || content->root == NULL || name == NULL || new == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_StringBuilder prefix = {0};
+    Jacon_Node* parent = NULL;
+    Jacon_Error ret = Jacon_content_parent(content, path, &parent, &prefix);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    if (parent->type != JACON_VALUE_OBJECT) Jacon_defer_return(JACON_ERR_INVALID_VALUE_TYPE);
+    Jacon_Node* old = Jacon_get_child_by_name(parent, name);
+    if (old == NULL) Jacon_defer_return(JACON_ERR_CHILD_NOT_FOUND);
+
+    Jacon_unindex_node(&content->entries, old, &prefix);
+    ret = Jacon_replace_child(parent, name, new);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    ret = Jacon_content_reindex(content, parent, name, &prefix);
+    // The replacing member may bring its own name
+    if (ret == JACON_OK && new->name != NULL && strcmp(new->name, name) != 0) {
+        ret = Jacon_content_reindex(content, parent, new->name, &prefix);
+    }
+
+defer:
+    Jacon_str_free(&prefix);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+Jacon_Error
+Jacon_content_remove_child_by_name(Jacon_content* content, const char* path, const char* name)
+{
+    if (content == NULL || content->root == NULL || name == NULL) return JACON_ERR_NULL_PARAM;
+
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_StringBuilder prefix = {0};
+    Jacon_Node* parent = NULL;
+    Jacon_Error ret = Jacon_content_parent(content, path, &parent, &prefix);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    if (parent->type != JACON_VALUE_OBJECT) Jacon_defer_return(JACON_ERR_INVALID_VALUE_TYPE);
+    Jacon_Node* old = Jacon_get_child_by_name(parent, name);
+    if (old == NULL) Jacon_defer_return(JACON_ERR_CHILD_NOT_FOUND);
+
+    Jacon_unindex_node(&content->entries, old, &prefix);
+    ret = Jacon_remove_child_by_name(parent, name);
+    if (ret != JACON_OK) Jacon_defer_return(ret);
+    // Remaining duplicates get back the paths the removed member hid
+    ret = Jacon_content_reindex(content, parent, name, &prefix);
+
+defer:
+    Jacon_str_free(&prefix);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
+
+Jacon_Error
+Jacon_batch_record(Jacon_Batch* batch, Jacon_BatchOperationType type, const char* path, const char* name, Jacon_Node* node)
+{
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity == 0 ? 16 : batch->capacity * 2;
+        Jacon_BatchOperation* operations = Jacon_realloc(batch->operations, capacity * sizeof(Jacon_BatchOperation));
+        if (operations == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        batch->operations = operations;
+        batch->capacity = capacity;
+    }
+    char* path_copy = Jacon_strdup(path != NULL ? path : "");
+    char* name_copy = name != NULL ? Jacon_strdup(name) : NULL;
+    if (path_copy == NULL || (name != NULL && name_copy == NULL)) {
+        Jacon_free(path_copy);
+        Jacon_free(name_copy);
+        return JACON_ERR_MEMORY_ALLOCATION;
+    }
+    batch->operations[batch->count++] = (Jacon_BatchOperation){
+        .type = type,
+        .path = path_copy,
+        .name = name_copy,
+        .node = node
+    };
+    return JACON_OK;
+}
+
+Jacon_Error
+Jacon_batch_append(Jacon_Batch* batch, const char* path, Jacon_Node* child)
+{
+    if (batch == NULL || child == NULL) return JACON_ERR_NULL_PARAM;
+    return Jacon_batch_record(batch, JACON_BATCH_APPEND, path, NULL, child);
+}
+
+Jacon_Error
+Jacon_batch_replace(Jacon_Batch* batch, const char* path, const char* name, Jacon_Node* new)
+{
+    if (batch == NULL || name == NULL || new == NULL) return JACON_ERR_NULL_PARAM;
+    return Jacon_batch_record(batch, JACON_BATCH_REPLACE, path, name, new);
+}
+
+Jacon_Error
+Jacon_batch_remove(Jacon_Batch* batch, const char* path, const char* name)
+{
+    if (batch == NULL || name == NULL) return JACON_ERR_NULL_PARAM;
+    return Jacon_batch_record(batch, JACON_BATCH_REMOVE, path, name, NULL);
+}
+
+void
+Jacon_batch_clear(Jacon_Batch* batch)
+{
+    for (size_t i = 0; i < batch->count; i++) {
+        Jacon_free(batch->operations[i].path);
+        Jacon_free(batch->operations[i].name);
+    }
+    batch->count = 0;
+}
+
+void
+Jacon_batch_free(Jacon_Batch* batch)
+{
+    if (batch == NULL) return;
+    for (size_t i = 0; i < batch->count; i++) {
+        if (batch->operations[i].node != NULL) Jacon_free_node(batch->operations[i].node);
+    }
+    Jacon_batch_clear(batch);
+    Jacon_free(batch->operations);
+    *batch = (Jacon_Batch){0};
+}
+
+typedef struct {
+    Jacon_Node* parent;
+    size_t index;
+} Jacon_BatchOrder;
+
+int
+Jacon_batch_order_compare(const void* a, const void* b)
+{
+    const Jacon_BatchOrder* left = a;
+    const Jacon_BatchOrder* right = b;
+    if (left->parent != right->parent) return (uintptr_t)left->parent < (uintptr_t)right->parent ? -1 : 1;
+    return left->index < right->index ? -1 : left->index > right->index;
+}
+
+typedef struct {
+    const char* name;
+    // First and last slots holding a member of that name, SIZE_MAX if there is none
+    size_t head;
+    size_t tail;
+    // A member of that name was appended, replaced or removed
+    bool changed;
+} Jacon_BatchName;
+
+typedef struct {
+    Jacon_Node* parent;
+    const char* path;
+    // Childs of parent once the operations are run, removed members leave NULL slots
+    Jacon_Node** childs;
+    size_t count;
+    size_t capacity;
+    size_t appends;
+    // Next slot holding a member of the same name
+    size_t* next;
+    // Open addressing table of the member names, only built for replaces and removes
+    Jacon_BatchName* names;
+    size_t mask;
+    // Distance from the root to parent
+    size_t depth;
+} Jacon_BatchGroup;
+
+typedef struct {
+    Jacon_Node* node;
+    const Jacon_BatchGroup* group;
+    // Index of the operation that took node out
+    size_t operation;
+} Jacon_BatchDropped;
+
+int
+Jacon_batch_dropped_compare(const void* a, const void* b)
+{
+    const Jacon_BatchDropped* left = a;
+    const Jacon_BatchDropped* right = b;
+    if (left->node == right->node) return 0;
+    return (uintptr_t)left->node < (uintptr_t)right->node ? -1 : 1;
+}
+
+/**
+ * Whether node or one of its ancestors up to root was taken out by an operation before the given one,
+ * dropped being sorted by node
+ */
+bool
+Jacon_batch_dropped_before(const Jacon_Node* root, const Jacon_Node* node,
+    const Jacon_BatchDropped* dropped, size_t dropped_count, size_t operation)
+{
+    // Parents were all unshared on the way down, their parent pointers are valid
+    for (; node != root; node = node->parent) {
+        Jacon_BatchDropped key = { .node = (Jacon_Node*)node };
+        const Jacon_BatchDropped* found = bsearch(&key, dropped, dropped_count, sizeof(Jacon_BatchDropped),
+            Jacon_batch_dropped_compare);
+        if (found != NULL && found->operation < operation) return true;
+    }
+    return false;
+}
+
+Jacon_BatchName*
+Jacon_batch_name(Jacon_BatchGroup* group, const char* name)
+{
+    size_t slot = Jacon_hash((unsigned char*)name) & group->mask;
+    while (group->names[slot].name != NULL && strcmp(group->names[slot].name, name) != 0) {
+        slot = (slot + 1) & group->mask;
+    }
+    if (group->names[slot].name == NULL) {
+        group->names[slot] = (Jacon_BatchName){ .name = name, .head = SIZE_MAX, .tail = SIZE_MAX };
+    }
+    return &group->names[slot];
+}
+
+void
+Jacon_batch_link(Jacon_BatchGroup* group, size_t slot)
+{
+    group->next[slot] = SIZE_MAX;
+    if (group->names == NULL || group->childs[slot]->name == NULL) return;
+    Jacon_BatchName* entry = Jacon_batch_name(group, group->childs[slot]->name);
+    if (entry->head == SIZE_MAX) entry->head = slot;
+    else group->next[entry->tail] = slot;
+    entry->tail = slot;
+}
+
+/**
+ * Link slot in the chain of its member name wherever it is, a replacing member may bring its own name
+ */
+void
+Jacon_batch_insert(Jacon_BatchGroup* group, size_t slot)
+{
+    if (group->childs[slot]->name == NULL) return;
+    Jacon_BatchName* entry = Jacon_batch_name(group, group->childs[slot]->name);
+    entry->changed = true;
+    if (entry->head == SIZE_MAX || slot < entry->head) {
+        group->next[slot] = entry->head;
+        if (entry->head == SIZE_MAX) entry->tail = slot;
+        entry->head = slot;
+        return;
+    }
+    size_t previous = entry->head;
+    while (group->next[previous] != SIZE_MAX && group->next[previous] < slot) previous = group->next[previous];
+    group->next[slot] = group->next[previous];
+    group->next[previous] = slot;
+    if (group->next[slot] == SIZE_MAX) entry->tail = slot;
+}
+
+Jacon_Error
+Jacon_batch_prepare(Jacon_BatchGroup* group, bool lookups)
+{
+    Jacon_Node* parent = group->parent;
+    group->capacity = parent->child_count + group->appends;
+    // Only removes and replaces on an empty parent, they cannot find their member
+    if (group->capacity == 0) return JACON_ERR_CHILD_NOT_FOUND;
+    group->childs = Jacon_malloc(group->capacity * sizeof(Jacon_Node*));
+    group->next = Jacon_malloc(group->capacity * sizeof(size_t));
+    if (group->childs == NULL || group->next == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+    if (lookups) {
+        size_t size = 16;
+        while (size < 2 * group->capacity) size *= 2;
+        group->names = Jacon_calloc(size, sizeof(Jacon_BatchName));
+        if (group->names == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        group->mask = size - 1;
+    }
+    for (size_t i = 0; i < parent->child_count; i++) {
+        group->childs[i] = parent->childs[i];
+        Jacon_batch_link(group, i);
+    }
+    group->count = parent->child_count;
+    return JACON_OK;
+}
+
+/**
+ * Run an operation on the childs of its group, members it takes out are added to dropped
+ */
+Jacon_Error
+Jacon_batch_run(Jacon_BatchGroup* group, const Jacon_BatchOperation* operation, size_t operation_index,
+    Jacon_BatchDropped* dropped, size_t* dropped_count)
+{
+    if (operation->type == JACON_BATCH_APPEND) {
+        group->childs[group->count] = operation->node;
+        Jacon_batch_link(group, group->count++);
+        if (group->names != NULL) Jacon_batch_name(group, operation->node->name)->changed = true;
+        return JACON_OK;
+    }
+
+    // First member of that name, as Jacon_replace_child and Jacon_remove_child_by_name do
+    Jacon_BatchName* entry = Jacon_batch_name(group, operation->name);
+    if (entry->head == SIZE_MAX) return JACON_ERR_CHILD_NOT_FOUND;
+    entry->changed = true;
+    size_t slot = entry->head;
+    dropped[(*dropped_count)++] = (Jacon_BatchDropped){ group->childs[slot], group, operation_index };
+    const char* name = operation->type == JACON_BATCH_REPLACE ? operation->node->name : NULL;
+    group->childs[slot] = operation->type == JACON_BATCH_REPLACE ? operation->node : NULL;
+    if (name != NULL && strcmp(name, operation->name) == 0) return JACON_OK;
+    entry->head = group->next[slot];
+    if (name != NULL) Jacon_batch_insert(group, slot);
+    return JACON_OK;
+}
+
+/**
+ * Exchange the childs of a group parent with the ones the operations left in the group
+ */
+void
+Jacon_batch_swap(Jacon_BatchGroup* group)
+{
+    Jacon_Node* parent = group->parent;
+    Jacon_Node** childs = parent->childs;
+    size_t count = parent->child_count;
+    size_t capacity = parent->child_capacity;
+    parent->childs = group->childs;
+    parent->child_count = group->count;
+    parent->child_capacity = group->capacity;
+    group->childs = childs;
+    group->count = count;
+    group->capacity = capacity;
+}
+
+/**
+ * Index the members of a swapped in group that changed
+ */
+Jacon_Error
+Jacon_batch_reindex(Jacon_HashMap* index, Jacon_BatchGroup* group, Jacon_StringBuilder* prefix)
+{
+    Jacon_Node* parent = group->parent;
+    if (parent->type == JACON_VALUE_ARRAY) {
+        // Arrays are indexed whole, a root array is not indexed at all
+        if (prefix->count == 0) return JACON_OK;
+        Jacon_path_truncate(prefix, prefix->count - 1);
+        Jacon_Node* duped = Jacon_share_node(parent);
+        if (duped == NULL) return JACON_ERR_MEMORY_ALLOCATION;
+        Jacon_Error ret = Jacon_hm_put(index, prefix->string, duped);
+        if (ret != JACON_OK) Jacon_free_node(duped);
+        return ret;
+    }
+
+    // Appends only, the new members come last and override their duplicates
+    size_t first = group->names != NULL ? 0 : parent->child_count - group->appends;
+    for (size_t i = first; i < parent->child_count; i++) {
+        Jacon_Node* child = parent->childs[i];
+        if (group->names != NULL && !Jacon_batch_name(group, child->name)->changed) continue;
+        Jacon_Error ret = Jacon_add_node_to_map(index, child, prefix->count > 0 ? prefix->string : NULL);
+        if (ret != JACON_OK) return ret;
+    }
+    return JACON_OK;
+}
+
+/**
+ * Collect in paths the index entries of node, path holds the prefix of its name
+ */
+Jacon_Error
+Jacon_batch_index_paths(Jacon_HashMap* paths, const Jacon_Node* node, Jacon_StringBuilder* path)
+{
+    if (node->name == NULL) return JACON_OK;
+    size_t path_count = path->count;
+    Jacon_Error ret = Jacon_str_append_n(path, node->name, strlen(node->name));
+    if (ret == JACON_OK && node->type == JACON_VALUE_OBJECT) {
+        ret = Jacon_str_append_n(path, ".", 1);
+        for (size_t i = 0; ret == JACON_OK && i < node->child_count; i++) {
+            ret = Jacon_batch_index_paths(paths, node->childs[i], path);
+        }
+    } else if (ret == JACON_OK) {
+        ret = Jacon_hm_put(paths, path->string, NULL);
+    }
+    Jacon_path_truncate(path, path_count);
+    return ret;
+}
+
+/**
+ * Empty map of the initial path index size
+ */
+Jacon_Error
+Jacon_batch_index_init(Jacon_HashMap* map)
+{
+    *map = (Jacon_HashMap){
+        .entries = Jacon_calloc(10, sizeof(Jacon_HashMapEntry*)),
+        .size = 10
+    };
+    return map->entries == NULL ? JACON_ERR_MEMORY_ALLOCATION : JACON_OK;
+}
+
+int
+Jacon_batch_depth_compare(const void* a, const void* b)
+{
+    const Jacon_BatchGroup* left = *(Jacon_BatchGroup* const*)a;
+    const Jacon_BatchGroup* right = *(Jacon_BatchGroup* const*)b;
+    return left->depth > right->depth ? -1 : left->depth < right->depth;
+}
+
+Jacon_Error
+Jacon_batch_commit(Jacon_Node* root, Jacon_Batch* batch, Jacon_HashMap* index)
+{
+    if (root == NULL || batch == NULL) return JACON_ERR_NULL_PARAM;
+    if (batch->count == 0) return JACON_OK;
+
+    Jacon_Error ret = JACON_OK;
+    size_t group_count = 0;
+    size_t dropped_count = 0;
+    Jacon_StringBuilder prefix = {0};
+    // Index entries to remove and to add, gathered before the tree changes
+    Jacon_HashMap removed = {0};
+    Jacon_HashMap added = {0};
+    Jacon_BatchOrder* order = Jacon_malloc(batch->count * sizeof(Jacon_BatchOrder));
+    Jacon_BatchGroup* groups = Jacon_calloc(batch->count, sizeof(Jacon_BatchGroup));
+    Jacon_BatchDropped* dropped = Jacon_malloc(batch->count * sizeof(Jacon_BatchDropped));
+    Jacon_BatchGroup** deepest = Jacon_malloc(batch->count * sizeof(Jacon_BatchGroup*));
+    if (order == NULL || groups == NULL || dropped == NULL || deepest == NULL) {
+        Jacon_defer_return(JACON_ERR_MEMORY_ALLOCATION);
+    }
+
+    // Writable parents, unsharing them does not change the document
+    for (size_t i = 0; i < batch->count; i++) {
+        const Jacon_BatchOperation* operation = &batch->operations[i];
+        Jacon_Node* parent = NULL;
+        ret = Jacon_unshare_path_node(root, operation->path, &parent);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        bool named = operation->type != JACON_BATCH_APPEND || operation->node->name != NULL;
+        if (parent->type == JACON_VALUE_ARRAY ? operation->type != JACON_BATCH_APPEND
+            : parent->type != JACON_VALUE_OBJECT || !named) {
+            Jacon_defer_return(JACON_ERR_INVALID_VALUE_TYPE);
+        }
+        order[i] = (Jacon_BatchOrder){ parent, i };
+    }
+    qsort(order, batch->count, sizeof(Jacon_BatchOrder), Jacon_batch_order_compare);
+
+    // Run every operation on copies of the childs arrays, the tree is left untouched on failure
+    for (size_t start = 0, end = 0; start < batch->count; start = end) {
+        Jacon_BatchGroup* group = &groups[group_count++];
+        group->parent = order[start].parent;
+        group->path = batch->operations[order[start].index].path;
+        for (const Jacon_Node* node = group->parent; node != root; node = node->parent) group->depth++;
+        deepest[group_count - 1] = group;
+        bool lookups = false;
+        for (end = start; end < batch->count && order[end].parent == group->parent; end++) {
+            if (batch->operations[order[end].index].type == JACON_BATCH_APPEND) group->appends++;
+            else lookups = true;
+        }
+        ret = Jacon_batch_prepare(group, lookups);
+        if (ret != JACON_OK) Jacon_defer_return(ret);
+        for (size_t i = start; i < end; i++) {
+            ret = Jacon_batch_run(group, &batch->operations[order[i].index], order[i].index, dropped, &dropped_count);
+            if (ret != JACON_OK) Jacon_defer_return(ret);
+        }
+        size_t count = 0;
+        for (size_t i = 0; i < group->count; i++) {
+            if (group->childs[i] != NULL) group->childs[count++] = group->childs[i];
+        }
+        group->count = count;
+    }
+
+    // Paths were resolved up front, an operation below a member an earlier one took out has no target
+    qsort(dropped, dropped_count, sizeof(Jacon_BatchDropped), Jacon_batch_dropped_compare);
+    for (size_t i = 0; i < batch->count; i++) {
+        if (Jacon_batch_dropped_before(root, order[i].parent, dropped, dropped_count, order[i].index)) {
+            Jacon_defer_return(JACON_ERR_KEY_NOT_FOUND);
+        }
+    }
+
+    // Indexed on the swapped in childs so a member walks the changes below it, swapped back on failure
+    for (size_t g = 0; g < group_count; g++) Jacon_batch_swap(&groups[g]);
+    if (index != NULL) {
+        ret = Jacon_batch_index_init(&removed);
+        if (ret == JACON_OK) ret = Jacon_batch_index_init(&added);
+        for (size_t i = 0; ret == JACON_OK && i < dropped_count; i++) {
+            Jacon_path_truncate(&prefix, 0);
+            if (*dropped[i].group->path != '\0') ret = Jacon_str_append_null(&prefix, dropped[i].group->path, ".");
+            if (ret == JACON_OK) ret = Jacon_batch_index_paths(&removed, dropped[i].node, &prefix);
+        }
+        // Deepest groups first, a member walked again from a group above overrides their entries
+        qsort(deepest, group_count, sizeof(Jacon_BatchGroup*), Jacon_batch_depth_compare);
+        for (size_t g = 0; ret == JACON_OK && g < group_count; g++) {
+            Jacon_BatchGroup* group = deepest[g];
+            // A parent taken out of the document by a later operation has nothing left to index
+            if (Jacon_batch_dropped_before(root, group->parent, dropped, dropped_count, SIZE_MAX)) continue;
+            Jacon_path_truncate(&prefix, 0);
+            if (*group->path != '\0') ret = Jacon_str_append_null(&prefix, group->path, ".");
+            if (ret == JACON_OK) ret = Jacon_batch_reindex(&added, group, &prefix);
+        }
+        if (ret == JACON_OK) ret = Jacon_hm_reserve(index, added.entries_count);
+        if (ret != JACON_OK) {
+            for (size_t g = 0; g < group_count; g++) Jacon_batch_swap(&groups[g]);
+            Jacon_defer_return(ret);
+        }
+    }
+
+    // Nothing can fail from here on
+    for (size_t i = 0; i < batch->count; i++) {
+        Jacon_Node* node = batch->operations[order[i].index].node;
+        if (node != NULL) node->parent = order[i].parent;
+    }
+    if (index != NULL) {
+        for (size_t i = 0; i < removed.size; i++) {
+            for (Jacon_HashMapEntry* entry = removed.entries[i]; entry != NULL; entry = entry->next_entry) {
+                Jacon_Node* node = Jacon_hm_remove(index, entry->key);
+                if (node != NULL) Jacon_free_node(node);
+            }
+        }
+        Jacon_hm_move(index, &added);
+    }
+
+    for (size_t i = 0; i < dropped_count; i++) Jacon_free_node(dropped[i].node);
+    // The batch nodes now belong to the document
+    Jacon_batch_clear(batch);
+
+defer:
+    // The former childs once swapped in, the unused copies otherwise
+    for (size_t g = 0; g < group_count; g++) {
+        Jacon_free(groups[g].childs);
+        Jacon_free(groups[g].next);
+        Jacon_free(groups[g].names);
+    }
+    Jacon_free(order);
+    Jacon_free(groups);
+    Jacon_free(dropped);
+    Jacon_free(deepest);
+    Jacon_hm_free(&removed);
+    Jacon_hm_free(&added);
+    Jacon_str_free(&prefix);
+    return ret;
+}
+
+Jacon_Error
+Jacon_batch_apply(Jacon_Node* root, Jacon_Batch* batch)
+{
+    return Jacon_batch_commit(root, batch, NULL);
+}
+
+Jacon_Error
+Jacon_batch_apply_content(Jacon_content* content, Jacon_Batch* batch)
+{
+    if (content == NULL) return JACON_ERR_NULL_PARAM;
+    const Jacon_Allocator* previous = Jacon_push_allocator(content->allocator);
+    Jacon_Error ret = Jacon_batch_commit(content->root, batch, &content->entries);
+    Jacon_pop_allocator(previous);
+    return ret;
+}
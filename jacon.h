@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
 // Error codes
@@ -24,8 +25,91 @@ typedef enum {
     JACON_ERR_UNREACHABLE_STATEMENT,
     JACON_ERR_DUPLICATE_NAME,
     JACON_ERR_CHILD_NOT_FOUND,
+    JACON_ERR_IO,
+    JACON_ERR_INVALID_BINARY,
+    JACON_ERR_DEPTH_LIMIT,
+    JACON_ERR_INVALID_UTF8,
+    JACON_ERR_PATCH_TEST_FAILED,
+    JACON_ERR_INPUT_TOO_LARGE,
+    JACON_ERR_TOKEN_LIMIT,
+    JACON_ERR_MEMBER_LIMIT,
+    JACON_ERR_STRING_LIMIT,
+    JACON_ERR_MEMORY_LIMIT,
+    JACON_ERR_ALLOCATOR_MISMATCH,
 } Jacon_Error;
 
+/**
+ * User supplied allocation functions, ctx is handed back on every call.
+ * reallocate must accept a NULL ptr.
+ */
+typedef struct {
+    void* (*allocate)(void* ctx, size_t size);
+    void* (*reallocate)(void* ctx, void* ptr, size_t size);
+    void (*deallocate)(void* ctx, void* ptr);
+    void* ctx;
+} Jacon_Allocator;
+
+/**
+ * Route every library allocation through allocator.
+ * NULL restores the libc allocator.
+ */
+void
+Jacon_set_allocator(const Jacon_Allocator* allocator);
+
+/**
+ * Make allocator the one used by the calling thread, overriding the global one.
+ * Returns the previous one, to be given back to Jacon_pop_allocator.
+ * A NULL allocator keeps the current one.
+ */
+const Jacon_Allocator*
+Jacon_push_allocator(const Jacon_Allocator* allocator);
+
+void
+Jacon_pop_allocator(const Jacon_Allocator* previous);
+
+/**
+ * Parse statistics, only collected when the library is built with JACON_STATS defined.
+ * Counters are only ever added to: zero the struct for per call numbers, keep it to accumulate.
+ */
+typedef struct {
+    // Nanoseconds spent in Jacon_tokenize, Jacon_validate_input, Jacon_parse_tokens and Jacon_build_content
+    uint64_t tokenize_ns;
+    uint64_t validate_ns;
+    uint64_t parse_ns;
+    uint64_t build_ns;
+    uint64_t tokens;
+    uint64_t nodes;
+    uint64_t strings;
+    // Requested from the allocator, frees are not subtracted
+    uint64_t allocations;
+    uint64_t bytes_allocated;
+    uint64_t map_resizes;
+    // Path index lookups
+    uint64_t lookup_hits;
+    uint64_t lookup_misses;
+} Jacon_Stats;
+
+/**
+ * Collect the statistics of the calling thread into stats until Jacon_pop_stats.
+ * Returns the previous one, to be given back to Jacon_pop_stats.
+ * Work done by other threads (parallel parsing workers) is not collected.
+ */
+Jacon_Stats*
+Jacon_push_stats(Jacon_Stats* stats);
+
+void
+Jacon_pop_stats(Jacon_Stats* previous);
+
+// Allocation functions used by the library, memory returned to the user
+// (serialized strings) must be released with Jacon_free.
+// Strings from the getters of a content are released with Jacon_content_free
+void* Jacon_malloc(size_t size);
+void* Jacon_calloc(size_t count, size_t size);
+void* Jacon_realloc(void* ptr, size_t size);
+void Jacon_free(void* ptr);
+char* Jacon_strdup(const char* str);
+char* Jacon_strndup(const char* str, size_t size);
+
 typedef struct Jacon_StringBuilder Jacon_StringBuilder;
 
 struct Jacon_StringBuilder {
@@ -34,6 +118,39 @@ struct Jacon_StringBuilder {
     size_t capacity;
 };
 
+/**
+ * Append every string argument to the builder, the list must end with NULL
+ */
+Jacon_Error
+Jacon_str_append(Jacon_StringBuilder* builder, ...);
+
+/**
+ * Append a formatted string to the builder
+ */
+Jacon_Error
+Jacon_str_append_fmt(Jacon_StringBuilder* builder, const char* fmt, ...);
+
+/**
+ * Make room for size more bytes, capacity grows geometrically
+ */
+Jacon_Error
+Jacon_str_reserve(Jacon_StringBuilder* builder, size_t size);
+
+/**
+ * Append size bytes, data may contain NUL bytes
+ */
+Jacon_Error
+Jacon_str_append_n(Jacon_StringBuilder* builder, const char* data, size_t size);
+
+/**
+ * Free the memory allocated for the builder
+ */
+void
+Jacon_str_free(Jacon_StringBuilder *builder);
+
+#define Jacon_str_append_null(builder, ...) Jacon_str_append(builder, __VA_ARGS__, NULL)
+#define Jacon_str_append_fmt_null(builder, ...) Jacon_str_append_fmt(builder, __VA_ARGS__, NULL)
+
 #ifndef JACON_TMP_STR_BUF_SIZE
 #define JACON_TMP_STR_BUF_SIZE    1024
 #endif
@@ -143,6 +260,8 @@ typedef enum {
     JACON_VALUE_DOUBLE,
     JACON_VALUE_BOOLEAN,
     JACON_VALUE_NULL,
+    // Number kept as its Json text in string_val, see Jacon_content.raw_numbers
+    JACON_VALUE_NUMBER,
 } Jacon_ValueType;
 
 typedef struct {
@@ -165,12 +284,20 @@ struct Jacon_Node {
     Jacon_Node** childs;
     size_t child_count;
     size_t child_capacity;
+    // Owners besides the first one, a node with references must not be modified in place.
+    // The parent of a shared node may be any of its owners, or one already freed.
+    size_t ref_count;
 };
 
 typedef struct Jacon_content {
     Jacon_Node* root;
     // Dictionary for efficient value retrieving
     Jacon_HashMap entries;
+    // Used for everything allocated for the content, NULL uses the global one
+    const Jacon_Allocator* allocator;
+    // Numbers are parsed as JACON_VALUE_NUMBER, converted by the typed getters
+    // and serialized as they were written in the input
+    bool raw_numbers;
 } Jacon_content;
 
 // Tokenizer
@@ -187,6 +314,8 @@ typedef enum {
     JACON_TOKEN_NULL,
     JACON_TOKEN_COLON,
     JACON_TOKEN_COMMA,
+    // Unconverted number text in string_val
+    JACON_TOKEN_NUMBER,
 } Jacon_TokenType;
 
 typedef struct {
@@ -208,6 +337,8 @@ typedef struct {
     size_t count;
     size_t capacity;
     Jacon_Token* tokens;
+    // Emit JACON_TOKEN_NUMBER instead of converting numbers
+    bool raw_numbers;
 } Jacon_Tokenizer;
 
 /**
@@ -255,6 +386,211 @@ Jacon_add_node_to_map(Jacon_HashMap* map, Jacon_Node* node, const char* path_to_
 Jacon_Error
 Jacon_deserialize(Jacon_content* content, const char* str);
 
+/**
+ * Bounds on the work a single document may cause, 0 disables a limit
+ */
+typedef struct {
+    size_t max_input_size;
+    // Nested arrays and objects, the outermost one is at depth 1
+    size_t max_depth;
+    size_t max_tokens;
+    // Members of a single object
+    size_t max_object_members;
+    // Decoded bytes of a single string, member names included
+    size_t max_string_length;
+    // Requested from the allocator during the parse, the path index included
+    size_t max_allocated_bytes;
+} Jacon_ParseLimits;
+
+/**
+ * Jacon_deserialize stopping as soon as one of limits is exceeded, with
+ * JACON_ERR_INPUT_TOO_LARGE, JACON_ERR_DEPTH_LIMIT, JACON_ERR_TOKEN_LIMIT,
+ * JACON_ERR_MEMBER_LIMIT, JACON_ERR_STRING_LIMIT or JACON_ERR_MEMORY_LIMIT.
+ */
+Jacon_Error
+Jacon_deserialize_with_limits(Jacon_content* content, const char* str, const Jacon_ParseLimits* limits);
+
+/**
+ * Parse a Json string input keeping only the given dotted paths (ex: "user.id")
+ * and the objects leading to them.
+ * Every other member is skipped by matching quotes and brackets,
+ * without being validated nor allocated.
+ */
+Jacon_Error
+Jacon_deserialize_paths(Jacon_content* content, const char* str, const char** paths, size_t path_count);
+
+// Struct binding
+typedef enum {
+    // char*, allocated and unescaped
+    JACON_FIELD_STRING,
+    JACON_FIELD_INT,
+    JACON_FIELD_INT64,
+    JACON_FIELD_FLOAT,
+    JACON_FIELD_DOUBLE,
+    JACON_FIELD_BOOL,
+    // Nested struct stored inline
+    JACON_FIELD_OBJECT,
+    // Allocated elements pointer with a size_t count member
+    JACON_FIELD_ARRAY,
+} Jacon_FieldType;
+
+typedef struct Jacon_StructDescriptor Jacon_StructDescriptor;
+
+typedef struct {
+    const char* name;
+    Jacon_FieldType type;
+    size_t offset;
+    // Struct of an object field, or of the elements of an array of objects
+    const Jacon_StructDescriptor* descriptor;
+    // Arrays only
+    Jacon_FieldType element_type;
+    size_t count_offset;
+} Jacon_Field;
+
+struct Jacon_StructDescriptor {
+    size_t size;
+    const Jacon_Field* fields;
+    size_t field_count;
+};
+
+#define JACON_FIELD(struct_type, member, field_type) { \
+    .name = #member, \
+    .type = field_type, \
+    .offset = offsetof(struct_type, member) }
+
+#define JACON_FIELD_NAMED(struct_type, member, json_name, field_type) { \
+    .name = json_name, \
+    .type = field_type, \
+    .offset = offsetof(struct_type, member) }
+
+#define JACON_OBJECT_FIELD(struct_type, member, struct_descriptor) { \
+    .name = #member, \
+    .type = JACON_FIELD_OBJECT, \
+    .offset = offsetof(struct_type, member), \
+    .descriptor = struct_descriptor }
+
+// Element descriptor is NULL unless elements are JACON_FIELD_OBJECT
+#define JACON_ARRAY_FIELD(struct_type, member, count_member, elements_type, elements_descriptor) { \
+    .name = #member, \
+    .type = JACON_FIELD_ARRAY, \
+    .offset = offsetof(struct_type, member), \
+    .descriptor = elements_descriptor, \
+    .element_type = elements_type, \
+    .count_offset = offsetof(struct_type, count_member) }
+
+#define JACON_DESCRIPTOR(struct_type, field_array) { \
+    .size = sizeof(struct_type), \
+    .fields = field_array, \
+    .field_count = sizeof(field_array) / sizeof((field_array)[0]) }
+
+/**
+ * Parse a Json object straight into a struct described by descriptor, no node is built.
+ * out must not own memory yet, zero it first. Unknown members are skipped,
+ * missing and null ones leave their field untouched.
+ * On failure everything allocated is released.
+ */
+Jacon_Error
+Jacon_deserialize_struct(const char* str, const Jacon_StructDescriptor* descriptor, void* out);
+
+/**
+ * Release the strings and arrays of a struct filled by Jacon_deserialize_struct
+ */
+void
+Jacon_free_struct(const Jacon_StructDescriptor* descriptor, void* value);
+
+typedef struct {
+    // Escaped ,"name": of the field, the first field skips the comma
+    const char* key;
+    size_t key_size;
+    // Encoder entry of object fields and arrays of objects
+    size_t nested;
+} Jacon_EncodedField;
+
+typedef struct {
+    const Jacon_StructDescriptor* descriptor;
+    Jacon_EncodedField* fields;
+    char* keys;
+} Jacon_EncoderEntry;
+
+/**
+ * Every descriptor reachable from the compiled one, with its keys ready to be copied.
+ * Entry 0 is the compiled descriptor.
+ */
+typedef struct {
+    Jacon_EncoderEntry* entries;
+    size_t entry_count;
+} Jacon_StructEncoder;
+
+/**
+ * Prepare the serialization of structs described by descriptor, done once.
+ * Recursive descriptors are supported.
+ */
+Jacon_Error
+Jacon_compile_encoder(Jacon_StructEncoder* encoder, const Jacon_StructDescriptor* descriptor);
+
+void
+Jacon_free_encoder(Jacon_StructEncoder* encoder);
+
+/**
+ * Append the compact Json of a struct to out, no node is built.
+ * NULL strings are written as null, non finite numbers too.
+ */
+Jacon_Error
+Jacon_serialize_struct(const Jacon_StructEncoder* encoder, const void* value, Jacon_StringBuilder* out);
+
+#ifndef JACON_PARALLEL_MIN_SIZE
+#define JACON_PARALLEL_MIN_SIZE (1 << 20)
+#endif
+
+/**
+ * Parse a Json string input whose root is a large array on several threads.
+ * A structural pre-scan splits the elements in chunks on depth 1 commas,
+ * chunks are parsed in parallel then stitched back in order under the root.
+ * Any other input, or one smaller than JACON_PARALLEL_MIN_SIZE, goes through Jacon_deserialize.
+ * thread_count 0 uses every online core.
+ */
+Jacon_Error
+Jacon_deserialize_parallel(Jacon_content* content, const char* str, size_t thread_count);
+
+#ifndef JACON_NDJSON_DEFAULT_BATCH_SIZE
+#define JACON_NDJSON_DEFAULT_BATCH_SIZE (1 << 20)
+#endif
+
+/**
+ * Called for every NDJSON record, never from two threads at once.
+ * offset is the position of the record in the input, status its parse result.
+ * The content is freed once the callback returns.
+ * Returning anything but JACON_OK stops the ingestion with that error.
+ */
+typedef Jacon_Error (*Jacon_NdjsonCallback)(void* user_data, size_t offset,
+    Jacon_Error status, Jacon_content* content);
+
+typedef struct {
+    // Worker threads, 0 uses every online core
+    size_t thread_count;
+    // Input bytes handed to a worker at once, 0 uses JACON_NDJSON_DEFAULT_BATCH_SIZE
+    size_t batch_size;
+    // Deliver records as soon as they are parsed instead of in input order
+    bool unordered;
+    // Used by the workers and the records contents, NULL uses the caller's one
+    const Jacon_Allocator* allocator;
+} Jacon_NdjsonOptions;
+
+/**
+ * Parse newline delimited Json (one value per line) on a pool of threads.
+ * Blank lines are skipped, options may be NULL.
+ */
+Jacon_Error
+Jacon_deserialize_ndjson(const char* str, size_t len, const Jacon_NdjsonOptions* options,
+    Jacon_NdjsonCallback callback, void* user_data);
+
+/**
+ * Same as Jacon_deserialize_ndjson, the file is mapped in memory
+ */
+Jacon_Error
+Jacon_deserialize_ndjson_file(const char* path, const Jacon_NdjsonOptions* options,
+    Jacon_NdjsonCallback callback, void* user_data);
+
 /**
  * Parse a node into its Json representation
  */
@@ -267,14 +603,415 @@ Jacon_serialize(Jacon_Node* node);
 char *
 Jacon_serialize_unformatted(Jacon_Node* node);
 
+#define JACON_SNAPSHOT_MAGIC "JACONSNP"
+#define JACON_SNAPSHOT_VERSION 1
+#define JACON_SNAPSHOT_NONE UINT64_MAX
+
+/**
+ * Snapshot files are only made of offsets and indexes, they are used in place once mapped.
+ * Every offset is relative to the start of the file.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    // 1 as written by the saving machine, snapshots are not portable across endianness
+    uint32_t byte_order;
+    uint64_t size;
+    uint64_t node_count;
+    uint64_t nodes;
+    uint64_t strings;
+    uint64_t strings_size;
+    uint64_t index;
+    // Power of two
+    uint64_t index_capacity;
+} Jacon_SnapshotHeader;
+
+/**
+ * Nodes are stored breadth first so the childs of a node are contiguous
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    // Offset in the string blob, JACON_SNAPSHOT_NONE when unnamed
+    uint64_t name;
+    union {
+        uint64_t string;
+        int64_t int_val;
+        float float_val;
+        double double_val;
+        uint8_t bool_val;
+    } value;
+    uint64_t first_child;
+    uint64_t child_count;
+} Jacon_SnapshotNode;
+
+/**
+ * Open addressing path index, key is JACON_SNAPSHOT_NONE for empty buckets
+ */
+typedef struct {
+    uint64_t hash;
+    uint64_t key;
+    uint64_t node;
+} Jacon_SnapshotBucket;
+
+typedef struct {
+    const unsigned char* base;
+    size_t size;
+    const Jacon_SnapshotHeader* header;
+    const Jacon_SnapshotNode* nodes;
+    const char* strings;
+    const Jacon_SnapshotBucket* index;
+} Jacon_Snapshot;
+
+/**
+ * Write the content tree and its path index to a snapshot file
+ */
+Jacon_Error
+Jacon_save_snapshot(Jacon_content* content, const char* path);
+
+/**
+ * Map a snapshot file in memory, nothing is parsed nor relocated
+ */
+Jacon_Error
+Jacon_open_snapshot(Jacon_Snapshot* snapshot, const char* path);
+
+void
+Jacon_close_snapshot(Jacon_Snapshot* snapshot);
+
+/**
+ * Find a node by its path, same paths as Jacon_get_value_by_name.
+ * Returns NULL if not found
+ */
+const Jacon_SnapshotNode*
+Jacon_snapshot_find(const Jacon_Snapshot* snapshot, const char* name);
+
+const Jacon_SnapshotNode*
+Jacon_snapshot_root(const Jacon_Snapshot* snapshot);
+
+/**
+ * Returns NULL if index is out of bound
+ */
+const Jacon_SnapshotNode*
+Jacon_snapshot_child(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node, size_t index);
+
+/**
+ * Name of a node, NULL if unnamed
+ */
+const char*
+Jacon_snapshot_name(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node);
+
+/**
+ * Value of a string node, NULL for any other type
+ */
+const char*
+Jacon_snapshot_string(const Jacon_Snapshot* snapshot, const Jacon_SnapshotNode* node);
+
+/**
+ * Strings point inside the mapped file, they live until the snapshot is closed
+ */
+Jacon_Error
+Jacon_snapshot_get_string_by_name(const Jacon_Snapshot* snapshot, const char* name, const char** value);
+
+Jacon_Error
+Jacon_snapshot_get_int_by_name(const Jacon_Snapshot* snapshot, const char* name, int* value);
+
+Jacon_Error
+Jacon_snapshot_get_float_by_name(const Jacon_Snapshot* snapshot, const char* name, float* value);
+
+Jacon_Error
+Jacon_snapshot_get_double_by_name(const Jacon_Snapshot* snapshot, const char* name, double* value);
+
+Jacon_Error
+Jacon_snapshot_get_bool_by_name(const Jacon_Snapshot* snapshot, const char* name, bool* value);
+
+#ifndef JACON_WRITER_MAX_DEPTH
+#define JACON_WRITER_MAX_DEPTH 64
+#endif
+
+/**
+ * Incremental Json writer, output matches Jacon_serialize_unformatted.
+ * The first error is kept and returned by every later call.
+ * Nesting mistakes (key outside of an object, value without key, mismatched end)
+ * are only checked when NDEBUG is not defined.
+ */
+typedef struct {
+    Jacon_StringBuilder* out;
+    // Wraps the user buffer of a fixed size writer
+    Jacon_StringBuilder fixed_buffer;
+    bool fixed;
+    Jacon_Error error;
+    size_t depth;
+    bool need_comma;
+    bool after_key;
+    bool objects[JACON_WRITER_MAX_DEPTH];
+} Jacon_Writer;
+
 /**
- * Duplicate a node
+ * Write at the end of out, growing it as needed
+ */
+void
+Jacon_writer_init(Jacon_Writer* writer, Jacon_StringBuilder* out);
+
+/**
+ * Write in buffer, JACON_ERR_INVALID_SIZE once it is full.
+ * Output is NUL terminated, one byte of capacity is kept for it.
+ */
+void
+Jacon_writer_init_fixed(Jacon_Writer* writer, char* buffer, size_t capacity);
+
+Jacon_Error
+Jacon_writer_begin_object(Jacon_Writer* writer);
+
+Jacon_Error
+Jacon_writer_end_object(Jacon_Writer* writer);
+
+Jacon_Error
+Jacon_writer_begin_array(Jacon_Writer* writer);
+
+Jacon_Error
+Jacon_writer_end_array(Jacon_Writer* writer);
+
+Jacon_Error
+Jacon_writer_key(Jacon_Writer* writer, const char* key);
+
+/**
+ * str is escaped as needed
+ */
+Jacon_Error
+Jacon_writer_string(Jacon_Writer* writer, const char* str);
+
+Jacon_Error
+Jacon_writer_int(Jacon_Writer* writer, int64_t value);
+
+/**
+ * Non finite values are written as null
+ */
+Jacon_Error
+Jacon_writer_double(Jacon_Writer* writer, double value);
+
+Jacon_Error
+Jacon_writer_bool(Jacon_Writer* writer, bool value);
+
+Jacon_Error
+Jacon_writer_null(Jacon_Writer* writer);
+
+/**
+ * Check that a whole value was written, returns the first error met otherwise.
+ * size receives the output size, it may be NULL.
+ */
+Jacon_Error
+Jacon_writer_finish(Jacon_Writer* writer, size_t* size);
+
+/**
+ * Remove every whitespace outside of strings, len bytes of str are read.
+ * Strings and numbers are kept byte for byte, the input is not validated
+ * beyond string termination.
+ */
+Jacon_Error
+Jacon_minify(const char* str, size_t len, Jacon_StringBuilder* out);
+
+/**
+ * Reindent Json text with the same layout as Jacon_serialize,
+ * strings and numbers are kept byte for byte.
+ */
+Jacon_Error
+Jacon_prettify(const char* str, size_t len, Jacon_StringBuilder* out);
+
+#ifndef JACON_VALIDATE_MAX_DEPTH
+#define JACON_VALIDATE_MAX_DEPTH 1024
+#endif
+
+/**
+ * Check that the len bytes of str hold one Json value without building anything.
+ * Nothing is allocated unless more than 64 member names are open at once, they then move
+ * to a heap table (JACON_ERR_MEMORY_ALLOCATION if that fails). Nesting deeper than JACON_VALIDATE_MAX_DEPTH fails
+ * with JACON_ERR_DEPTH_LIMIT. error_offset (may be NULL) receives the offset
+ * of the faulty byte, or len on success.
+ * Duplicate member names fail with JACON_ERR_DUPLICATE_NAME as in Jacon_deserialize,
+ * names are looked up in a hash table so wide objects stay linear.
+ */
+Jacon_Error
+Jacon_validate(const char* str, size_t len, size_t* error_offset);
+
+typedef enum {
+    JACON_FORMAT_MSGPACK,
+    JACON_FORMAT_CBOR,
+} Jacon_BinaryFormat;
+
+/**
+ * Transcode Json text to MessagePack or CBOR in a single pass, no node is built.
+ * Output is appended to out, strings are unescaped.
+ * Integers keep their exact value up to 64 bits, other numbers become floats.
+ * Duplicate member names fail with JACON_ERR_DUPLICATE_NAME, as in Jacon_validate.
+ */
+Jacon_Error
+Jacon_json_to_binary(const char* str, Jacon_BinaryFormat format, Jacon_StringBuilder* out);
+
+/**
+ * Transcode a single MessagePack or CBOR item of size bytes to compact Json text appended to out.
+ * Map keys must be strings, byte strings and extensions are rejected.
+ * Non finite floats are written as null.
+ */
+Jacon_Error
+Jacon_binary_to_json(const char* data, size_t size, Jacon_BinaryFormat format, Jacon_StringBuilder* out);
+
+/**
+ * Deep copy a node, the copy shares nothing with the original.
  */
 Jacon_Node* 
 Jacon_duplicate_node(const Jacon_Node* node);
 
 /**
- * Free a node's content
+ * Copy a node, childs are shared with the original instead of copied.
+ * Only the returned node itself may be modified in place,
+ * go through Jacon_unshare_child or Jacon_unshare_path to modify anything below it.
+ * The parent of a shared node is not reliable, it is set again once the node is unshared.
+ */
+Jacon_Node*
+Jacon_share_node(const Jacon_Node* node);
+
+/**
+ * Make parent's child at index exclusively owned by parent, copying it (not its childs) if shared.
+ * parent must itself be writable. Returns the writable child, NULL if out of bound or on allocation failure.
+ */
+Jacon_Node*
+Jacon_unshare_child(Jacon_Node* parent, size_t index);
+
+/**
+ * Unshare every node on a dotted path of object members (ex: "user.address.city") below root,
+ * which must be writable. Returns the writable node at the end of the path, NULL if not found
+ * or on allocation failure.
+ */
+Jacon_Node*
+Jacon_unshare_path(Jacon_Node* root, const char* path);
+
+/**
+ * Append the RFC 6902 Json Patch turning from into to, as a compact Json array.
+ * Subtrees are hashed first so unchanged ones (equal hash, or shared by Jacon_share_node)
+ * are skipped without being walked. Numbers compare by value, object members in any order:
+ * raw numbers keep every digit written, the others compare in their shortest form.
+ * Only add, remove and replace operations are emitted.
+ */
+Jacon_Error
+Jacon_diff(const Jacon_Node* from, const Jacon_Node* to, Jacon_StringBuilder* out);
+
+/**
+ * Apply an RFC 6902 Json Patch to root in place, every operation is supported.
+ * The patch applies as a whole: on failure root is left untouched.
+ * A failed test operation returns JACON_ERR_PATCH_TEST_FAILED.
+ * A content's path index is not updated, patch a content through Jacon_content_apply_patch.
+ */
+Jacon_Error
+Jacon_apply_patch(Jacon_Node* root, const char* patch);
+
+/**
+ * Jacon_apply_patch on the root of content, then rebuild its path index.
+ * On failure both the tree and the index are left untouched.
+ */
+Jacon_Error
+Jacon_content_apply_patch(Jacon_content* content, const char* patch);
+
+/**
+ * Apply patch onto target as an RFC 7386 Json Merge Patch, in place.
+ * Patch nodes are moved into target rather than copied, patch is left empty.
+ * The path index of target is updated for the merged members only.
+ * Both contents must use the same allocator, JACON_ERR_ALLOCATOR_MISMATCH otherwise.
+ */
+Jacon_Error
+Jacon_merge_patch(Jacon_content* target, Jacon_content* patch);
+
+/**
+ * Append child to the object or array at the dotted path of content (NULL or "" for the root).
+ * The path index is updated for the new paths only, content takes ownership of child.
+ * Nodes given to a content must come from its allocator, the content frees them with it.
+ */
+Jacon_Error
+Jacon_content_append_child(Jacon_content* content, const char* path, Jacon_Node* child);
+
+/**
+ * Replace the member name of the object at the dotted path of content, keeping the path index in sync.
+ * new must come from the allocator of content.
+ */
+Jacon_Error
+Jacon_content_replace_child(Jacon_content* content, const char* path, const char* name, Jacon_Node* new);
+
+/**
+ * Remove the member name of the object at the dotted path of content, keeping the path index in sync.
+ */
+Jacon_Error
+Jacon_content_remove_child_by_name(Jacon_content* content, const char* path, const char* name);
+
+typedef enum {
+    JACON_BATCH_APPEND,
+    JACON_BATCH_REPLACE,
+    JACON_BATCH_REMOVE,
+} Jacon_BatchOperationType;
+
+typedef struct {
+    Jacon_BatchOperationType type;
+    // Dotted path of the parent, "" for the root
+    char* path;
+    // Member replaced or removed, NULL for appends
+    char* name;
+    // Appended or replacing node, owned by the batch until it is applied.
+    // It must come from the allocator of the tree the batch is applied to.
+    Jacon_Node* node;
+} Jacon_BatchOperation;
+
+/**
+ * Mutations recorded to be applied together, zero initialized.
+ * Applying them compacts each changed childs array once.
+ */
+typedef struct {
+    Jacon_BatchOperation* operations;
+    size_t count;
+    size_t capacity;
+} Jacon_Batch;
+
+/**
+ * Record appending child to the object or array at the dotted path (NULL or "" for the root)
+ */
+Jacon_Error
+Jacon_batch_append(Jacon_Batch* batch, const char* path, Jacon_Node* child);
+
+/**
+ * Record replacing the member name of the object at the dotted path, new keeps its own name
+ * as with Jacon_replace_child
+ */
+Jacon_Error
+Jacon_batch_replace(Jacon_Batch* batch, const char* path, const char* name, Jacon_Node* new);
+
+/**
+ * Record removing the member name of the object at the dotted path
+ */
+Jacon_Error
+Jacon_batch_remove(Jacon_Batch* batch, const char* path, const char* name);
+
+/**
+ * Apply the recorded operations below root, in order, as one transaction.
+ * An operation below a member replaced or removed by an earlier one fails with JACON_ERR_KEY_NOT_FOUND.
+ * On failure (missing path or member, allocation) root is left unchanged and the batch kept.
+ * On success the batch is emptied and its nodes belong to root.
+ */
+Jacon_Error
+Jacon_batch_apply(Jacon_Node* root, Jacon_Batch* batch);
+
+/**
+ * Jacon_batch_apply on the content root, the path index is updated for the changed members only.
+ * On failure the path index is left unchanged as well.
+ */
+Jacon_Error
+Jacon_batch_apply_content(Jacon_content* content, Jacon_Batch* batch);
+
+/**
+ * Free a batch and the nodes of its operations not applied yet,
+ * with the allocator of the calling thread
+ */
+void
+Jacon_batch_free(Jacon_Batch* batch);
+
+/**
+ * Free a node's content, a shared node only loses a reference
  */
 void
 Jacon_free_node(Jacon_Node* node);
@@ -282,46 +1019,59 @@ Jacon_free_node(Jacon_Node* node);
 Jacon_Error
 Jacon_init_content(Jacon_content* content);
 
+/**
+ * Initialize a content whose allocations all go through allocator
+ */
+Jacon_Error
+Jacon_init_content_with_allocator(Jacon_content* content, const Jacon_Allocator* allocator);
+
 Jacon_Error
 Jacon_free_content(Jacon_content* content);
 
+/**
+ * Release memory handed out by content, such as the strings of its getters,
+ * with the allocator of the content
+ */
+void
+Jacon_content_free(Jacon_content* content, void* ptr);
+
 // Used to create a named node
 // Please use these if you plan to add the node to an object
 #define Jacon_string_prop(node_name, node_value) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_STRING , \
-    .value.string_val = strdup(node_value) }
+    .value.string_val = Jacon_strdup(node_value) }
 
 #define Jacon_int_prop(node_name, node_value) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_INT , \
     .value.int_val = node_value }
 
 #define Jacon_float_prop(node_name, node_value) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_FLOAT , \
     .value.float_val = node_value }
 
 #define Jacon_double_prop(node_name, node_value) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_DOUBLE , \
     .value.double_val = node_value }
 
 #define Jacon_boolean_prop(node_name, node_value) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_BOOLEAN , \
     .value.bool_val = node_value }
 
 #define Jacon_null_prop(node_name) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_NULL }
 
 #define Jacon_array_prop(node_name) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_ARRAY }
 
 #define Jacon_object_prop(node_name) (Jacon_Node){ \
-    .name = strdup(node_name), \
+    .name = Jacon_strdup(node_name), \
     .type = JACON_VALUE_OBJECT }
 
 // Used to create a single value node
@@ -329,7 +1079,7 @@ Jacon_free_content(Jacon_content* content);
 // Please use Jacon_type_prop for that
 #define Jacon_string(node_value) (Jacon_Node){ \
     .type = JACON_VALUE_STRING , \
-    .value.string_val = strdup(node_value) }
+    .value.string_val = Jacon_strdup(node_value) }
 
 #define Jacon_int(node_value) (Jacon_Node){ \
     .type = JACON_VALUE_INT , \
@@ -370,12 +1120,40 @@ Jacon_get_double_by_name(Jacon_content* content, const char* name, double* value
 Jacon_Error
 Jacon_get_bool_by_name(Jacon_content* content, const char* name, bool* value);
 
+/**
+ * Get a string without copying it, the view lives as long as the content.
+ * length may be NULL
+ */
+Jacon_Error
+Jacon_get_string_view_by_name(Jacon_content* content, const char* name, const char** value, size_t* length);
+
+/**
+ * Copy a numeric array into a caller buffer, converting every element.
+ * count receives the array size, JACON_ERR_INVALID_SIZE is returned
+ * without copying anything if capacity is too small.
+ * Converting to int64_t fails on non integral values.
+ */
+Jacon_Error
+Jacon_get_double_array_by_name(Jacon_content* content, const char* name, double* values, size_t capacity, size_t* count);
+
+Jacon_Error
+Jacon_get_float_array_by_name(Jacon_content* content, const char* name, float* values, size_t capacity, size_t* count);
+
+Jacon_Error
+Jacon_get_int64_array_by_name(Jacon_content* content, const char* name, int64_t* values, size_t capacity, size_t* count);
+
 /**
  * Get single string value
  */
 Jacon_Error
 Jacon_get_string(Jacon_content* content, char** value);
 
+/**
+ * Get single string value without copying it, length may be NULL
+ */
+Jacon_Error
+Jacon_get_string_view(Jacon_content* content, const char** value, size_t* length);
+
 /**
  * Get single int value
  */
@@ -400,6 +1178,29 @@ Jacon_get_double(Jacon_content* content, double* value);
 Jacon_Error
 Jacon_get_bool(Jacon_content* content, bool* value);
 
+#define JACON_LOOKUP_WINDOW 8
+
+/**
+ * One entry of a batch lookup.
+ * value points to the variable matching type: int, float, double or bool,
+ * const char* for strings and const Jacon_Node* for arrays, it may be NULL for null.
+ * Strings and nodes are borrowed from the content, they live as long as it does.
+ */
+typedef struct {
+    const char* path;
+    Jacon_ValueType type;
+    void* value;
+    Jacon_Error status;
+} Jacon_Lookup;
+
+/**
+ * Resolve every lookup in one pass, each one gets its own status.
+ * Numbers are converted between int, float and double.
+ * Returns the first failing status, JACON_OK if all lookups succeeded
+ */
+Jacon_Error
+Jacon_get_batch(Jacon_content* content, Jacon_Lookup* lookups, size_t count);
+
 bool
 Jacon_exist_by_name(Jacon_content* content, const char* name, Jacon_ValueType type);
 
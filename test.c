@@ -2,24 +2,1309 @@
 #include "jacon.h"
 #include "stdio.h"
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
 void expect(bool (*tested_func)(), bool expected, const char* tested_func_name);
 
 #define EXPECT(tested_func, expected) expect(tested_func, expected, #tested_func)
 
+static int failed_tests = 0;
+
 void
 expect(bool (*tested_func)(), bool expected, const char* tested_func_name)
 {
     bool result = tested_func();
     if (result != expected) {
         printf("Test %s failed: expected %d, got %d\n", tested_func_name, expected, result);
+        failed_tests++;
     } else {
         printf("Test %s passed\n", tested_func_name);
     }
 }
 
+bool
+test_deserialize_paths()
+{
+    const char* json = "{\"user\": {\"id\": 7, \"name\": \"jo\", \"tags\": [1, {\"a\": \"]\"}]},"
+        "\"event\": {\"type\": \"click\", \"payload\": {\"x\": [[], {}]}}, \"other\": \"\\\"}\"}";
+    const char* paths[] = { "user.id", "event.type" };
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+
+    bool ok = Jacon_deserialize_paths(&content, json, paths, 2) == JACON_OK;
+    int id = 0;
+    char* type = NULL;
+    char* name = NULL;
+    ok = ok && Jacon_get_int_by_name(&content, "user.id", &id) == JACON_OK && id == 7;
+    ok = ok && Jacon_get_string_by_name(&content, "event.type", &type) == JACON_OK
+        && strcmp(type, "click") == 0;
+    ok = ok && Jacon_get_string_by_name(&content, "user.name", &name) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && content.root->child_count == 2;
+    free(type);
+    Jacon_free_content(&content);
+    return ok;
+}
+
+typedef struct {
+    int expected;
+    int errors;
+    bool ordered;
+} Ndjson_state;
+
+Jacon_Error
+ndjson_callback(void* user_data, size_t offset, Jacon_Error status, Jacon_content* content)
+{
+    (void)offset;
+    Ndjson_state* state = user_data;
+    int id = -1;
+    if (status != JACON_OK) {
+        state->errors++;
+        return JACON_OK;
+    }
+    if (Jacon_get_int_by_name(content, "id", &id) != JACON_OK) return JACON_ERR_KEY_NOT_FOUND;
+    if (state->ordered && id != state->expected) return JACON_ERR_INVALID_VALUE_TYPE;
+    state->expected++;
+    return JACON_OK;
+}
+
+bool
+test_deserialize_ndjson()
+{
+    Jacon_StringBuilder input = {0};
+    for (int i = 0; i < 200; i++) {
+        Jacon_str_append_null(&input, Jacon_tmp_str("{\"id\": %d, \"v\": [1, 2]}\r\n", i));
+        if (i == 100) Jacon_str_append_null(&input, "\n{\"broken\": }\n");
+    }
+    Jacon_NdjsonOptions options = { .thread_count = 4, .batch_size = 64 };
+    Ndjson_state state = { .ordered = true };
+    bool ok = Jacon_deserialize_ndjson(input.string, input.count, &options,
+        ndjson_callback, &state) == JACON_OK;
+    ok = ok && state.expected == 200 && state.errors == 1;
+
+    options.unordered = true;
+    state = (Ndjson_state){0};
+    ok = ok && Jacon_deserialize_ndjson(input.string, input.count, &options,
+        ndjson_callback, &state) == JACON_OK;
+    ok = ok && state.expected == 200 && state.errors == 1;
+    Jacon_str_free(&input);
+    return ok;
+}
+
+bool
+test_deserialize_parallel()
+{
+    const int element_count = 40000;
+    size_t size = 0;
+    char* input = malloc(element_count * 96);
+    size += sprintf(input, "[");
+    for (int i = 0; i < element_count; i++) {
+        size += sprintf(input + size, "%s{\"id\": %d, \"name\": \"a,]\\\"b\", \"v\": [%d, [true, null]]}",
+            i == 0 ? "" : ", ", i, i);
+    }
+    sprintf(input + size, "]");
+
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize_parallel(&content, input, 4) == JACON_OK;
+    ok = ok && content.root->child_count == (size_t)element_count;
+    for (int i = 0; ok && i < element_count; i += 997) {
+        Jacon_Node* element = content.root->childs[i];
+        Jacon_Node* id = Jacon_get_child_by_name(element, "id");
+        Jacon_Node* name = Jacon_get_child_by_name(element, "name");
+        ok = element->parent == content.root && id != NULL && id->value.int_val == i
+            && name != NULL && strcmp(name->value.string_val, "a,]\"b") == 0;
+    }
+    Jacon_free_content(&content);
+
+    // Empty element in the middle of the input
+    char* comma = strstr(input + size / 2, ", ");
+    comma[1] = ',';
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize_parallel(&content, input, 4) == JACON_ERR_INVALID_JSON;
+    Jacon_free_content(&content);
+    comma[1] = ' ';
+
+    // Root array closed by a brace
+    input[size] = '}';
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize_parallel(&content, input, 4) == JACON_ERR_INVALID_JSON;
+    Jacon_free_content(&content);
+    input[size] = ']';
+
+    // Inner array closed by a brace
+    char* inner = strstr(input + size / 2, "null]]");
+    inner[5] = '}';
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize_parallel(&content, input, 4) == JACON_ERR_INVALID_JSON;
+    Jacon_free_content(&content);
+    inner[5] = ']';
+
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize_parallel(&content, input, 4) == JACON_OK
+        && content.root->child_count == (size_t)element_count;
+    Jacon_free_content(&content);
+    free(input);
+    return ok;
+}
+
+typedef struct {
+    size_t allocations;
+    size_t live;
+    // Allocations fail once this many were made, 0 never fails
+    size_t limit;
+} Counting_allocator;
+
+void*
+counting_allocate(void* ctx, size_t size)
+{
+    Counting_allocator* counter = ctx;
+    if (counter->limit != 0 && counter->allocations >= counter->limit) return NULL;
+    counter->allocations++;
+    counter->live++;
+    return malloc(size);
+}
+
+void*
+counting_reallocate(void* ctx, void* ptr, size_t size)
+{
+    Counting_allocator* counter = ctx;
+    if (ptr == NULL) return counting_allocate(ctx, size);
+    counter->allocations++;
+    return realloc(ptr, size);
+}
+
+void
+counting_deallocate(void* ctx, void* ptr)
+{
+    Counting_allocator* counter = ctx;
+    counter->live--;
+    free(ptr);
+}
+
+bool
+test_content_allocator()
+{
+    Counting_allocator counter = {0};
+    Jacon_Allocator allocator = {
+        .allocate = counting_allocate,
+        .reallocate = counting_reallocate,
+        .deallocate = counting_deallocate,
+        .ctx = &counter,
+    };
+    Jacon_content content = {0};
+    char* name = NULL;
+    bool ok = Jacon_init_content_with_allocator(&content, &allocator) == JACON_OK;
+    ok = ok && Jacon_deserialize(&content, "{\"a\": {\"b\": [1, \"x\"]}, \"name\": \"jo\"}") == JACON_OK;
+    ok = ok && Jacon_get_string_by_name(&content, "name", &name) == JACON_OK;
+    size_t after_parse = counter.allocations;
+    // Nodes cannot move between contents using different allocators
+    Jacon_content other = {0};
+    Jacon_init_content(&other);
+    ok = ok && Jacon_merge_patch(&content, &other) == JACON_ERR_ALLOCATOR_MISMATCH;
+    Jacon_free_content(&other);
+    Jacon_content_free(&content, name);
+    Jacon_free_content(&content);
+    ok = ok && after_parse > 0 && counter.live == 0;
+
+    // Global allocator
+    counter = (Counting_allocator){0};
+    Jacon_set_allocator(&allocator);
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "[1, 2, {\"c\": null}]") == JACON_OK;
+    Jacon_free_content(&content);
+
+    // Failing to copy a shared member on the path is not a missing member
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "{\"a\": {\"b\": {}}}") == JACON_OK;
+    Jacon_Node* shared = ok ? Jacon_share_node(content.root) : NULL;
+    Jacon_Node* child = ok ? Jacon_duplicate_node(content.root->childs[0]->childs[0]) : NULL;
+    // The path prefix is allocated first, then the copy of a
+    counter.limit = counter.allocations + 1;
+    ok = ok && Jacon_content_append_child(&content, "a.b", child) == JACON_ERR_MEMORY_ALLOCATION;
+    counter.limit = 0;
+    ok = ok && Jacon_content_append_child(&content, "a.b", child) == JACON_OK;
+    if (shared != NULL) Jacon_free_node(shared);
+    Jacon_free_content(&content);
+    Jacon_set_allocator(NULL);
+    return ok && counter.allocations > 0 && counter.live == 0;
+}
+
+bool
+test_get_batch()
+{
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, "{\"id\": 7, \"score\": 2.5, \"user\": "
+        "{\"name\": \"jo\", \"admin\": true, \"tags\": [1, 2], \"nick\": null}}") == JACON_OK;
+    int id = 0;
+    double score = 0;
+    double id_as_double = 0;
+    const char* name = NULL;
+    bool admin = false;
+    const Jacon_Node* tags = NULL;
+    int missing = 0;
+    Jacon_Lookup lookups[] = {
+        { "id", JACON_VALUE_INT, &id, JACON_OK },
+        { "score", JACON_VALUE_DOUBLE, &score, JACON_OK },
+        { "id", JACON_VALUE_DOUBLE, &id_as_double, JACON_OK },
+        { "user.name", JACON_VALUE_STRING, &name, JACON_OK },
+        { "user.admin", JACON_VALUE_BOOLEAN, &admin, JACON_OK },
+        { "user.tags", JACON_VALUE_ARRAY, &tags, JACON_OK },
+        { "user.nick", JACON_VALUE_NULL, NULL, JACON_OK },
+        { "user.missing", JACON_VALUE_INT, &missing, JACON_OK },
+        { "user.name", JACON_VALUE_INT, &missing, JACON_OK },
+        { "score", JACON_VALUE_INT, &missing, JACON_OK },
+    };
+    ok = ok && Jacon_get_batch(&content, lookups, 10) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && id == 7 && score == 2.5 && id_as_double == 7.0 && strcmp(name, "jo") == 0
+        && admin && tags != NULL && tags->child_count == 2;
+    for (size_t i = 0; i < 7; i++) ok = ok && lookups[i].status == JACON_OK;
+    ok = ok && lookups[7].status == JACON_ERR_KEY_NOT_FOUND
+        && lookups[8].status == JACON_ERR_INVALID_VALUE_TYPE
+        && lookups[9].status == JACON_ERR_INVALID_VALUE_TYPE && missing == 0;
+    ok = ok && Jacon_get_batch(&content, lookups, 7) == JACON_OK;
+    Jacon_free_content(&content);
+    return ok;
+}
+
+bool
+test_get_string_view()
+{
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    const char* route = NULL;
+    size_t length = 0;
+    bool ok = Jacon_deserialize(&content, "{\"route\": \"/users\", \"id\": 3}") == JACON_OK;
+    ok = ok && Jacon_get_string_view_by_name(&content, "route", &route, &length) == JACON_OK;
+    ok = ok && length == 6 && strcmp(route, "/users") == 0;
+    ok = ok && Jacon_get_string_view_by_name(&content, "id", &route, NULL) == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_get_string_view_by_name(&content, "nope", &route, NULL) == JACON_ERR_KEY_NOT_FOUND;
+    Jacon_free_content(&content);
+
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "\"single\"") == JACON_OK;
+    ok = ok && Jacon_get_string_view(&content, &route, &length) == JACON_OK
+        && length == 6 && strcmp(route, "single") == 0;
+    Jacon_free_content(&content);
+    return ok;
+}
+
+bool
+test_get_number_arrays()
+{
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, "{\"ints\": [1, -2, 3], \"mixed\": [1, 2.5, 3],"
+        " \"bad\": [1, \"x\"], \"empty\": []}") == JACON_OK;
+    double doubles[3] = {0};
+    float floats[3] = {0};
+    int64_t ints[3] = {0};
+    size_t count = 0;
+    ok = ok && Jacon_get_double_array_by_name(&content, "mixed", doubles, 3, &count) == JACON_OK
+        && count == 3 && doubles[0] == 1.0 && doubles[1] == 2.5 && doubles[2] == 3.0;
+    ok = ok && Jacon_get_float_array_by_name(&content, "ints", floats, 3, &count) == JACON_OK
+        && floats[1] == -2.0f;
+    ok = ok && Jacon_get_int64_array_by_name(&content, "ints", ints, 3, &count) == JACON_OK
+        && ints[0] == 1 && ints[1] == -2 && ints[2] == 3;
+    ok = ok && Jacon_get_int64_array_by_name(&content, "mixed", ints, 3, &count) == JACON_ERR_INVALID_VALUE_TYPE
+        && ints[1] == -2;
+    ok = ok && Jacon_get_double_array_by_name(&content, "ints", NULL, 0, &count) == JACON_ERR_INVALID_SIZE
+        && count == 3;
+    ok = ok && Jacon_get_double_array_by_name(&content, "bad", doubles, 3, &count) == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_get_double_array_by_name(&content, "empty", NULL, 0, &count) == JACON_OK && count == 0;
+    Jacon_free_content(&content);
+    return ok;
+}
+
+bool
+test_binary_transcoding()
+{
+    const char* json = " {\"a\": [1, -1, 300, -200, 1.5, 0.1, \"x\\n\\u00e9\\ud83d\\ude00\", true, null, {}],"
+        " \"big\": 18446744073709551615, \"neg\": -9223372036854775808, \"b\": \"\"} ";
+    const char* expected = "{\"a\":[1,-1,300,-200,1.5,0.1,\"x\\n\xc3\xa9\xf0\x9f\x98\x80\",true,null,{}],"
+        "\"big\":18446744073709551615,\"neg\":-9223372036854775808,\"b\":\"\"}";
+    bool ok = true;
+    for (int format = JACON_FORMAT_MSGPACK; format <= JACON_FORMAT_CBOR; format++) {
+        Jacon_StringBuilder binary = {0};
+        Jacon_StringBuilder text = {0};
+        ok = ok && Jacon_json_to_binary(json, format, &binary) == JACON_OK;
+        ok = ok && Jacon_binary_to_json(binary.string, binary.count, format, &text) == JACON_OK;
+        ok = ok && strcmp(text.string, expected) == 0;
+        ok = ok && Jacon_json_to_binary("[1,]", format, &binary) == JACON_ERR_INVALID_JSON;
+        ok = ok && Jacon_json_to_binary("{\"a\" 1}", format, &binary) == JACON_ERR_INVALID_JSON;
+        ok = ok && Jacon_binary_to_json(binary.string, binary.count - 1, format, &text) == JACON_ERR_INVALID_BINARY;
+        // Duplicate names are rejected once unescaped, the same name in another object is fine
+        size_t count = binary.count;
+        ok = ok && Jacon_json_to_binary("{\"a\": 1, \"a\": 2}", format, &binary) == JACON_ERR_DUPLICATE_NAME;
+        ok = ok && Jacon_json_to_binary("{\"\\u0061\": 1, \"b\": {}, \"a\": 2}", format, &binary) == JACON_ERR_DUPLICATE_NAME;
+        ok = ok && binary.count == count;
+        ok = ok && Jacon_json_to_binary("[{\"a\": 1}, {\"a\": {\"a\": 2}, \"b\": 3}]", format, &binary) == JACON_OK;
+        Jacon_str_free(&binary);
+        Jacon_str_free(&text);
+    }
+
+    Jacon_StringBuilder binary = {0};
+    ok = ok && Jacon_json_to_binary("[1, -33, 256]", JACON_FORMAT_MSGPACK, &binary) == JACON_OK;
+    ok = ok && binary.count == 7 && memcmp(binary.string, "\x93\x01\xd0\xdf\xcd\x01\x00", 7) == 0;
+    binary.count = 0;
+    ok = ok && Jacon_json_to_binary("[1, -33, 256]", JACON_FORMAT_CBOR, &binary) == JACON_OK;
+    ok = ok && binary.count == 8 && memcmp(binary.string, "\x9f\x01\x38\x20\x19\x01\x00\xff", 8) == 0;
+    binary.count = 0;
+    // 20 elements need an array16 header
+    ok = ok && Jacon_json_to_binary("[[0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5,6,7,8,9]]", JACON_FORMAT_MSGPACK, &binary) == JACON_OK;
+    ok = ok && binary.count == 24 && memcmp(binary.string, "\x91\xdc\x00\x14\x00\x01", 6) == 0;
+    Jacon_str_free(&binary);
+
+    Jacon_StringBuilder text = {0};
+    ok = ok && Jacon_binary_to_json("\xa2\x61\x61\xf9\x3c\x00\x61\x62\x7f\x61\x78\x61\x79\xff", 14,
+        JACON_FORMAT_CBOR, &text) == JACON_OK && strcmp(text.string, "{\"a\":1,\"b\":\"xy\"}") == 0;
+    text.count = 0;
+    ok = ok && Jacon_binary_to_json("\x81\x01\x02", 3, JACON_FORMAT_MSGPACK, &text) == JACON_ERR_INVALID_VALUE_TYPE;
+    Jacon_str_free(&text);
+    return ok;
+}
+
+bool
+test_snapshot()
+{
+    const char* path = "/tmp/jacon_test.snapshot";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, "{\"user\": {\"id\": 7, \"name\": \"jo\", \"admin\": true},"
+        " \"ratio\": 0.5, \"precise\": 0.7, \"list\": [1, {\"x\": null}], \"empty\": {}}") == JACON_OK;
+    ok = ok && Jacon_save_snapshot(&content, path) == JACON_OK;
+    Jacon_free_content(&content);
+
+    Jacon_Snapshot snapshot = {0};
+    int id = 0;
+    const char* name = NULL;
+    bool admin = false;
+    float ratio = 0;
+    double precise = 0;
+    ok = ok && Jacon_open_snapshot(&snapshot, path) == JACON_OK;
+    ok = ok && Jacon_snapshot_get_int_by_name(&snapshot, "user.id", &id) == JACON_OK && id == 7;
+    ok = ok && Jacon_snapshot_get_string_by_name(&snapshot, "user.name", &name) == JACON_OK
+        && strcmp(name, "jo") == 0;
+    ok = ok && Jacon_snapshot_get_bool_by_name(&snapshot, "user.admin", &admin) == JACON_OK && admin;
+    ok = ok && Jacon_snapshot_get_float_by_name(&snapshot, "ratio", &ratio) == JACON_OK && ratio == 0.5f;
+    ok = ok && Jacon_snapshot_get_double_by_name(&snapshot, "precise", &precise) == JACON_OK && precise == 0.7;
+    ok = ok && Jacon_snapshot_get_int_by_name(&snapshot, "user.name", &id) == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_snapshot_get_int_by_name(&snapshot, "user", &id) == JACON_ERR_KEY_NOT_FOUND;
+
+    const Jacon_SnapshotNode* list = Jacon_snapshot_find(&snapshot, "list");
+    const Jacon_SnapshotNode* second = Jacon_snapshot_child(&snapshot, list, 1);
+    const Jacon_SnapshotNode* x = Jacon_snapshot_child(&snapshot, second, 0);
+    ok = ok && list != NULL && list->child_count == 2 && second != NULL
+        && second->type == JACON_VALUE_OBJECT && x != NULL && x->type == JACON_VALUE_NULL
+        && strcmp(Jacon_snapshot_name(&snapshot, x), "x") == 0
+        && Jacon_snapshot_child(&snapshot, list, 2) == NULL;
+    Jacon_close_snapshot(&snapshot);
+
+    // Members added below the content index are still saved
+    Jacon_StringBuilder patch = {0};
+    Jacon_str_append_null(&patch, "[");
+    for (int i = 0; i < 20; i++) {
+        Jacon_str_append_null(&patch, Jacon_tmp_str("%s{\"op\": \"add\", \"path\": \"/m%d\", \"value\": %d}",
+            i == 0 ? "" : ", ", i, i));
+    }
+    Jacon_str_append_null(&patch, "]");
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "{\"k\": 0}") == JACON_OK;
+    ok = ok && Jacon_apply_patch(content.root, patch.string) == JACON_OK;
+    ok = ok && Jacon_save_snapshot(&content, path) == JACON_OK;
+    Jacon_free_content(&content);
+    Jacon_str_free(&patch);
+    ok = ok && Jacon_open_snapshot(&snapshot, path) == JACON_OK;
+    ok = ok && Jacon_snapshot_get_int_by_name(&snapshot, "m19", &id) == JACON_OK && id == 19;
+    Jacon_close_snapshot(&snapshot);
+
+    // Anything but a snapshot is refused
+    FILE* file = fopen(path, "r+b");
+    ok = ok && file != NULL && fwrite("NOTASNAP", 1, 8, file) == 8;
+    if (file != NULL) fclose(file);
+    ok = ok && Jacon_open_snapshot(&snapshot, path) == JACON_ERR_INVALID_BINARY;
+    remove(path);
+    return ok;
+}
+
+typedef struct {
+    int x;
+    int y;
+} Point;
+
+typedef struct {
+    char* name;
+    int64_t id;
+    double score;
+    bool active;
+    Point origin;
+    Point* path;
+    size_t path_count;
+    char** tags;
+    size_t tag_count;
+} Shape;
+
+static const Jacon_Field point_fields[] = {
+    JACON_FIELD(Point, x, JACON_FIELD_INT),
+    JACON_FIELD(Point, y, JACON_FIELD_INT),
+};
+static const Jacon_StructDescriptor point_descriptor = JACON_DESCRIPTOR(Point, point_fields);
+
+static const Jacon_Field shape_fields[] = {
+    JACON_FIELD(Shape, name, JACON_FIELD_STRING),
+    JACON_FIELD(Shape, id, JACON_FIELD_INT64),
+    JACON_FIELD(Shape, score, JACON_FIELD_DOUBLE),
+    JACON_FIELD_NAMED(Shape, active, "is_active", JACON_FIELD_BOOL),
+    JACON_OBJECT_FIELD(Shape, origin, &point_descriptor),
+    JACON_ARRAY_FIELD(Shape, path, path_count, JACON_FIELD_OBJECT, &point_descriptor),
+    JACON_ARRAY_FIELD(Shape, tags, tag_count, JACON_FIELD_STRING, NULL),
+};
+static const Jacon_StructDescriptor shape_descriptor = JACON_DESCRIPTOR(Shape, shape_fields);
+
+bool
+test_deserialize_struct()
+{
+    Shape shape = {0};
+    bool ok = Jacon_deserialize_struct("{\"name\": \"tri\\u00e9\", \"unknown\": {\"a\": [1, \"]\"]},"
+        " \"id\": 9007199254740993, \"score\": 1.25, \"is_active\": true, \"origin\": {\"y\": -2, \"x\": 1},"
+        " \"path\": [{\"x\": 1, \"y\": 2}, {\"x\": 3}, null], \"tags\": [\"a\", \"b\\\"c\"]}",
+        &shape_descriptor, &shape) == JACON_OK;
+    ok = ok && strcmp(shape.name, "tri\xc3\xa9") == 0 && shape.id == 9007199254740993LL
+        && shape.score == 1.25 && shape.active && shape.origin.x == 1 && shape.origin.y == -2;
+    ok = ok && shape.path_count == 3 && shape.path[0].y == 2 && shape.path[1].x == 3 && shape.path[1].y == 0
+        && shape.path[2].x == 0;
+    ok = ok && shape.tag_count == 2 && strcmp(shape.tags[1], "b\"c") == 0;
+    Jacon_free_struct(&shape_descriptor, &shape);
+    ok = ok && shape.name == NULL && shape.tags == NULL && shape.tag_count == 0;
+
+    // Everything allocated before the error is released
+    ok = ok && Jacon_deserialize_struct("{\"name\": \"x\", \"tags\": [\"a\", 1]}",
+        &shape_descriptor, &shape) == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && shape.name == NULL && shape.tags == NULL;
+    ok = ok && Jacon_deserialize_struct("{\"origin\": {\"x\": 1.5}}", &shape_descriptor, &shape)
+        == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_deserialize_struct("{\"name\": \"x\",}", &shape_descriptor, &shape) == JACON_ERR_INVALID_JSON;
+    return ok;
+}
+
+typedef struct Tree Tree;
+struct Tree {
+    int value;
+    Tree* childs;
+    size_t child_count;
+};
+
+static const Jacon_StructDescriptor tree_descriptor;
+static const Jacon_Field tree_fields[] = {
+    JACON_FIELD(Tree, value, JACON_FIELD_INT),
+    JACON_ARRAY_FIELD(Tree, childs, child_count, JACON_FIELD_OBJECT, &tree_descriptor),
+};
+static const Jacon_StructDescriptor tree_descriptor = JACON_DESCRIPTOR(Tree, tree_fields);
+
+bool
+test_serialize_struct()
+{
+    Point path[] = { { 1, 2 }, { -3, 4 } };
+    char* tags[] = { "a", "q\"\n" };
+    Shape shape = {
+        .name = "tri", .id = -9007199254740993LL, .score = 0.1, .active = true,
+        .origin = { 5, 6 }, .path = path, .path_count = 2, .tags = tags, .tag_count = 2,
+    };
+    Jacon_StructEncoder encoder = {0};
+    Jacon_StringBuilder out = {0};
+    bool ok = Jacon_compile_encoder(&encoder, &shape_descriptor) == JACON_OK && encoder.entry_count == 2;
+    ok = ok && Jacon_serialize_struct(&encoder, &shape, &out) == JACON_OK;
+    ok = ok && strcmp(out.string, "{\"name\":\"tri\",\"id\":-9007199254740993,\"score\":0.1,\"is_active\":true,"
+        "\"origin\":{\"x\":5,\"y\":6},\"path\":[{\"x\":1,\"y\":2},{\"x\":-3,\"y\":4}],\"tags\":[\"a\",\"q\\\"\\n\"]}") == 0;
+
+    // Reading back what was written gives the same struct
+    Shape parsed = {0};
+    ok = ok && Jacon_deserialize_struct(out.string, &shape_descriptor, &parsed) == JACON_OK;
+    ok = ok && strcmp(parsed.tags[1], tags[1]) == 0 && parsed.score == 0.1 && parsed.path[1].x == -3;
+    Jacon_free_struct(&shape_descriptor, &parsed);
+    Jacon_free_encoder(&encoder);
+
+    Tree leaves[] = { { .value = 2 }, { .value = 3 } };
+    Tree root = { .value = 1, .childs = leaves, .child_count = 2 };
+    out.count = 0;
+    ok = ok && Jacon_compile_encoder(&encoder, &tree_descriptor) == JACON_OK && encoder.entry_count == 1;
+    ok = ok && Jacon_serialize_struct(&encoder, &root, &out) == JACON_OK;
+    ok = ok && strcmp(out.string, "{\"value\":1,\"childs\":[{\"value\":2,\"childs\":[]},{\"value\":3,\"childs\":[]}]}") == 0;
+    Jacon_free_encoder(&encoder);
+    Jacon_str_free(&out);
+    return ok;
+}
+
+bool
+test_writer()
+{
+    Jacon_StringBuilder out = {0};
+    Jacon_Writer writer;
+    Jacon_writer_init(&writer, &out);
+    Jacon_writer_begin_object(&writer);
+    Jacon_writer_key(&writer, "id");
+    Jacon_writer_int(&writer, -42);
+    Jacon_writer_key(&writer, "name");
+    Jacon_writer_string(&writer, "a\"b");
+    Jacon_writer_key(&writer, "ratio");
+    Jacon_writer_double(&writer, 0.7);
+    Jacon_writer_key(&writer, "list");
+    Jacon_writer_begin_array(&writer);
+    Jacon_writer_bool(&writer, true);
+    Jacon_writer_null(&writer);
+    Jacon_writer_begin_object(&writer);
+    Jacon_writer_end_object(&writer);
+    Jacon_writer_begin_array(&writer);
+    Jacon_writer_end_array(&writer);
+    Jacon_writer_end_array(&writer);
+    Jacon_writer_end_object(&writer);
+    size_t size = 0;
+    bool ok = Jacon_writer_finish(&writer, &size) == JACON_OK && size == out.count;
+
+    // Same output as the tree serializer
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, out.string) == JACON_OK;
+    char* expected = Jacon_serialize_unformatted(content.root);
+    ok = ok && expected != NULL && strcmp(expected, out.string) == 0;
+    Jacon_free(expected);
+    Jacon_free_content(&content);
+    Jacon_str_free(&out);
+
+    char buffer[16];
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_begin_array(&writer);
+    Jacon_writer_int(&writer, 1);
+    Jacon_writer_end_array(&writer);
+    ok = ok && Jacon_writer_finish(&writer, &size) == JACON_OK && size == 3 && strcmp(buffer, "[1]") == 0;
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_string(&writer, "does not fit in there");
+    ok = ok && Jacon_writer_finish(&writer, NULL) == JACON_ERR_INVALID_SIZE;
+
+#ifndef NDEBUG
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_begin_object(&writer);
+    ok = ok && Jacon_writer_int(&writer, 1) == JACON_ERR_INVALID_JSON;
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_begin_array(&writer);
+    ok = ok && Jacon_writer_end_object(&writer) == JACON_ERR_INVALID_JSON;
+#endif
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_begin_array(&writer);
+    ok = ok && Jacon_writer_finish(&writer, NULL) == JACON_ERR_INVALID_JSON;
+    return ok;
+}
+
+bool
+test_minify_prettify()
+{
+    const char* json = "{\"a\" : [1, {\"b\": [ ], \"c\" :{}}, [2,3]],\n\t\"d\": {\"e\": \"a long string with \\\" and \\\\\\\\ spaces \"},"
+        " \"n\": -1.50e+3}";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, json) == JACON_OK;
+    char* expected = Jacon_serialize(content.root);
+    Jacon_free_content(&content);
+
+    Jacon_StringBuilder pretty = {0};
+    Jacon_StringBuilder minified = {0};
+    // Numbers are kept as written, the serializer reformats them
+    char* number = strstr(expected, "-1500");
+    ok = ok && number != NULL && Jacon_prettify(json, strlen(json), &pretty) == JACON_OK;
+    ok = ok && strncmp(pretty.string, expected, number - expected) == 0
+        && strcmp(pretty.string + (number - expected), "-1.50e+3\n}") == 0;
+    ok = ok && Jacon_minify(pretty.string, pretty.count, &minified) == JACON_OK;
+    ok = ok && strcmp(minified.string, "{\"a\":[1,{\"b\":[],\"c\":{}},[2,3]],"
+        "\"d\":{\"e\":\"a long string with \\\" and \\\\\\\\ spaces \"},\"n\":-1.50e+3}") == 0;
+    Jacon_free(expected);
+
+    ok = ok && Jacon_minify("[\"unterminated \\\"]", 18, &minified) == JACON_ERR_CHAR_NOT_FOUND;
+    ok = ok && Jacon_prettify("[1}", 3, &pretty) == JACON_ERR_INVALID_JSON;
+    Jacon_str_free(&pretty);
+    Jacon_str_free(&minified);
+    return ok;
+}
+
+bool
+test_validate()
+{
+    size_t offset = 0;
+    const char* valid = " {\"a\": [1, -2.5e3, true, null, {}], \"b\": \"\\u00e9\\n\", \"c\": []} ";
+    bool ok = Jacon_validate(valid, strlen(valid), &offset) == JACON_OK && offset == strlen(valid);
+    ok = ok && Jacon_validate("[1, 2]", 6, NULL) == JACON_OK;
+    // Only the first len bytes are read
+    ok = ok && Jacon_validate("12345", 2, NULL) == JACON_OK;
+    ok = ok && Jacon_validate("  ", 2, NULL) == JACON_ERR_EMPTY_INPUT;
+
+    ok = ok && Jacon_validate("[1, 2,]", 7, &offset) == JACON_ERR_INVALID_JSON && offset == 6;
+    ok = ok && Jacon_validate("{\"a\": 1,}", 9, &offset) == JACON_ERR_INVALID_JSON && offset == 8;
+    ok = ok && Jacon_validate("{\"a\" 1}", 7, &offset) == JACON_ERR_INVALID_JSON && offset == 5;
+    ok = ok && Jacon_validate("[01]", 4, &offset) == JACON_ERR_INVALID_JSON && offset == 2;
+    ok = ok && Jacon_validate("[\"\\x\"]", 6, &offset) == JACON_ERR_INVALID_ESCAPE_SEQUENCE && offset == 3;
+    ok = ok && Jacon_validate("\"a\tb\"", 5, &offset) == JACON_ERR_INVALID_JSON && offset == 2;
+    ok = ok && Jacon_validate("[1] 2", 5, &offset) == JACON_ERR_INVALID_JSON && offset == 4;
+    ok = ok && Jacon_validate("[1", 2, &offset) == JACON_ERR_INVALID_JSON && offset == 2;
+    ok = ok && Jacon_validate("[tru]", 5, NULL) == JACON_ERR_INVALID_JSON;
+
+    // Duplicate names are compared decoded, nested objects have their own names
+    const char* duplicate = "{\"a\": {\"a\": 1, \"b\": [\"a\"]}, \"b\\\"\": 2, \"\\u0061\": 3}";
+    ok = ok && Jacon_validate(duplicate, strlen(duplicate), &offset) == JACON_ERR_DUPLICATE_NAME
+        && offset == strlen(duplicate) - 12;
+    ok = ok && Jacon_validate("{\"b\\\"\": 1, \"b\": 2}", 18, NULL) == JACON_OK;
+    ok = ok && Jacon_validate("{\"\\ud83d\\ude00\": 1, \"\xf0\x9f\x98\x80\": 2}", 30, NULL) == JACON_ERR_DUPLICATE_NAME;
+
+    char nested[2 * JACON_VALIDATE_MAX_DEPTH + 2];
+    memset(nested, '[', JACON_VALIDATE_MAX_DEPTH);
+    memset(nested + JACON_VALIDATE_MAX_DEPTH, ']', JACON_VALIDATE_MAX_DEPTH);
+    ok = ok && Jacon_validate(nested, 2 * JACON_VALIDATE_MAX_DEPTH, NULL) == JACON_OK;
+    memset(nested, '[', JACON_VALIDATE_MAX_DEPTH + 1);
+    memset(nested + JACON_VALIDATE_MAX_DEPTH + 1, ']', JACON_VALIDATE_MAX_DEPTH + 1);
+    ok = ok && Jacon_validate(nested, 2 * JACON_VALIDATE_MAX_DEPTH + 2, &offset) == JACON_ERR_DEPTH_LIMIT
+        && offset == JACON_VALIDATE_MAX_DEPTH;
+
+    // Wide objects stay linear, rescanning the earlier names for each one would take hours
+    Jacon_StringBuilder wide = {0};
+    Jacon_str_append_null(&wide, "{\"inner\": [{\"k0\": 0, \"k1\": 1}");
+    for (int i = 0; i < 100; i++) Jacon_str_append_null(&wide, ", {\"k0\": 0, \"k1\": 1}");
+    Jacon_str_append_null(&wide, "]");
+    for (int i = 0; i < 200000; i++) {
+        // Grown geometrically, appends through Jacon_str_append_null reallocate to the exact size
+        const char* member = Jacon_tmp_str(", \"k%d\": %d", i, i);
+        Jacon_str_append_n(&wide, member, strlen(member));
+    }
+    Jacon_str_append_null(&wide, "}");
+    clock_t start = clock();
+    ok = ok && Jacon_validate(wide.string, wide.count, NULL) == JACON_OK;
+    wide.string[--wide.count] = '\0';
+    Jacon_str_append_null(&wide, ", \"\\u006b0\": 1}");
+    ok = ok && Jacon_validate(wide.string, wide.count, &offset) == JACON_ERR_DUPLICATE_NAME
+        && offset == wide.count - 13;
+    ok = ok && (double)(clock() - start) / CLOCKS_PER_SEC < 2.0;
+    Jacon_str_free(&wide);
+    return ok;
+}
+
+bool
+test_unescape_strings()
+{
+    const char* json = "{\"s\": \"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\\ud800x\\u0000y\", \"k\\\"ey\": \"\xc3\xa9t\xc3\xa9 \xe2\x82\xac\xe2\x82\xac\xe2\x82\xac \xf0\x9f\x98\x80\"}";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, json) == JACON_OK;
+    const char* view = NULL;
+    size_t length = 0;
+    ok = ok && Jacon_get_string_view_by_name(&content, "s", &view, &length) == JACON_OK
+        && strcmp(view, "a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80\xef\xbf\xbdx\xc0\x80y") == 0;
+    ok = ok && Jacon_get_string_view_by_name(&content, "k\"ey", &view, &length) == JACON_OK;
+    char* result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, "{\"s\":\"a\\\"b\\\\c\\n\xc3\xa9\xf0\x9f\x98\x80\xef\xbf\xbdx\\u0000y\","
+        "\"k\\\"ey\":\"\xc3\xa9t\xc3\xa9 \xe2\x82\xac\xe2\x82\xac\xe2\x82\xac \xf0\x9f\x98\x80\"}") == 0;
+    free(result);
+    Jacon_free_content(&content);
+
+    // Escaped backslash right before the closing quote
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "[\"a\\\\\", \"b\"]") == JACON_OK
+        && content.root->child_count == 2 && strcmp(content.root->childs[0]->value.string_val, "a\\") == 0;
+    Jacon_free_content(&content);
+
+#ifndef JACON_NO_UTF8_VALIDATION
+    const char* invalid[] = {
+        "[\"\xc3\x28\"]",
+        "[\"overlong \xc0\xaf\"]",
+        "[\"surrogate \xed\xa0\x80\"]",
+        "[\"too large \xf4\x90\x80\x80\"]",
+        "[\"long enough to span two simd blocks \xe2\x82\"]",
+        "[\"\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\x80\"]",
+    };
+    for (size_t i = 0; ok && i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        Jacon_init_content(&content);
+        ok = Jacon_deserialize(&content, invalid[i]) == JACON_ERR_INVALID_UTF8
+            && Jacon_validate(invalid[i], strlen(invalid[i]), NULL) == JACON_ERR_INVALID_UTF8;
+        Jacon_free_content(&content);
+    }
+#endif
+    return ok;
+}
+
+bool
+test_serialize_escapes()
+{
+    // Escapes on both sides of the 16 byte blocks
+    const char* json = "{\"name with \\\"quotes\\\" inside\": \"0123456789abcde\\\"0123456789abcde\\\\"
+        "\\u0001\\u001f\\t tail long enough to be copied in bulk\\u0000\", \"plain\": \"\"}";
+    const char* expected = "{\"name with \\\"quotes\\\" inside\":\"0123456789abcde\\\"0123456789abcde\\\\"
+        "\\u0001\\u001f\\t tail long enough to be copied in bulk\\u0000\",\"plain\":\"\"}";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, json) == JACON_OK;
+    char* result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, expected) == 0;
+
+    // The output parses back to the same values
+    Jacon_content reparsed = {0};
+    Jacon_init_content(&reparsed);
+    char* again = NULL;
+    ok = ok && Jacon_deserialize(&reparsed, result) == JACON_OK;
+    again = ok ? Jacon_serialize_unformatted(reparsed.root) : NULL;
+    ok = ok && strcmp(again, expected) == 0;
+    free(result);
+    free(again);
+    Jacon_free_content(&reparsed);
+
+    // Fixed writers size escaped strings exactly
+    char buffer[128];
+    Jacon_Writer writer;
+    size_t size = 0;
+    const char* escaped = strchr(expected, ':') + 1;
+    Jacon_writer_init_fixed(&writer, buffer, sizeof(buffer));
+    Jacon_writer_string(&writer, content.root->childs[0]->value.string_val);
+    ok = ok && Jacon_writer_finish(&writer, &size) == JACON_OK
+        && size == (size_t)(strchr(escaped, ',') - escaped) && memcmp(buffer, escaped, size) == 0;
+    Jacon_free_content(&content);
+    return ok;
+}
+
+bool
+test_share_node()
+{
+    const char* json = "{\"user\": {\"name\": \"jo\", \"id\": 7}, \"items\": [1, 2, {\"a\": true}], \"total\": 3}";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, json) == JACON_OK;
+    Jacon_Node* clone = ok ? Jacon_share_node(content.root) : NULL;
+    ok = ok && clone != NULL && clone->child_count == 3;
+    for (size_t i = 0; ok && i < clone->child_count; i++) {
+        ok = clone->childs[i] == content.root->childs[i];
+    }
+
+    // A duplicate shares nothing and can be modified anywhere
+    Jacon_Node* copy = ok ? Jacon_duplicate_node(content.root) : NULL;
+    ok = ok && copy != NULL && copy->childs[0] != content.root->childs[0]
+        && copy->childs[0]->parent == copy && copy->childs[0]->childs[0]->parent == copy->childs[0];
+    if (ok) copy->childs[0]->childs[1]->value.int_val = 8;
+    ok = ok && Jacon_get_child_by_name(content.root->childs[0], "id")->value.int_val == 7;
+    if (copy != NULL) Jacon_free_node(copy);
+
+    // Only the path to the written node is copied
+    Jacon_Node* name = ok ? Jacon_unshare_path(clone, "user.name") : NULL;
+    ok = ok && name != NULL && name != Jacon_get_child_by_name(content.root->childs[0], "name")
+        && name->parent == clone->childs[0] && clone->childs[0]->parent == clone;
+    ok = ok && clone->childs[0] != content.root->childs[0] && clone->childs[1] == content.root->childs[1];
+    ok = ok && Jacon_get_child_by_name(clone->childs[0], "id") == Jacon_get_child_by_name(content.root->childs[0], "id");
+    if (ok) {
+        Jacon_free(name->value.string_val);
+        name->value.string_val = Jacon_strdup("max");
+    }
+    Jacon_Node* total = ok ? Jacon_unshare_path(clone, "total") : NULL;
+    ok = ok && total != NULL && Jacon_unshare_path(clone, "user.missing") == NULL;
+    if (ok) total->value.int_val = 4;
+
+    char* original = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(original, "{\"user\":{\"name\":\"jo\",\"id\":7},\"items\":[1,2,{\"a\":true}],\"total\":3}") == 0;
+    free(original);
+
+    // The clone outlives the original
+    Jacon_free_content(&content);
+    char* modified = ok ? Jacon_serialize_unformatted(clone) : NULL;
+    ok = ok && strcmp(modified, "{\"user\":{\"name\":\"max\",\"id\":7},\"items\":[1,2,{\"a\":true}],\"total\":4}") == 0;
+    free(modified);
+    if (clone != NULL) Jacon_free_node(clone);
+    return ok;
+}
+
+bool
+test_json_patch()
+{
+    Jacon_content from = {0};
+    Jacon_content to = {0};
+    Jacon_init_content(&from);
+    Jacon_init_content(&to);
+    bool ok = Jacon_deserialize(&from, "{\"a\": 1, \"b\": [1, 2, 3], \"c\": {\"d\": \"x\"}, \"f/g~\": true}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&to, "{\"c\": {\"d\": \"y\"}, \"a\": 1.0, \"b\": [1, 3], \"e\": null}") == JACON_OK;
+
+    Jacon_StringBuilder patch = {0};
+    ok = ok && Jacon_diff(from.root, to.root, &patch) == JACON_OK;
+    ok = ok && strcmp(patch.string, "[{\"op\":\"remove\",\"path\":\"/b/1\"},{\"op\":\"replace\",\"path\":\"/c/d\",\"value\":\"y\"},"
+        "{\"op\":\"remove\",\"path\":\"/f~1g~0\"},{\"op\":\"add\",\"path\":\"/e\",\"value\":null}]") == 0;
+
+    // Applying the diff gives an equal document
+    ok = ok && Jacon_apply_patch(from.root, patch.string) == JACON_OK;
+    Jacon_str_free(&patch);
+    ok = ok && Jacon_diff(from.root, to.root, &patch) == JACON_OK && strcmp(patch.string, "[]") == 0;
+    Jacon_str_free(&patch);
+
+    // Every operation, pointers escape '/' and '~'
+    const char* operations = "[{\"op\": \"add\", \"path\": \"/b/-\", \"value\": {\"x/y\": [4]}},"
+        "{\"op\": \"add\", \"path\": \"/b/0\", \"value\": 0},"
+        "{\"op\": \"copy\", \"from\": \"/b/3/x~1y\", \"path\": \"/copied\"},"
+        "{\"op\": \"move\", \"from\": \"/c\", \"path\": \"/moved\"},"
+        "{\"op\": \"replace\", \"path\": \"/a\", \"value\": \"one\"},"
+        "{\"op\": \"test\", \"path\": \"/copied\", \"value\": [4.0]},"
+        "{\"op\": \"remove\", \"path\": \"/e\"}]";
+    ok = ok && Jacon_apply_patch(from.root, operations) == JACON_OK;
+    char* result = ok ? Jacon_serialize_unformatted(from.root) : NULL;
+    ok = ok && strcmp(result, "{\"a\":\"one\",\"b\":[0,1,3,{\"x/y\":[4]}],\"copied\":[4],\"moved\":{\"d\":\"y\"}}") == 0;
+    free(result);
+
+    // A failing operation leaves the document untouched
+    ok = ok && Jacon_apply_patch(from.root, "[{\"op\": \"remove\", \"path\": \"/a\"},"
+        "{\"op\": \"test\", \"path\": \"/copied/0\", \"value\": 5}]") == JACON_ERR_PATCH_TEST_FAILED;
+    ok = ok && Jacon_apply_patch(from.root, "[{\"op\": \"remove\", \"path\": \"/b/4\"}]") == JACON_ERR_INDEX_OUT_OF_BOUND;
+    ok = ok && Jacon_apply_patch(from.root, "[{\"op\": \"replace\", \"path\": \"/missing\", \"value\": 1}]") == JACON_ERR_CHILD_NOT_FOUND;
+    ok = ok && Jacon_apply_patch(from.root, "[{\"op\": \"move\", \"from\": \"/moved\", \"path\": \"/moved/d\"}]") == JACON_ERR_INVALID_JSON;
+    result = ok ? Jacon_serialize_unformatted(from.root) : NULL;
+    ok = ok && strcmp(result, "{\"a\":\"one\",\"b\":[0,1,3,{\"x/y\":[4]}],\"copied\":[4],\"moved\":{\"d\":\"y\"}}") == 0;
+    free(result);
+
+    // Nodes kept from the former document hang from the copied path, the index follows the patch
+    Jacon_content nested = {0};
+    Jacon_init_content(&nested);
+    ok = ok && Jacon_deserialize(&nested, "{\"a\": {\"b\": {\"c\": 1, \"d\": 2}}, \"e\": [1]}") == JACON_OK;
+    ok = ok && Jacon_content_apply_patch(&nested, "[{\"op\": \"replace\", \"path\": \"/a/b/c\", \"value\": 3}]") == JACON_OK;
+    Jacon_Node* a = ok ? nested.root->childs[0] : NULL;
+    Jacon_Node* b = ok ? a->childs[0] : NULL;
+    ok = ok && a->parent == nested.root && b->parent == a && b->childs[0]->parent == b && b->childs[1]->parent == b
+        && nested.root->childs[1]->parent == nested.root;
+    int number = 0;
+    ok = ok && Jacon_get_int_by_name(&nested, "a.b.c", &number) == JACON_OK && number == 3;
+    ok = ok && Jacon_get_int_by_name(&nested, "a.b.d", &number) == JACON_OK && number == 2;
+    ok = ok && Jacon_content_apply_patch(&nested, "[{\"op\": \"add\", \"path\": \"/a/f\", \"value\": 4},"
+        "{\"op\": \"test\", \"path\": \"/e/0\", \"value\": 2}]") == JACON_ERR_PATCH_TEST_FAILED;
+    ok = ok && Jacon_get_int_by_name(&nested, "a.f", &number) == JACON_ERR_KEY_NOT_FOUND
+        && Jacon_get_int_by_name(&nested, "a.b.c", &number) == JACON_OK && number == 3;
+    Jacon_free_content(&nested);
+
+    // The whole document
+    ok = ok && Jacon_apply_patch(from.root, "[{\"op\": \"replace\", \"path\": \"\", \"value\": [true]}]") == JACON_OK;
+    result = ok ? Jacon_serialize_unformatted(from.root) : NULL;
+    ok = ok && strcmp(result, "[true]") == 0;
+    free(result);
+
+    Jacon_free_content(&from);
+    Jacon_free_content(&to);
+    return ok;
+}
+
+bool
+test_merge_patch()
+{
+    Jacon_content target = {0};
+    Jacon_content patch = {0};
+    Jacon_init_content(&target);
+    Jacon_init_content(&patch);
+    bool ok = Jacon_deserialize(&target, "{\"a\": 1, \"b\": {\"c\": 2, \"d\": [1, 2]}, \"e\": \"x\", \"f\": {\"g\": true}}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&patch, "{\"a\": null, \"b\": {\"c\": 3, \"d\": null, \"n\": {\"z\": null, \"y\": 1}},"
+        "\"e\": [1], \"f\": \"flat\", \"h\": {\"i\": null}}") == JACON_OK;
+    ok = ok && Jacon_merge_patch(&target, &patch) == JACON_OK;
+    char* result = ok ? Jacon_serialize_unformatted(target.root) : NULL;
+    ok = ok && strcmp(result, "{\"b\":{\"c\":3,\"n\":{\"y\":1}},\"e\":[1],\"f\":\"flat\",\"h\":{}}") == 0;
+    free(result);
+    ok = ok && patch.root->child_count == 0;
+
+    // The path index follows the merge
+    int value = 0;
+    char* string = NULL;
+    ok = ok && Jacon_get_int_by_name(&target, "b.c", &value) == JACON_OK && value == 3;
+    ok = ok && Jacon_get_int_by_name(&target, "b.n.y", &value) == JACON_OK && value == 1;
+    ok = ok && Jacon_get_int_by_name(&target, "a", &value) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_get_int_by_name(&target, "f.g", &value) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_get_string_by_name(&target, "f", &string) == JACON_OK && strcmp(string, "flat") == 0;
+    free(string);
+    ok = ok && Jacon_exist_by_name(&target, "e", JACON_VALUE_ARRAY) && !Jacon_exist_by_name(&target, "b.d", JACON_VALUE_ARRAY);
+
+    // Enough members to look them up through a table
+    Jacon_free_content(&patch);
+    Jacon_init_content(&patch);
+    ok = ok && Jacon_deserialize(&patch, "{\"b\": null, \"e\": 2, \"f\": null, \"h\": {\"k\": \"v\"}, \"i\": 4, \"j\": 5}") == JACON_OK;
+    ok = ok && Jacon_merge_patch(&target, &patch) == JACON_OK;
+    result = ok ? Jacon_serialize_unformatted(target.root) : NULL;
+    ok = ok && strcmp(result, "{\"e\":2,\"h\":{\"k\":\"v\"},\"i\":4,\"j\":5}") == 0;
+    free(result);
+    ok = ok && Jacon_get_int_by_name(&target, "j", &value) == JACON_OK && value == 5;
+    ok = ok && Jacon_get_int_by_name(&target, "e", &value) == JACON_OK && value == 2;
+    ok = ok && !Jacon_exist_by_name(&target, "b.c", JACON_VALUE_INT);
+
+    // Anything but an object replaces the whole document
+    Jacon_free_content(&patch);
+    Jacon_init_content(&patch);
+    ok = ok && Jacon_deserialize(&patch, "[true]") == JACON_OK;
+    ok = ok && Jacon_merge_patch(&target, &patch) == JACON_OK;
+    result = ok ? Jacon_serialize_unformatted(target.root) : NULL;
+    ok = ok && strcmp(result, "[true]") == 0;
+    free(result);
+    ok = ok && !Jacon_exist_by_name(&target, "e", JACON_VALUE_INT);
+
+    Jacon_free_content(&target);
+    Jacon_free_content(&patch);
+    return ok;
+}
+
+// Every path of a full rebuild is in the index with the same value, and nothing else
+bool
+index_matches_rebuild(Jacon_content* content)
+{
+    Jacon_content rebuilt = {0};
+    Jacon_init_content(&rebuilt);
+    // Duplicate members do not parse, index a copy of the tree instead
+    Jacon_free_node(rebuilt.root);
+    rebuilt.root = Jacon_duplicate_node(content->root);
+    bool ok = Jacon_add_node_to_map(&rebuilt.entries, rebuilt.root, NULL) == JACON_OK;
+    ok = ok && rebuilt.entries.entries_count == content->entries.entries_count;
+    for (size_t i = 0; ok && i < rebuilt.entries.size; i++) {
+        for (Jacon_HashMapEntry* entry = rebuilt.entries.entries[i]; ok && entry != NULL; entry = entry->next_entry) {
+            Jacon_Node* value = Jacon_hm_get(&content->entries, entry->key);
+            char* expected = Jacon_serialize_unformatted(entry->value);
+            char* result = value != NULL ? Jacon_serialize_unformatted(value) : NULL;
+            ok = result != NULL && strcmp(expected, result) == 0;
+            free(expected);
+            free(result);
+        }
+    }
+    Jacon_free_content(&rebuilt);
+    return ok;
+}
+
+bool
+test_content_mutation()
+{
+    Jacon_content content = {0};
+    Jacon_content source = {0};
+    Jacon_init_content(&content);
+    Jacon_init_content(&source);
+    bool ok = Jacon_deserialize(&content, "{\"cfg\": {\"port\": 80, \"hosts\": [\"a\"], \"tls\": {\"on\": true}}, \"name\": \"x\"}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&source, "{\"mode\": \"fast\", \"tls\": {\"cert\": \"c\"}, \"list\": [\"b\"], \"name\": {\"n\": 1}}") == JACON_OK;
+    if (!ok) return false;
+    Jacon_Node** nodes = source.root->childs;
+
+    char* string = NULL;
+    int value = 0;
+    ok = Jacon_content_append_child(&content, "cfg", Jacon_duplicate_node(nodes[0])) == JACON_OK;
+    ok = ok && Jacon_get_string_by_name(&content, "cfg.mode", &string) == JACON_OK && strcmp(string, "fast") == 0;
+    free(string);
+    ok = ok && Jacon_content_append_child(&content, "cfg.hosts", Jacon_duplicate_node(nodes[2]->childs[0])) == JACON_OK;
+    Jacon_Node* hosts = Jacon_hm_get(&content.entries, "cfg.hosts");
+    ok = ok && hosts != NULL && hosts->child_count == 2 && index_matches_rebuild(&content);
+
+    ok = ok && Jacon_content_replace_child(&content, "cfg", "tls", Jacon_duplicate_node(nodes[1])) == JACON_OK;
+    ok = ok && !Jacon_exist_by_name(&content, "cfg.tls.on", JACON_VALUE_BOOLEAN);
+    ok = ok && Jacon_get_string_by_name(&content, "cfg.tls.cert", &string) == JACON_OK && strcmp(string, "c") == 0;
+    free(string);
+    ok = ok && Jacon_content_remove_child_by_name(&content, "cfg", "port") == JACON_OK;
+    ok = ok && !Jacon_exist_by_name(&content, "cfg.port", JACON_VALUE_INT) && index_matches_rebuild(&content);
+
+    // A replacing member with another name is indexed under its own name
+    ok = ok && Jacon_content_replace_child(&content, "cfg", "hosts", Jacon_duplicate_node(nodes[2])) == JACON_OK;
+    ok = ok && Jacon_exist_by_name(&content, "cfg.list", JACON_VALUE_ARRAY);
+    ok = ok && !Jacon_exist_by_name(&content, "cfg.hosts", JACON_VALUE_ARRAY) && index_matches_rebuild(&content);
+
+    // A duplicate member overrides the previous one, removal takes the first and keeps the other indexed
+    ok = ok && Jacon_content_append_child(&content, NULL, Jacon_duplicate_node(nodes[3])) == JACON_OK;
+    ok = ok && Jacon_get_int_by_name(&content, "name.n", &value) == JACON_OK && value == 1;
+    ok = ok && Jacon_content_remove_child_by_name(&content, "", "name") == JACON_OK;
+    ok = ok && Jacon_get_string_by_name(&content, "name", &string) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_get_int_by_name(&content, "name.n", &value) == JACON_OK && index_matches_rebuild(&content);
+
+    ok = ok && Jacon_content_remove_child_by_name(&content, "cfg.missing", "port") == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_content_remove_child_by_name(&content, "cfg.list", "b") == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_content_replace_child(&content, "cfg", "port", nodes[0]) == JACON_ERR_CHILD_NOT_FOUND;
+
+    Jacon_free_content(&content);
+    Jacon_free_content(&source);
+    return ok;
+}
+
+bool
+test_batch()
+{
+    Jacon_content content = {0};
+    Jacon_content source = {0};
+    Jacon_init_content(&content);
+    Jacon_init_content(&source);
+    bool ok = Jacon_deserialize(&content, "{\"cfg\": {\"a\": 1, \"b\": 2, \"c\": {\"d\": 3}, \"l\": [1]}, \"x\": true}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&source, "{\"v\": 10, \"w\": {\"z\": 4}, \"e\": [2]}") == JACON_OK;
+    if (!ok) return false;
+    Jacon_Node** nodes = source.root->childs;
+
+    Jacon_Batch batch = {0};
+    ok = Jacon_batch_remove(&batch, "cfg", "a") == JACON_OK;
+    ok = ok && Jacon_batch_replace(&batch, "cfg", "c", Jacon_duplicate_node(nodes[1])) == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, "cfg.l", Jacon_duplicate_node(nodes[2]->childs[0])) == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, NULL, Jacon_duplicate_node(nodes[0])) == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, "cfg", Jacon_duplicate_node(nodes[0])) == JACON_OK;
+    ok = ok && Jacon_batch_remove(&batch, "cfg", "v") == JACON_OK;
+    ok = ok && Jacon_batch_remove(&batch, "", "x") == JACON_OK;
+
+    // Any failing operation leaves the document as it was
+    ok = ok && Jacon_batch_remove(&batch, "cfg", "missing") == JACON_OK;
+    ok = ok && Jacon_batch_apply_content(&content, &batch) == JACON_ERR_CHILD_NOT_FOUND;
+    char* result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, "{\"cfg\":{\"a\":1,\"b\":2,\"c\":{\"d\":3},\"l\":[1]},\"x\":true}") == 0;
+    free(result);
+
+    Jacon_free(batch.operations[--batch.count].path);
+    Jacon_free(batch.operations[batch.count].name);
+    ok = ok && Jacon_batch_apply_content(&content, &batch) == JACON_OK && batch.count == 0;
+    result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, "{\"cfg\":{\"b\":2,\"w\":{\"z\":4},\"l\":[1,2]},\"v\":10}") == 0;
+    free(result);
+    int value = 0;
+    ok = ok && Jacon_get_int_by_name(&content, "cfg.w.z", &value) == JACON_OK && value == 4;
+    ok = ok && !Jacon_exist_by_name(&content, "cfg.a", JACON_VALUE_INT) && !Jacon_exist_by_name(&content, "cfg.c.z", JACON_VALUE_INT)
+        && index_matches_rebuild(&content);
+
+    // Thousands of members in one go
+    for (int i = 0; ok && i < 3000; i++) {
+        Jacon_Node* node = Jacon_duplicate_node(nodes[0]);
+        Jacon_free(node->name);
+        node->name = Jacon_strdup(Jacon_tmp_str("k%d", i));
+        ok = Jacon_batch_append(&batch, "cfg", node) == JACON_OK;
+    }
+    for (int i = 0; ok && i < 3000; i += 2) ok = Jacon_batch_remove(&batch, "cfg", Jacon_tmp_str("k%d", i)) == JACON_OK;
+    ok = ok && Jacon_batch_apply_content(&content, &batch) == JACON_OK;
+    Jacon_Node* cfg = content.root->childs[0];
+    ok = ok && cfg->child_count == 1503 && strcmp(cfg->childs[3]->name, "k1") == 0;
+    ok = ok && Jacon_get_int_by_name(&content, "cfg.k2999", &value) == JACON_OK;
+    ok = ok && !Jacon_exist_by_name(&content, "cfg.k2998", JACON_VALUE_INT) && index_matches_rebuild(&content);
+
+    // On a bare tree
+    ok = ok && Jacon_batch_remove(&batch, "cfg", "l") == JACON_OK;
+    ok = ok && Jacon_batch_apply(cfg, &batch) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_batch_apply(content.root, &batch) == JACON_OK && cfg->child_count == 1502;
+    Jacon_batch_free(&batch);
+    Jacon_free_content(&content);
+    Jacon_free_content(&source);
+
+    // Nothing is appended below a member an earlier operation removed
+    Counting_allocator counter = {0};
+    Jacon_Allocator allocator = {
+        .allocate = counting_allocate,
+        .reallocate = counting_reallocate,
+        .deallocate = counting_deallocate,
+        .ctx = &counter,
+    };
+    Jacon_init_content_with_allocator(&content, &allocator);
+    ok = ok && Jacon_deserialize(&content, "{\"a\": {\"b\": 1}, \"l\": [1], \"c\": 2}") == JACON_OK;
+    if (!ok) return false;
+    const Jacon_Allocator* previous = Jacon_push_allocator(&allocator);
+    ok = Jacon_batch_remove(&batch, "", "a") == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, "a", Jacon_duplicate_node(content.root->childs[2])) == JACON_OK;
+    ok = ok && Jacon_batch_apply_content(&content, &batch) == JACON_ERR_KEY_NOT_FOUND && batch.count == 2;
+    Jacon_batch_free(&batch);
+
+    // Removed by a later one is fine, an allocation failing anywhere leaves the document,
+    // its index and the batch as they were
+    ok = ok && Jacon_batch_append(&batch, "a", Jacon_duplicate_node(content.root->childs[2])) == JACON_OK;
+    ok = ok && Jacon_batch_remove(&batch, "", "a") == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, "l", Jacon_duplicate_node(content.root->childs[1]->childs[0])) == JACON_OK;
+    ok = ok && Jacon_batch_replace(&batch, "", "c", Jacon_duplicate_node(content.root->childs[0]->childs[0])) == JACON_OK;
+    Jacon_pop_allocator(previous);
+    char* before = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    Jacon_Error ret = JACON_ERR_MEMORY_ALLOCATION;
+    for (size_t budget = 1; ok && ret == JACON_ERR_MEMORY_ALLOCATION; budget++) {
+        counter.limit = counter.allocations + budget;
+        ret = Jacon_batch_apply_content(&content, &batch);
+        counter.limit = 0;
+        if (ret == JACON_OK) break;
+        result = Jacon_serialize_unformatted(content.root);
+        ok = strcmp(result, before) == 0 && batch.count == 4 && index_matches_rebuild(&content);
+        free(result);
+    }
+    free(before);
+    ok = ok && ret == JACON_OK && batch.count == 0 && index_matches_rebuild(&content);
+    result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, "{\"l\":[1,1],\"b\":1}") == 0;
+    free(result);
+    previous = Jacon_push_allocator(&allocator);
+    Jacon_batch_free(&batch);
+    Jacon_pop_allocator(previous);
+    Jacon_free_content(&content);
+    ok = ok && counter.live == 0;
+
+    // Nested groups with the same names, the later duplicate of the upper one wins whatever the order in memory.
+    // The replacing member keeps its name, the removal then finds it first
+    Jacon_init_content(&content);
+    Jacon_init_content(&source);
+    ok = ok && Jacon_deserialize(&content, "{\"a\": {\"a\": {\"a\": 1, \"b\": [2]}, \"c\": 5}}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&source, "{\"a\": {\"a\": 2}, \"b\": 3}") == JACON_OK;
+    if (!ok) return false;
+    ok = Jacon_batch_replace(&batch, "a.a", "a", Jacon_duplicate_node(source.root->childs[1])) == JACON_OK;
+    ok = ok && Jacon_batch_append(&batch, "a", Jacon_duplicate_node(source.root->childs[0])) == JACON_OK;
+    ok = ok && Jacon_batch_remove(&batch, "a.a", "b") == JACON_OK;
+    ok = ok && Jacon_batch_apply_content(&content, &batch) == JACON_OK;
+    result = ok ? Jacon_serialize_unformatted(content.root) : NULL;
+    ok = ok && strcmp(result, "{\"a\":{\"a\":{\"b\":[2]},\"c\":5,\"a\":{\"a\":2}}}") == 0;
+    free(result);
+    ok = ok && Jacon_get_int_by_name(&content, "a.a.a", &value) == JACON_OK && value == 2;
+    ok = ok && index_matches_rebuild(&content);
+    Jacon_batch_free(&batch);
+    Jacon_free_content(&content);
+    Jacon_free_content(&source);
+    return ok;
+}
+
+bool
+test_stats()
+{
+    Jacon_Stats stats = {0};
+    Jacon_Stats* previous = Jacon_push_stats(&stats);
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize(&content, "{\"a\": \"x\", \"b\": [1, 2], \"c\": {\"d\": null}}") == JACON_OK;
+    int value = 0;
+    ok = ok && Jacon_get_int_by_name(&content, "missing", &value) == JACON_ERR_KEY_NOT_FOUND;
+    ok = ok && Jacon_exist_by_name(&content, "c.d", JACON_VALUE_NULL);
+    Jacon_free_content(&content);
+    Jacon_pop_stats(previous);
+
+#ifdef JACON_STATS
+    ok = ok && stats.tokens == 21 && stats.nodes == 7 && stats.strings == 5;
+    ok = ok && stats.lookup_hits == 1 && stats.lookup_misses == 1;
+    ok = ok && stats.allocations > 0 && stats.bytes_allocated > 0 && stats.map_resizes == 0;
+    ok = ok && stats.tokenize_ns + stats.validate_ns + stats.parse_ns + stats.build_ns > 0;
+#else
+    // Compiled out, nothing is collected
+    Jacon_Stats empty = {0};
+    ok = ok && memcmp(&stats, &empty, sizeof(Jacon_Stats)) == 0;
+#endif
+    return ok;
+}
+
+bool
+test_parse_limits()
+{
+    const char* json = "{\"a\": [[1, 2], {\"b\": \"long\\u00e9\"}], \"c\": 3, \"d\": 4}";
+    Jacon_ParseLimits limits = {0};
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    bool ok = Jacon_deserialize_with_limits(&content, json, &limits) == JACON_OK;
+    Jacon_free_content(&content);
+
+    struct { Jacon_ParseLimits limits; Jacon_Error expected; } cases[] = {
+        { { .max_input_size = 20 }, JACON_ERR_INPUT_TOO_LARGE },
+        { { .max_depth = 2 }, JACON_ERR_DEPTH_LIMIT },
+        { { .max_tokens = 20 }, JACON_ERR_TOKEN_LIMIT },
+        { { .max_object_members = 2 }, JACON_ERR_MEMBER_LIMIT },
+        { { .max_string_length = 4 }, JACON_ERR_STRING_LIMIT },
+        { { .max_allocated_bytes = 4096 }, JACON_ERR_MEMORY_LIMIT },
+        { { .max_input_size = 52, .max_depth = 3, .max_tokens = 27, .max_object_members = 3,
+            .max_string_length = 6 }, JACON_OK },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Jacon_init_content(&content);
+        ok = ok && Jacon_deserialize_with_limits(&content, json, &cases[i].limits) == cases[i].expected;
+        Jacon_free_content(&content);
+    }
+
+    // Errors found deep in an object are not lost on the way up
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, "{\"a\": {\"b\": 1, \"b\": 2}}") == JACON_ERR_DUPLICATE_NAME;
+    Jacon_free_content(&content);
+    return ok;
+}
+
+bool
+test_raw_numbers()
+{
+    const char* json = "{\"id\": 12345678901234567890, \"price\": 0.10000000000000000555,"
+        " \"n\": -42, \"e\": 1.5E3, \"v\": [1, 2.50, 3]}";
+    Jacon_content content = {0};
+    Jacon_init_content(&content);
+    content.raw_numbers = true;
+    bool ok = Jacon_deserialize(&content, json) == JACON_OK;
+
+    // Written back digit for digit
+    char* result = Jacon_serialize_unformatted(content.root);
+    ok = ok && result != NULL && strcmp(result, "{\"id\":12345678901234567890,"
+        "\"price\":0.10000000000000000555,\"n\":-42,\"e\":1.5E3,\"v\":[1,2.50,3]}") == 0;
+    free(result);
+
+    int n = 0;
+    double price = 0;
+    double e = 0;
+    double values[3] = {0};
+    size_t count = 0;
+    ok = ok && Jacon_get_int_by_name(&content, "n", &n) == JACON_OK && n == -42;
+    ok = ok && Jacon_get_double_by_name(&content, "price", &price) == JACON_OK && price == 0.1;
+    ok = ok && Jacon_get_double_by_name(&content, "e", &e) == JACON_OK && e == 1500;
+    ok = ok && Jacon_get_int_by_name(&content, "id", &n) == JACON_ERR_INVALID_VALUE_TYPE;
+    ok = ok && Jacon_get_double_array_by_name(&content, "v", values, 3, &count) == JACON_OK
+        && count == 3 && values[1] == 2.5;
+    ok = ok && Jacon_exist_int_by_name(&content, "n") && !Jacon_exist_string_by_name(&content, "n");
+    Jacon_free_content(&content);
+
+    // Numbers are still converted by default
+    Jacon_init_content(&content);
+    ok = ok && Jacon_deserialize(&content, json) == JACON_OK;
+    ok = ok && Jacon_get_int_by_name(&content, "n", &n) == JACON_OK && n == -42;
+    Jacon_free_content(&content);
+
+    Jacon_init_content(&content);
+    content.raw_numbers = true;
+    ok = ok && Jacon_deserialize(&content, "[1, 01]") == JACON_ERR_INVALID_JSON;
+    Jacon_free_content(&content);
+
+    // Diffs see every digit, not the nearest double
+    Jacon_content from = {0};
+    Jacon_content to = {0};
+    Jacon_content converted = {0};
+    Jacon_init_content(&from);
+    Jacon_init_content(&to);
+    Jacon_init_content(&converted);
+    from.raw_numbers = true;
+    to.raw_numbers = true;
+    ok = ok && Jacon_deserialize(&from, "{\"big\": 9007199254740993, \"f\": 0.10000000000000001,"
+        " \"same\": 1.50e1, \"zero\": -0.0, \"v\": [12345678901234567890]}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&to, "{\"big\": 9007199254740992, \"f\": 0.1,"
+        " \"same\": 15, \"zero\": 0, \"v\": [12345678901234567890]}") == JACON_OK;
+    ok = ok && Jacon_deserialize(&converted, "{\"f\": 0.1, \"same\": 15.0, \"zero\": 0e5}") == JACON_OK;
+    Jacon_StringBuilder patch = {0};
+    ok = ok && Jacon_diff(from.root, to.root, &patch) == JACON_OK
+        && strcmp(patch.string, "[{\"op\":\"replace\",\"path\":\"/big\",\"value\":9007199254740992},"
+            "{\"op\":\"replace\",\"path\":\"/f\",\"value\":0.1}]") == 0;
+    Jacon_str_free(&patch);
+    // Converted numbers compare in their shortest form
+    ok = ok && Jacon_diff(to.root, converted.root, &patch) == JACON_OK
+        && strcmp(patch.string, "[{\"op\":\"remove\",\"path\":\"/big\"},{\"op\":\"remove\",\"path\":\"/v\"}]") == 0;
+    Jacon_str_free(&patch);
+    Jacon_free_content(&from);
+    Jacon_free_content(&to);
+    Jacon_free_content(&converted);
+    return ok;
+}
+
 int
 main(void)
 {
+    EXPECT(test_deserialize_paths, true);
+    EXPECT(test_deserialize_ndjson, true);
+    EXPECT(test_deserialize_parallel, true);
+    EXPECT(test_content_allocator, true);
+    EXPECT(test_get_batch, true);
+    EXPECT(test_get_string_view, true);
+    EXPECT(test_get_number_arrays, true);
+    EXPECT(test_binary_transcoding, true);
+    EXPECT(test_snapshot, true);
+    EXPECT(test_deserialize_struct, true);
+    EXPECT(test_serialize_struct, true);
+    EXPECT(test_writer, true);
+    EXPECT(test_minify_prettify, true);
+    EXPECT(test_validate, true);
+    EXPECT(test_unescape_strings, true);
+    EXPECT(test_serialize_escapes, true);
+    EXPECT(test_share_node, true);
+    EXPECT(test_json_patch, true);
+    EXPECT(test_merge_patch, true);
+    EXPECT(test_content_mutation, true);
+    EXPECT(test_batch, true);
+    EXPECT(test_stats, true);
+    EXPECT(test_parse_limits, true);
+    EXPECT(test_raw_numbers, true);
+
+    if (failed_tests > 0) {
+        printf("%d test(s) failed\n", failed_tests);
+        return 1;
+    }
     puts("Tests executed successfully !");
-}
\ No newline at end of file
+}